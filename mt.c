@@ -16,8 +16,11 @@
  * Parámetros del TLB
  */
 #define TLB_MAX_ENTRIES    5
-#define TLB_ENTRY_SIZE     32             /* bytes por entrada (diseño propio) */
-#define TLB_SIZE_BYTES     (TLB_MAX_ENTRIES * TLB_ENTRY_SIZE) /* <= 300 */
+#define TLB_ENTRY_SIZE     40             /* bytes por entrada (diseño propio) */
+#define TLB_HASH_BUCKETS   8              /* potencia de 2 */
+#define TLB_META_SIZE      (4 + 2 * TLB_HASH_BUCKETS)
+#define TLB_SIZE_BYTES     (TLB_MAX_ENTRIES * TLB_ENTRY_SIZE + TLB_META_SIZE)
+#define ENTRY_NONE         0xFFFFU        /* índice nulo en lista y hash */
 
 /*
  * Layout de cada entrada dentro del bloque del TLB (sin struct, sólo offsets)
@@ -30,7 +33,11 @@
  * [12..15] uint32_t      offset_dec
  * [16..19] uint32_t      page_bin
  * [20..23] uint32_t      offset_bin
- * [24..31] unsigned long last_used   (para LRU)
+ * [24..31] unsigned long last_used   (para LRU por recorrido)
+ * [32..33] uint16_t      prev        (lista de recencia)
+ * [34..35] uint16_t      next        (lista de recencia)
+ * [36..37] uint16_t      hnext       (cadena de la cubeta hash)
+ * [38..39] relleno
  */
 #define FIELD_VALID        0
 #define FIELD_VADDR        4
@@ -39,6 +46,29 @@
 #define FIELD_PAGE_BIN     16
 #define FIELD_OFF_BIN      20
 #define FIELD_LAST_USED    24
+#define FIELD_PREV         32
+#define FIELD_NEXT         34
+#define FIELD_HNEXT        36
+
+/*
+ * Metadatos detrás de las entradas, en el mismo bloque:
+ * [0..1] cabeza de la lista (más reciente), [2..3] cola (víctima),
+ * [4..]  cubetas del índice hash por número de página (uint16).
+ */
+#define META_HEAD          0
+#define META_TAIL          2
+#define META_BUCKETS       4
+
+#define ENTRY_AT(i)  (tlb_base + (size_t)(i) * TLB_ENTRY_SIZE)
+#define TLB_META     (tlb_base + TLB_MAX_ENTRIES * TLB_ENTRY_SIZE)
+#define LINK(p, off) (*(uint16_t *)((p) + (off)))
+#define BUCKET(page) \
+    LINK(TLB_META, META_BUCKETS + 2 * ((page) & (TLB_HASH_BUCKETS - 1)))
+
+/*
+ * Con -DMT_LRU_SCAN se compila el recorrido de contadores original en lugar
+ * de la lista de recencia O(1); se conserva como referencia para comparar.
+ */
 
 /* TLB en heap (segmento dinámico) */
 static unsigned char *tlb_base = NULL;
@@ -100,14 +130,78 @@ void tlb_init(void)
         exit(EXIT_FAILURE);
     }
 
-    /* Marcar todas las entradas como inválidas */
+    /*
+     * Marcar todas las entradas como inválidas y enlazarlas en la lista de
+     * recencia con la entrada 0 en la cola: la primera víctima es la primera
+     * entrada vacía, igual que en el recorrido original.
+     */
     unsigned char *entry = tlb_base;
     for (int i = 0; i < TLB_MAX_ENTRIES; ++i) {
         int *valid = (int *)(entry + FIELD_VALID);
         *valid = 0;
+        LINK(entry, FIELD_PREV) = (uint16_t)(i + 1 < TLB_MAX_ENTRIES
+                                             ? (unsigned)i + 1U : ENTRY_NONE);
+        LINK(entry, FIELD_NEXT) = (uint16_t)(i > 0 ? (unsigned)i - 1U
+                                                   : ENTRY_NONE);
+        LINK(entry, FIELD_HNEXT) = ENTRY_NONE;
         entry += TLB_ENTRY_SIZE;
     }
+    LINK(TLB_META, META_HEAD) = (uint16_t)(TLB_MAX_ENTRIES - 1);
+    LINK(TLB_META, META_TAIL) = 0;
+    for (int b = 0; b < TLB_HASH_BUCKETS; ++b) {
+        LINK(TLB_META, META_BUCKETS + 2 * b) = ENTRY_NONE;
+    }
+}
+
+#ifndef MT_LRU_SCAN
+/*
+ * Mueve la entrada idx a la cabeza de la lista de recencia. O(1).
+ * No usa variables apuntador locales.
+ */
+static void lru_touch(uint16_t idx)
+{
+    uint16_t prev = LINK(ENTRY_AT(idx), FIELD_PREV);
+    uint16_t next = LINK(ENTRY_AT(idx), FIELD_NEXT);
+
+    if (idx == LINK(TLB_META, META_HEAD)) {
+        return;
+    }
+    /* Desenlazar (prev existe porque idx no es la cabeza) */
+    LINK(ENTRY_AT(prev), FIELD_NEXT) = next;
+    if (next != ENTRY_NONE) {
+        LINK(ENTRY_AT(next), FIELD_PREV) = prev;
+    } else {
+        LINK(TLB_META, META_TAIL) = prev;
+    }
+    /* Enlazar delante de la cabeza actual */
+    LINK(ENTRY_AT(idx), FIELD_PREV) = ENTRY_NONE;
+    LINK(ENTRY_AT(idx), FIELD_NEXT) = LINK(TLB_META, META_HEAD);
+    LINK(ENTRY_AT(LINK(TLB_META, META_HEAD)), FIELD_PREV) = idx;
+    LINK(TLB_META, META_HEAD) = idx;
+}
+
+/*
+ * Quita la entrada idx de la cadena de su cubeta (página page).
+ * Las cadenas tienen a lo sumo TLB_MAX_ENTRIES eslabones y con 8 cubetas
+ * suelen tener uno. No usa variables apuntador locales.
+ */
+static void hash_remove(uint16_t idx, uint32_t page)
+{
+    uint16_t cur = BUCKET(page);
+
+    if (cur == idx) {
+        BUCKET(page) = LINK(ENTRY_AT(idx), FIELD_HNEXT);
+        return;
+    }
+    while (cur != ENTRY_NONE) {
+        if (LINK(ENTRY_AT(cur), FIELD_HNEXT) == idx) {
+            LINK(ENTRY_AT(cur), FIELD_HNEXT) = LINK(ENTRY_AT(idx), FIELD_HNEXT);
+            return;
+        }
+        cur = LINK(ENTRY_AT(cur), FIELD_HNEXT);
+    }
 }
+#endif
 
 /*
  * Busca y/o actualiza el TLB con política LRU.
@@ -119,6 +213,11 @@ void tlb_init(void)
  *  replaced_address: (salida) dirección base de la entrada reemplazada o NULL.
  *  use_seq: contador de uso creciente (para LRU).
  *
+ * Por defecto la búsqueda recorre sólo la cubeta hash de la página y la
+ * víctima es la cola de la lista de recencia, así que hit, miss y reemplazo
+ * son O(1) sea cual sea TLB_MAX_ENTRIES. Con -DMT_LRU_SCAN se usa el
+ * recorrido de last_used original; ambos eligen las mismas víctimas.
+ *
  * Restricción: máximo 3 variables apuntador locales en esta función.
  */
 
@@ -131,6 +230,7 @@ void tlb_lookup_and_update(uint32_t vaddr,
                            void **replaced_address,
                            unsigned long use_seq)
 {
+#ifdef MT_LRU_SCAN
     unsigned char *entry = tlb_base;      /* 1er apuntador local */
     unsigned char *empty_entry = NULL;    /* 2do apuntador local */
     unsigned char *lru_entry = NULL;      /* 3er apuntador local */
@@ -177,6 +277,39 @@ void tlb_lookup_and_update(uint32_t vaddr,
         entry = lru_entry;
         *replaced_address = (void *)entry;
     }
+#else
+    unsigned char *entry = NULL;          /* 1er apuntador local */
+    uint16_t idx = BUCKET(page);
+
+    /* Búsqueda O(1): sólo la cadena de la cubeta de la página */
+    while (idx != ENTRY_NONE) {
+        entry = ENTRY_AT(idx);
+        if (*(uint32_t *)(entry + FIELD_VADDR) == vaddr) {
+            /* TLB Hit */
+            *hit = 1;
+            *replaced_address = NULL;
+            *(unsigned long *)(entry + FIELD_LAST_USED) = use_seq;
+            lru_touch(idx);
+            return;
+        }
+        idx = LINK(entry, FIELD_HNEXT);
+    }
+
+    /* Miss: la víctima es la cola de la lista (vacía o menos reciente) */
+    *hit = 0;
+    idx = LINK(TLB_META, META_TAIL);
+    entry = ENTRY_AT(idx);
+
+    if (*(int *)(entry + FIELD_VALID)) {
+        *replaced_address = (void *)entry;
+        hash_remove(idx, *(uint32_t *)(entry + FIELD_PAGE_DEC));
+    } else {
+        *replaced_address = NULL;
+    }
+    LINK(entry, FIELD_HNEXT) = BUCKET(page);
+    BUCKET(page) = idx;
+    lru_touch(idx);
+#endif
 
     /* Escritura de la nueva entrada */
     int *valid = (int *)(entry + FIELD_VALID);
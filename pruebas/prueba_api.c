@@ -0,0 +1,205 @@
+/* prueba_api.c
+ * Prueba de la API de traducir.h enlazada sólo con libtraducir.a (sin
+ * traducir.c): configuraciones inválidas, Hit/Miss/reemplazo/Page
+ * Fault de un TLB pequeño, contadores, tlb_translate frente a
+ * tlb_translate_slots y el mismo LRU en todas las disposiciones.
+ *
+ * Compilar y ejecutar:
+ *   make check
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+
+#include "traducir.h"
+
+#define TRAZA_N 20000U
+
+static int fallas = 0;
+
+static void comprobar(int ok, const char *que)
+{
+    if (!ok) {
+        fprintf(stderr, "FALLA: %s\n", que);
+        ++fallas;
+    }
+}
+
+/* tlb_engine_open debe rechazar la configuración con EINVAL */
+static void invalida(unsigned int sets, unsigned int ways, const char *index,
+                     const char *policy, const char *layout, const char *que)
+{
+    tlb_engine *e;
+    errno = 0;
+    e = tlb_engine_open(sets, ways, index, policy, layout);
+    comprobar(e == NULL && errno == EINVAL, que);
+    tlb_engine_close(e);
+}
+
+static void prueba_invalidas(void)
+{
+    invalida(1U, 4U, "hash", NULL, NULL, "índice desconocido");
+    invalida(1U, 4U, NULL, "mru", NULL, "política desconocida");
+    invalida(1U, 4U, NULL, "opt", NULL, "opt necesita la traza");
+    invalida(1U, 4U, NULL, NULL, "csr", "disposición desconocida");
+    invalida(1U, 4U, NULL, "fifo", "compact", "compact sólo con lru");
+    invalida(1U, 4U, NULL, "lru-scan", "compact", "compact con lru-scan");
+    invalida(3U, 4U, NULL, NULL, NULL, "conjuntos no potencia de 2");
+    invalida(0U, 4U, NULL, NULL, NULL, "cero conjuntos");
+    invalida(4U, 0U, NULL, NULL, NULL, "cero vías");
+    invalida(1U, 65535U, NULL, NULL, NULL, "más de 65534 entradas");
+    tlb_engine_close(NULL); /* no hace nada */
+}
+
+/* TLB totalmente asociativo de 4 vías (LRU): páginas 0..3 son Miss
+   sin reemplazo, la 0 es Hit, la 4 reemplaza a la 1 (la menos
+   reciente, en el slot 1) y una dirección de 33 bits es Page Fault. */
+static void prueba_lru(const char *layout)
+{
+    static const uint64_t addrs[] = {
+        0x0123U, 0x1FFFU, 0x2000U, 0x3ABCU, 0x0FFFU, 0x4000U,
+        0x100000000ULL, 0x0004U
+    };
+    static const uint8_t want_res[] = {
+        TLB_RES_MISS, TLB_RES_MISS, TLB_RES_MISS, TLB_RES_MISS,
+        TLB_RES_HIT, TLB_RES_MISS, TLB_RES_FAULT, TLB_RES_HIT
+    };
+    const size_t n = sizeof(addrs) / sizeof(addrs[0]);
+    uint8_t res[8];
+    uint64_t ev[8];
+    uint32_t slots[8];
+    uint64_t hits, misses, evictions, faults;
+    char que[64];
+    size_t i;
+    tlb_engine *e = tlb_engine_open(1U, 4U, "low", "lru", layout);
+
+    snprintf(que, sizeof(que), "abrir 1x4 lru %s", layout);
+    comprobar(e != NULL, que);
+    if (!e) return;
+    tlb_translate_slots(e, addrs, n, res, ev, slots);
+    for (i = 0U; i < n; ++i) {
+        snprintf(que, sizeof(que), "%s: resultado del acceso %zu", layout,
+                 i);
+        comprobar(res[i] == want_res[i], que);
+        snprintf(que, sizeof(que), "%s: reemplazo del acceso %zu", layout,
+                 i);
+        comprobar(i == 5U ? ev[i] == 0x1000U && slots[i] == 1U
+                  : ev[i] == TLB_NO_EVICT && slots[i] == TLB_NO_SLOT, que);
+    }
+    tlb_engine_stats(e, &hits, &misses, &evictions, &faults);
+    snprintf(que, sizeof(que), "%s: contadores", layout);
+    comprobar(hits == 2U && misses == 5U && evictions == 1U && faults == 1U,
+              que);
+    tlb_engine_stats(e, NULL, NULL, NULL, NULL);
+    tlb_engine_close(e);
+}
+
+/* Traza pseudoaleatoria con localidad (xorshift con semilla fija) */
+static void traza(uint64_t *addrs, size_t n)
+{
+    uint64_t x = 0x2545F4914F6CDD1DULL;
+    size_t i;
+    for (i = 0U; i < n; ++i) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        addrs[i] = ((x >> 40) % 96U) << 12 | (x & 0xFFFU);
+    }
+}
+
+/* Traduce la traza con una instancia nueva; devuelve 0 si no abre */
+static int traducir(const uint64_t *addrs, size_t n, unsigned int sets,
+                    unsigned int ways, const char *policy,
+                    const char *layout, uint64_t seed, uint8_t *res,
+                    uint64_t *ev, uint32_t *slots)
+{
+    tlb_engine *e = tlb_engine_open(sets, ways, "xor", policy, layout);
+    if (!e) return 0;
+    if (seed) tlb_engine_seed(e, seed);
+    if (slots) {
+        tlb_translate_slots(e, addrs, n, res, ev, slots);
+    } else {
+        tlb_translate(e, addrs, n, res, ev);
+    }
+    tlb_engine_close(e);
+    return 1;
+}
+
+/* tlb_translate da lo mismo que tlb_translate_slots; la misma semilla
+   repite "random"; LRU (lista o contadores) no depende de la
+   disposición de los slots */
+static void prueba_equivalencias(void)
+{
+    static const char *const politicas[] = {
+        "lru", "fifo", "clock", "plru", "random", "lfu", "arc"
+    };
+    static const char *const lrus[][2] = {
+        { "lru", "soa" }, { "lru", "compact" }, { "lru-scan", "aos" },
+        { "lru-scan", "soa" }
+    };
+    uint64_t *addrs = (uint64_t *)malloc(TRAZA_N * sizeof(uint64_t));
+    uint8_t *res[2];
+    uint64_t *ev[2];
+    uint32_t *slots = (uint32_t *)malloc(TRAZA_N * sizeof(uint32_t));
+    char que[64];
+    unsigned int k;
+
+    res[0] = (uint8_t *)malloc(2U * TRAZA_N);
+    ev[0] = (uint64_t *)malloc(2U * TRAZA_N * sizeof(uint64_t));
+    if (!addrs || !slots || !res[0] || !ev[0]) {
+        perror("malloc prueba");
+        exit(EXIT_FAILURE);
+    }
+    res[1] = res[0] + TRAZA_N;
+    ev[1] = ev[0] + TRAZA_N;
+    traza(addrs, TRAZA_N);
+
+    for (k = 0U; k < sizeof(politicas) / sizeof(politicas[0]); ++k) {
+        snprintf(que, sizeof(que), "%s: translate = translate_slots",
+                 politicas[k]);
+        comprobar(traducir(addrs, TRAZA_N, 8U, 4U, politicas[k], "aos", 7U,
+                           res[0], ev[0], slots)
+                  && traducir(addrs, TRAZA_N, 8U, 4U, politicas[k], "aos",
+                              7U, res[1], ev[1], NULL)
+                  && memcmp(res[0], res[1], TRAZA_N) == 0
+                  && memcmp(ev[0], ev[1], TRAZA_N * sizeof(uint64_t)) == 0,
+                  que);
+    }
+    traducir(addrs, TRAZA_N, 8U, 4U, "random", "aos", 99U, res[1], ev[1],
+             NULL);
+    comprobar(memcmp(ev[0], ev[1], TRAZA_N * sizeof(uint64_t)) != 0,
+              "random: otra semilla, otros reemplazos");
+
+    traducir(addrs, TRAZA_N, 4U, 8U, "lru", "aos", 0U, res[0], ev[0], NULL);
+    for (k = 0U; k < sizeof(lrus) / sizeof(lrus[0]); ++k) {
+        snprintf(que, sizeof(que), "%s %s = lru aos", lrus[k][0],
+                 lrus[k][1]);
+        comprobar(traducir(addrs, TRAZA_N, 4U, 8U, lrus[k][0], lrus[k][1],
+                           0U, res[1], ev[1], NULL)
+                  && memcmp(res[0], res[1], TRAZA_N) == 0
+                  && memcmp(ev[0], ev[1], TRAZA_N * sizeof(uint64_t)) == 0,
+                  que);
+    }
+    free(addrs);
+    free(slots);
+    free(res[0]);
+    free(ev[0]);
+}
+
+int main(void)
+{
+    prueba_invalidas();
+    prueba_lru("aos");
+    prueba_lru("soa");
+    prueba_lru("compact");
+    prueba_equivalencias();
+    if (fallas) {
+        fprintf(stderr, "Error: %d comprobaciones fallaron\n", fallas);
+        return EXIT_FAILURE;
+    }
+    printf("prueba_api: todo correcto\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,1284 @@
+/* tlb.c
+ * Motor del TLB: creación del bloque en heap, búsqueda, inserción,
+ * actualización e invalidación de entradas, las políticas de
+ * reemplazo y la API de biblioteca de traducir.h. Lo usan la línea de
+ * órdenes (traducir.c) y, solo, libtraducir.a.
+ *
+ * Compilar:
+ *   make               traducir, libtraducir.a y mt
+ *   make check         prueba de la API enlazada sólo con libtraducir.a
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include "traducir.h"
+#include "tlb.h"
+
+const char *const tlb_policy_names[POL_COUNT] = {
+    "lru", "fifo", "clock", "plru", "random", "lfu", "arc", "opt"
+};
+
+unsigned int tlb_probe_kind = PROBE_SCALAR;
+_Thread_local uint32_t tlb_policy_hint = 0U;
+
+/* ---------- Gestión del TLB (todas las funciones usan máximo 3
+   variables apuntador char* cuando manipulan el TLB) ---------- */
+
+/* Crea un TLB de sets x ways entradas en el heap y marca las entradas
+   vacías. Dentro de cada conjunto los slots empiezan enlazados de
+   forma que la cola es el primer slot, luego el segundo, etc.: así la
+   víctima de la lista es el primer slot libre, igual que en el
+   recorrido de referencia. Tras las etiquetas SoA van las regiones
+   que necesite la política de reemplazo (montículos, árbol PLRU o las
+   listas y fantasmas de ARC). En la disposición compacta los slots son
+   de CSLOT_SIZE bytes, todos inválidos, y no hay índice hash.
+   No termina el programa: si no hay memoria devuelve NULL con
+   errno = ENOMEM (la API de biblioteca lo informa así). El bloque
+   lleva todo su estado: lista LRU, sondeo escalar y semilla fija
+   (tlb_create los toma de la línea de órdenes).
+   Usa ≤3 punteros: tlb, cur. */
+char *tlb_alloc(unsigned int sets, unsigned int ways, int index_fn,
+                int layout, int policy)
+{
+    unsigned int entries = sets * ways;
+    size_t slots_bytes = (size_t)entries
+        * (layout == LAYOUT_COMPACT ? CSLOT_SIZE : SLOT_SIZE);
+    size_t bytes = slots_bytes > TLB_MAX_BYTES ? slots_bytes : TLB_MAX_BYTES;
+    unsigned int set_bits = 0U;
+    unsigned int hash_bits = 0U;
+    unsigned int leaves = 1U;
+    unsigned int ghash_bits = 0U;
+    unsigned int i;
+
+    while ((1U << set_bits) < sets) ++set_bits;
+    if (ways > PROBE_WAYS_MAX && layout != LAYOUT_COMPACT) {
+        hash_bits = 1U;
+        while ((1U << hash_bits) < 2U * entries) ++hash_bits;
+    }
+    while (leaves < ways) leaves <<= 1;
+    if (policy == POL_ARC) {
+        ghash_bits = 1U;
+        while ((1U << ghash_bits) < 2U * entries) ++ghash_bits;
+    }
+    size_t sets_off = TLB_HDR_SIZE + ((bytes + 3U) & ~(size_t)3U);
+    size_t hash_off = sets_off + (size_t)sets * SET_SIZE;
+    size_t tags_off = (hash_off
+        + (hash_bits ? ((size_t)1U << hash_bits) * 2U : 0U) + 31U)
+        & ~(size_t)31U;
+    unsigned int stride = (ways + 7U) & ~7U;
+    size_t tags_bytes = layout == LAYOUT_SOA
+        ? (size_t)sets * stride * sizeof(uint32_t) : 0U;
+    size_t heap_off = tags_off + tags_bytes;
+    size_t heap_bytes = (policy == POL_LFU || policy == POL_OPT)
+        ? (size_t)entries * 4U : 0U;
+    size_t plru_off = (heap_off + heap_bytes + 7U) & ~(size_t)7U;
+    unsigned int plru_stride = policy == POL_PLRU
+        ? (leaves + 63U) / 64U * 8U : 0U;
+    size_t arc_off = plru_off + (size_t)sets * plru_stride;
+    size_t ghost_off = arc_off + (policy == POL_ARC
+                                  ? (size_t)sets * ARC_SIZE : 0U);
+    size_t ghash_off = ghost_off + (policy == POL_ARC
+                                    ? (size_t)entries * GHOST_SIZE : 0U);
+    size_t total = ghash_off
+        + (ghash_bits ? ((size_t)1U << ghash_bits) * 2U : 0U) + 32U;
+
+    /* alineado a 64 bytes para que cada conjunto de etiquetas quede
+       alineado a 32 (AVX2) */
+    char *tlb = (char *)aligned_alloc(64U, (total + 63U) & ~(size_t)63U);
+    if (!tlb) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    memset(tlb, 0, TLB_HDR_SIZE);
+    FIELD32(tlb, H_ENTRIES) = entries;
+    FIELD32(tlb, H_SETS) = sets;
+    FIELD32(tlb, H_WAYS) = ways;
+    FIELD32(tlb, H_SET_BITS) = set_bits;
+    FIELD32(tlb, H_INDEX) = (uint32_t)index_fn;
+    FIELD32(tlb, H_BYTES) = (uint32_t)bytes;
+    FIELD32(tlb, H_SETS_OFF) = (uint32_t)sets_off;
+    FIELD32(tlb, H_HASH_OFF) = (uint32_t)hash_off;
+    FIELD32(tlb, H_HASH_BITS) = hash_bits;
+    FIELD32(tlb, H_COUNTER) = 1U;
+    FIELD32(tlb, H_LAYOUT) = (uint32_t)layout;
+    FIELD32(tlb, H_TAGS_OFF) = (uint32_t)tags_off;
+    FIELD32(tlb, H_TAG_STRIDE) = stride;
+    FIELD32(tlb, H_POLICY) = (uint32_t)policy;
+    FIELD32(tlb, H_HEAP_OFF) = (uint32_t)heap_off;
+    FIELD32(tlb, H_PLRU_OFF) = (uint32_t)plru_off;
+    FIELD32(tlb, H_PLRU_STRIDE) = plru_stride;
+    FIELD32(tlb, H_PLRU_LEAVES) = leaves;
+    FIELD32(tlb, H_ARC_OFF) = (uint32_t)arc_off;
+    FIELD32(tlb, H_GHOST_OFF) = (uint32_t)ghost_off;
+    FIELD32(tlb, H_GHASH_OFF) = (uint32_t)ghash_off;
+    FIELD32(tlb, H_GHASH_BITS) = ghash_bits;
+    FIELD32(tlb, H_TOTAL) = (uint32_t)total;
+    FIELD32(tlb, H_LRU_MODE) = LRU_LIST;
+    FIELD32(tlb, H_PROBE) = PROBE_SCALAR;
+    FIELD32(tlb, H_ARC_TARGET) = 1U;
+    FIELD64(tlb, H_RNG) = TLB_RNG_SEED;
+
+    /* marcar entradas como vacías: page = UINT32_MAX */
+    char *cur;
+    if (layout == LAYOUT_COMPACT) memset(TLB_SLOTS(tlb), 0, slots_bytes);
+    for (i = 0U; i < entries && layout != LAYOUT_COMPACT; ++i) {
+        unsigned int way = i % ways;
+        cur = SLOT_AT(tlb, i);
+        /* page = UINT32_MAX indica slot vacío */
+        *((uint32_t *)(cur + OFF_PAGE)) = UINT32_MAX;
+        /* lru = 0 */
+        *((uint32_t *)(cur + OFF_LRU)) = 0U;
+        /* base pointer = 0 */
+        *((uintptr_t *)(cur + OFF_BASE)) = (uintptr_t)0;
+        /* limpiar cadenas binarias por claridad (opcional) */
+        memset(cur + OFF_PAGE_BIN, 0, PAGE_BIN_SIZE);
+        memset(cur + OFF_OFF_BIN, 0, OFF_BIN_SIZE);
+        /* lista del conjunto: cabeza = última vía, cola = vía 0 */
+        FIELD16(cur, OFF_PREV) = (uint16_t)(way + 1U < ways
+                                            ? i + 1U : SLOT_NONE);
+        FIELD16(cur, OFF_NEXT) = (uint16_t)(way > 0U ? i - 1U : SLOT_NONE);
+        FIELD16(cur, OFF_HNEXT) = (uint16_t)SLOT_NONE;
+    }
+    for (i = 0U; i < sets; ++i) {
+        cur = SET_AT(tlb, i);
+        FIELD16(cur, SET_HEAD) = (uint16_t)(i * ways + ways - 1U);
+        FIELD16(cur, SET_TAIL) = (uint16_t)(i * ways);
+        FIELD16(cur, SET_HAND) = 0U;
+        FIELD16(cur, SET_COUNT) = 0U;
+    }
+    if (hash_bits) memset(BUCKET_AT(tlb, 0), 0xFF, (size_t)2U << hash_bits);
+    if (tags_bytes) memset(TAGS_AT(tlb, 0), 0xFF, tags_bytes);
+    if (plru_stride) memset(PLRU_AT(tlb, 0), 0, (size_t)sets * plru_stride);
+    if (policy == POL_ARC) {
+        /* listas vacías (0xFFFF), contadores y p a cero; los fantasmas
+           de cada conjunto encadenados en su lista libre */
+        for (i = 0U; i < sets; ++i) {
+            cur = ARC_AT(tlb, i);
+            memset(cur, 0xFF, ARC_FREE);
+            memset(cur + ARC_NT1, 0, ARC_SIZE - ARC_NT1);
+            FIELD16(cur, ARC_FREE) = (uint16_t)(i * ways);
+        }
+        for (i = 0U; i < entries; ++i) {
+            cur = GHOST_AT(tlb, i);
+            FIELD32(cur, G_PAGE) = UINT32_MAX;
+            FIELD16(cur, G_NEXT) = (uint16_t)(i % ways + 1U < ways
+                                              ? i + 1U : SLOT_NONE);
+            FIELD16(cur, G_LIST) = 0U;
+        }
+        memset(GBUCKET_AT(tlb, 0), 0xFF, (size_t)2U << ghash_bits);
+    }
+    return tlb;
+}
+
+/* Semilla de RANDOM del TLB (0 dejaría a xorshift fijo en 0) */
+void tlb_seed(char *tlb, uint64_t seed)
+{
+    FIELD64(tlb, H_RNG) = seed ? seed : 1U;
+}
+
+/* Libera un TLB creado con tlb_alloc o tlb_create */
+void tlb_destroy(char *tlb)
+{
+    free(tlb);
+}
+
+/* Cubeta del índice hash para un número de página (hash multiplicativo) */
+static inline unsigned int hash_bucket(const char *tlb, uint32_t page_num)
+{
+    return (unsigned int)((page_num * 0x9E3779B1U)
+                          >> (32U - FIELD32(tlb, H_HASH_BITS)));
+}
+
+/* Agrega el slot idx a la cadena de su cubeta.
+   Usa ≤3 punteros: tlb, cur, bucket. */
+static void hash_insert(char *tlb, uint16_t idx)
+{
+    char *cur = SLOT_AT(tlb, idx);
+    char *bucket = BUCKET_AT(tlb,
+        hash_bucket(tlb, *((uint32_t *)(cur + OFF_PAGE))));
+    FIELD16(cur, OFF_HNEXT) = FIELD16(bucket, 0);
+    FIELD16(bucket, 0) = idx;
+}
+
+/* Quita el slot idx de la cadena de su cubeta.
+   Usa ≤3 punteros: tlb, cur, link (enlace que apunta a cur). */
+static void hash_remove(char *tlb, uint16_t idx)
+{
+    char *cur = SLOT_AT(tlb, idx);
+    char *link = BUCKET_AT(tlb,
+        hash_bucket(tlb, *((uint32_t *)(cur + OFF_PAGE))));
+    while (FIELD16(link, 0) != idx) {
+        link = SLOT_AT(tlb, FIELD16(link, 0)) + OFF_HNEXT;
+    }
+    FIELD16(link, 0) = FIELD16(cur, OFF_HNEXT);
+}
+
+/* Desengancha el nodo idx de la lista 'ht'.
+   Usa ≤3 punteros: nodes, ht, cur. */
+static void dl_unlink(char *nodes, size_t stride, char *ht, uint16_t idx)
+{
+    char *cur = DL_AT(nodes, stride, idx);
+    uint16_t prev = FIELD16(cur, 0);
+    uint16_t next = FIELD16(cur, 2);
+    if (prev != SLOT_NONE) {
+        FIELD16(DL_AT(nodes, stride, prev), 2) = next;
+    } else {
+        FIELD16(ht, 0) = next;
+    }
+    if (next != SLOT_NONE) {
+        FIELD16(DL_AT(nodes, stride, next), 0) = prev;
+    } else {
+        FIELD16(ht, 2) = prev;
+    }
+}
+
+/* Inserta el nodo idx en la cabeza de la lista 'ht'.
+   Usa ≤3 punteros: nodes, ht, cur. */
+static void dl_push_front(char *nodes, size_t stride, char *ht, uint16_t idx)
+{
+    char *cur = DL_AT(nodes, stride, idx);
+    uint16_t head = FIELD16(ht, 0);
+    FIELD16(cur, 0) = (uint16_t)SLOT_NONE;
+    FIELD16(cur, 2) = head;
+    if (head != SLOT_NONE) {
+        FIELD16(DL_AT(nodes, stride, head), 0) = idx;
+    } else {
+        FIELD16(ht, 2) = idx;
+    }
+    FIELD16(ht, 0) = idx;
+}
+
+/* Inserta el nodo idx en la cola de la lista 'ht'.
+   Usa ≤3 punteros: nodes, ht, cur. */
+static void dl_push_back(char *nodes, size_t stride, char *ht, uint16_t idx)
+{
+    char *cur = DL_AT(nodes, stride, idx);
+    uint16_t tail = FIELD16(ht, 2);
+    FIELD16(cur, 2) = (uint16_t)SLOT_NONE;
+    FIELD16(cur, 0) = tail;
+    if (tail != SLOT_NONE) {
+        FIELD16(DL_AT(nodes, stride, tail), 2) = idx;
+    } else {
+        FIELD16(ht, 0) = idx;
+    }
+    FIELD16(ht, 2) = idx;
+}
+
+/* Desengancha el slot idx de la lista de recencia de su conjunto. */
+static inline void lru_unlink(char *tlb, uint16_t idx)
+{
+    dl_unlink(SLOT_LINKS(tlb), SLOT_SIZE,
+              SET_AT(tlb, idx / FIELD32(tlb, H_WAYS)), idx);
+}
+
+/* Inserta el slot idx como el más reciente de su conjunto. */
+static inline void lru_push_front(char *tlb, uint16_t idx)
+{
+    dl_push_front(SLOT_LINKS(tlb), SLOT_SIZE,
+                  SET_AT(tlb, idx / FIELD32(tlb, H_WAYS)), idx);
+}
+
+/* Inserta el slot idx como el menos reciente de su conjunto (próxima
+   víctima, o último de la lista libre). */
+static inline void lru_push_back(char *tlb, uint16_t idx)
+{
+    dl_push_back(SLOT_LINKS(tlb), SLOT_SIZE,
+                 SET_AT(tlb, idx / FIELD32(tlb, H_WAYS)), idx);
+}
+
+/* Escribe el contenido de una entrada nueva en el slot 'cur' y, en la
+   disposición SoA, su copia en el arreglo de etiquetas.
+   Usa ≤3 punteros: tlb, cur (no declara más). */
+static inline void slot_fill(char *tlb, char *cur, uint32_t page_num,
+                             uint32_t offset_num,
+                             const char *page_bin, const char *off_bin)
+{
+    if (FIELD32(tlb, H_LAYOUT) == LAYOUT_SOA) {
+        uint32_t ways = FIELD32(tlb, H_WAYS);
+        uint32_t idx = SLOT_INDEX(tlb, cur);
+        TAGS_AT(tlb, idx / ways)[idx % ways] = page_num;
+    }
+    *((uintptr_t *)(cur + OFF_BASE)) = (uintptr_t)cur;
+    *((uint32_t *)(cur + OFF_PAGE)) = page_num;
+    *((uint32_t *)(cur + OFF_OFFS)) = offset_num;
+    memcpy(cur + OFF_PAGE_BIN, page_bin, PAGE_BIN_SIZE);
+    memcpy(cur + OFF_OFF_BIN, off_bin, OFF_BIN_SIZE);
+}
+
+/* ---------- Entradas compactas (disposición compacta) ---------- */
+
+/* La edad es la marca del contador H_COUNTER del TLB en el último uso
+   (como en --lru scan): un acierto sólo reescribe su propio uint64 y la
+   víctima de un conjunto lleno es la de marca mínima, que se busca
+   únicamente en los Miss. Cuando el contador llega a CSLOT_AGE_MAX las
+   marcas de cada conjunto se renumeran conservando su orden. Una
+   entrada inválida guarda en la edad la marca de su invalidación (0 si
+   nunca se usó): el próximo llenado del conjunto toma la inválida más
+   reciente, igual que la lista de las otras disposiciones. */
+
+/* Renumera las marcas de cada conjunto a 1..n en el mismo orden (las
+   válidas por un lado y las de invalidación por otro) y deja el
+   contador a continuación (ocurre cada ~2^31 accesos).
+   Usa ≤3 punteros: tlb, start, cur. */
+static void compact_renumber(char *tlb)
+{
+    uint32_t ways = FIELD32(tlb, H_WAYS);
+    uint32_t sets = FIELD32(tlb, H_SETS);
+    uint32_t *rank = (uint32_t *)malloc(ways * sizeof(uint32_t));
+    uint32_t s, i, j;
+    char *start;
+    char *cur;
+    if (!rank) {
+        perror("malloc marcas");
+        exit(EXIT_FAILURE);
+    }
+    for (s = 0U; s < sets; ++s) {
+        start = CSLOT_AT(tlb, s * ways);
+        /* rango de cada marca: 1 + cuántas del mismo tipo (válidas o
+           inválidas con marca) del conjunto la preceden */
+        for (i = 0U; i < ways; ++i) {
+            uint64_t e = FIELD64(start, (size_t)i * CSLOT_SIZE);
+            rank[i] = CSLOT_AGE(e) != 0U;
+            for (j = 0U, cur = start; j < ways && rank[i]; ++j,
+                 cur += CSLOT_SIZE) {
+                uint64_t o = FIELD64(cur, 0);
+                if (((o ^ e) & CSLOT_VALID) == 0U && CSLOT_AGE(o) != 0U
+                    && CSLOT_AGE(o) < CSLOT_AGE(e)) {
+                    ++rank[i];
+                }
+            }
+        }
+        for (i = 0U, cur = start; i < ways; ++i, cur += CSLOT_SIZE) {
+            uint64_t e = FIELD64(cur, 0);
+            FIELD64(cur, 0) = (e & (CSLOT_VALID | UINT32_MAX))
+                | ((uint64_t)rank[i] << CSLOT_AGE_SHIFT);
+        }
+    }
+    free(rank);
+    FIELD32(tlb, H_COUNTER) = ways + 1U;
+}
+
+/* Próxima marca del TLB */
+static inline uint64_t compact_stamp(char *tlb)
+{
+    if (FIELD32(tlb, H_COUNTER) == CSLOT_AGE_MASK) compact_renumber(tlb);
+    return (uint64_t)FIELD32(tlb, H_COUNTER)++ << CSLOT_AGE_SHIFT;
+}
+
+/* tlb_insert de la disposición compacta: el slot inválido del conjunto
+   con la marca de invalidación más reciente (a igual marca, la primera
+   vía) o, si está lleno, el de marca mínima. La "dirección base"
+   reemplazada es la de la propia entrada.
+   Usa ≤3 punteros: tlb, cur, victim. */
+static uintptr_t compact_insert(char *tlb, uint32_t page_num,
+                                uint32_t *evicted)
+{
+    uint32_t ways = FIELD32(tlb, H_WAYS);
+    uint64_t stamp = compact_stamp(tlb);
+    char *cur = CSLOT_AT(tlb, tlb_set_of(tlb, page_num) * ways);
+    char *victim = cur;
+    uint64_t min_age = UINT64_MAX;
+    uint32_t empty = UINT32_MAX, empty_age = 0U;
+    uint32_t i;
+    for (i = 0U; i < ways; ++i, cur += CSLOT_SIZE) {
+        uint64_t e = FIELD64(cur, 0);
+        if (!(e & CSLOT_VALID)) {
+            if (empty == UINT32_MAX || CSLOT_AGE(e) > empty_age) {
+                empty = i;
+                empty_age = CSLOT_AGE(e);
+            }
+        } else if (CSLOT_AGE(e) < min_age) {
+            min_age = CSLOT_AGE(e);
+            victim = cur;
+        }
+    }
+    if (empty != UINT32_MAX) {
+        cur -= (size_t)(ways - empty) * CSLOT_SIZE;
+        FIELD64(cur, 0) = CSLOT_VALID | stamp | page_num;
+        return (uintptr_t)0;
+    }
+    if (evicted) *evicted = (uint32_t)FIELD64(victim, 0);
+    FIELD64(victim, 0) = CSLOT_VALID | stamp | page_num;
+    return (uintptr_t)victim;
+}
+
+/* Acierto: la entrada recibe una marca nueva.
+   Usa ≤3 punteros: tlb, slot_ptr. */
+static inline void compact_touch(char *tlb, char *slot_ptr)
+{
+    uint64_t stamp = compact_stamp(tlb);
+    FIELD64(slot_ptr, 0) = (FIELD64(slot_ptr, 0)
+                            & ~(CSLOT_AGE_MASK << CSLOT_AGE_SHIFT)) | stamp;
+}
+
+
+/* ---------- Sondeo SIMD de etiquetas (disposición SoA) ---------- */
+
+/* Cada función compara 'page' con n etiquetas contiguas (n múltiplo de
+   8, alineadas a 32 bytes) y devuelve la vía que coincide o -1. La
+   versión se elige una vez en tiempo de ejecución según la CPU. */
+static int tags_probe_scalar(const uint32_t *tags, unsigned int n,
+                             uint32_t page)
+{
+    unsigned int i;
+    for (i = 0U; i < n; ++i) {
+        if (tags[i] == page) return (int)i;
+    }
+    return -1;
+}
+
+/* Lo mismo para las n entradas compactas de un conjunto (n cualquiera,
+   alineadas sólo a 8): validez y etiqueta se comparan con una sola
+   operación sobre cada uint64; want = CSLOT_VALID | etiqueta. */
+static int cslots_probe_scalar(const uint64_t *slots, unsigned int n,
+                               uint64_t want)
+{
+    unsigned int i;
+    for (i = 0U; i < n; ++i) {
+        if ((slots[i] & (CSLOT_VALID | UINT32_MAX)) == want) return (int)i;
+    }
+    return -1;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+__attribute__((target("sse2")))
+static int tags_probe_sse2(const uint32_t *tags, unsigned int n,
+                           uint32_t page)
+{
+    __m128i key = _mm_set1_epi32((int)page);
+    unsigned int i;
+    for (i = 0U; i < n; i += 4U) {
+        __m128i v = _mm_load_si128((const __m128i *)(tags + i));
+        int m = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(v, key)));
+        if (m) return (int)i + __builtin_ctz((unsigned int)m);
+    }
+    return -1;
+}
+
+__attribute__((target("avx2")))
+static int tags_probe_avx2(const uint32_t *tags, unsigned int n,
+                           uint32_t page)
+{
+    __m256i key = _mm256_set1_epi32((int)page);
+    unsigned int i;
+    for (i = 0U; i < n; i += 8U) {
+        __m256i v = _mm256_load_si256((const __m256i *)(tags + i));
+        int m = _mm256_movemask_ps(
+            _mm256_castsi256_ps(_mm256_cmpeq_epi32(v, key)));
+        if (m) return (int)i + __builtin_ctz((unsigned int)m);
+    }
+    return -1;
+}
+
+__attribute__((target("avx2")))
+static int cslots_probe_avx2(const uint64_t *slots, unsigned int n,
+                             uint64_t want)
+{
+    __m256i key = _mm256_set1_epi64x((long long)want);
+    __m256i mask = _mm256_set1_epi64x((long long)(CSLOT_VALID | UINT32_MAX));
+    unsigned int i;
+    for (i = 0U; i + 4U <= n; i += 4U) {
+        __m256i v = _mm256_and_si256(
+            _mm256_loadu_si256((const __m256i *)(slots + i)), mask);
+        int m = _mm256_movemask_pd(
+            _mm256_castsi256_pd(_mm256_cmpeq_epi64(v, key)));
+        if (m) return (int)i + __builtin_ctz((unsigned int)m);
+    }
+    for (; i < n; ++i) {
+        if ((slots[i] & (CSLOT_VALID | UINT32_MAX)) == want) return (int)i;
+    }
+    return -1;
+}
+#endif
+
+/* Versiones del sondeo, indexadas por H_PROBE de cada TLB. Las
+   entradas compactas usan AVX2 o el escalar (SSE2 no compara enteros
+   de 64 bits). */
+#if defined(__x86_64__) || defined(__i386__)
+static int (*const tags_probes[])(const uint32_t *, unsigned int, uint32_t) = {
+    tags_probe_scalar, tags_probe_sse2, tags_probe_avx2
+};
+static int (*const cslots_probes[])(const uint64_t *, unsigned int,
+                                    uint64_t) = {
+    cslots_probe_scalar, cslots_probe_scalar, cslots_probe_avx2
+};
+#else
+static int (*const tags_probes[])(const uint32_t *, unsigned int, uint32_t) = {
+    tags_probe_scalar, tags_probe_scalar, tags_probe_scalar
+};
+static int (*const cslots_probes[])(const uint64_t *, unsigned int,
+                                    uint64_t) = {
+    cslots_probe_scalar, cslots_probe_scalar, cslots_probe_scalar
+};
+#endif
+const char *tlb_tags_probe_name = "escalar";
+const char *tlb_cslots_probe_name = "escalar";
+static int probe_chosen = 0;  /* ya hubo un tlb_select_probe (--simd) */
+
+/* Elige la versión del sondeo: "auto" detecta la CPU; "avx2", "sse2"
+   o "scalar" la fuerzan. Devuelve 0 si la pedida no está disponible. */
+int tlb_select_probe(const char *want)
+{
+    int is_auto = strcmp(want, "auto") == 0;
+    probe_chosen = 1;
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if ((is_auto || strcmp(want, "avx2") == 0)
+        && __builtin_cpu_supports("avx2")) {
+        tlb_probe_kind = PROBE_AVX2;
+        tlb_tags_probe_name = "avx2";
+        tlb_cslots_probe_name = "avx2";
+        return 1;
+    }
+    if ((is_auto || strcmp(want, "sse2") == 0)
+        && __builtin_cpu_supports("sse2")) {
+        tlb_probe_kind = PROBE_SSE2;
+        tlb_tags_probe_name = "sse2";
+        tlb_cslots_probe_name = "escalar";
+        return 1;
+    }
+#endif
+    if (is_auto || strcmp(want, "scalar") == 0) {
+        tlb_probe_kind = PROBE_SCALAR;
+        tlb_tags_probe_name = "escalar";
+        tlb_cslots_probe_name = "escalar";
+        return 1;
+    }
+    return 0;
+}
+
+/* Busca en el TLB la entrada cuya page == page_num.
+   Devuelve puntero al slot (char*) o NULL. Sólo se miran las vías del
+   conjunto indexado (o la cadena de su cubeta hash si hay muchas vías).
+   En la disposición SoA se comparan todas las etiquetas del conjunto
+   con SIMD (tags_probes[H_PROBE]); en la compacta, sus uint64
+   (cslots_probes[H_PROBE]).
+   Usa ≤3 punteros: tlb, start, cur. */
+char *tlb_find(char *tlb, uint32_t page_num)
+{
+    uint32_t ways = FIELD32(tlb, H_WAYS);
+    char *cur;
+    uint32_t i;
+
+    if (FIELD32(tlb, H_LAYOUT) == LAYOUT_COMPACT) {
+        cur = CSLOT_AT(tlb, tlb_set_of(tlb, page_num) * ways);
+        int way = cslots_probes[FIELD32(tlb, H_PROBE)](
+            (const uint64_t *)cur, ways, CSLOT_VALID | page_num);
+        return way < 0 ? NULL : cur + (size_t)way * CSLOT_SIZE;
+    }
+    if (FIELD32(tlb, H_LAYOUT) == LAYOUT_SOA) {
+        unsigned int set = tlb_set_of(tlb, page_num);
+        int way = tags_probes[FIELD32(tlb, H_PROBE)](
+            TAGS_AT(tlb, set), FIELD32(tlb, H_TAG_STRIDE), page_num);
+        return way < 0 ? NULL : SLOT_AT(tlb, set * ways + (uint32_t)way);
+    }
+
+    if (ways <= PROBE_WAYS_MAX || FIELD32(tlb, H_LRU_MODE) == LRU_SCAN) {
+        char *start = SLOT_AT(tlb, tlb_set_of(tlb, page_num) * ways);
+        for (i = 0U; i < ways; ++i) {
+            cur = start + (size_t)i * (size_t)SLOT_SIZE;
+            if (*((uint32_t *)(cur + OFF_PAGE)) == page_num) return cur;
+        }
+        return NULL;
+    }
+
+    uint16_t idx = FIELD16(BUCKET_AT(tlb, hash_bucket(tlb, page_num)), 0);
+    while (idx != SLOT_NONE) {
+        cur = SLOT_AT(tlb, idx);
+        if (*((uint32_t *)(cur + OFF_PAGE)) == page_num) return cur;
+        idx = FIELD16(cur, OFF_HNEXT);
+    }
+    return NULL;
+}
+
+/* Versión de referencia de tlb_insert: dentro del conjunto primero
+   busca un slot vacío (el invalidado más tarde: tlb_invalidate le deja
+   la marca en OFF_LRU; a igual marca, el primero) y luego la víctima
+   con el menor contador OFF_LRU.
+   Usa ≤3 punteros: tlb, cur, victim. */
+static uintptr_t tlb_insert_scan(char *tlb, unsigned int set,
+                                 uint32_t page_num, uint32_t offset_num,
+                                 const char *page_bin, const char *off_bin,
+                                 uint32_t *evicted)
+{
+    char *cur = NULL;
+    char *victim = NULL; /* se usa también como candidato LRU */
+    unsigned int ways = FIELD32(tlb, H_WAYS);
+    uint32_t stamp = FIELD32(tlb, H_COUNTER)++;
+    unsigned int i;
+
+    /* 1) Buscar slot vacío */
+    for (i = 0U; i < ways; ++i) {
+        cur = SLOT_AT(tlb, set * ways + i);
+        uint32_t p = *((uint32_t *)(cur + OFF_PAGE));
+        if (p == UINT32_MAX && (!victim || *((uint32_t *)(cur + OFF_LRU))
+                                > *((uint32_t *)(victim + OFF_LRU)))) {
+            victim = cur;
+        }
+    }
+    if (victim) {
+        /* slot vacío -> insertar aquí (guardamos la dirección del slot) */
+        slot_fill(tlb, victim, page_num, offset_num, page_bin, off_bin);
+        *((uint32_t *)(victim + OFF_LRU)) = stamp;
+        return (uintptr_t)0; /* no hubo reemplazo */
+    }
+
+    /* 2) Conjunto lleno -> buscar victim por LRU (min) usando 'victim' */
+    uint32_t min_lru = UINT32_MAX;
+    for (i = 0U; i < ways; ++i) {
+        cur = SLOT_AT(tlb, set * ways + i);
+        uint32_t l = *((uint32_t *)(cur + OFF_LRU));
+        if (l < min_lru) { min_lru = l; victim = cur; }
+    }
+
+    if (victim) {
+        uintptr_t replaced_base = *((uintptr_t *)(victim + OFF_BASE));
+        if (evicted) *evicted = *((uint32_t *)(victim + OFF_PAGE));
+        /* reemplazar contenido de victim */
+        slot_fill(tlb, victim, page_num, offset_num, page_bin, off_bin);
+        *((uint32_t *)(victim + OFF_LRU)) = stamp;
+        return replaced_base;
+    }
+    return (uintptr_t)0;
+}
+
+/* ---------- Políticas de reemplazo ---------- */
+
+/* Montículo mínimo (LFU / OPT) de los slots ocupados de un conjunto,
+   con clave OFF_LRU: número de accesos en LFU y el complemento de la
+   próxima referencia en OPT (la más lejana queda arriba). HEAP_POS
+   guarda la posición de cada slot para poder moverlo en O(log vías). */
+#define HEAP_KEY(t, i) FIELD32(SLOT_AT(t, i), OFF_LRU)
+
+static void heap_sift(char *tlb, uint16_t *heap, unsigned int n,
+                      unsigned int k)
+{
+    uint16_t idx = heap[k];
+    uint32_t key = HEAP_KEY(tlb, idx);
+
+    while (k > 0U && HEAP_KEY(tlb, heap[(k - 1U) / 2U]) > key) {
+        heap[k] = heap[(k - 1U) / 2U];
+        HEAP_POS(tlb, heap[k]) = (uint16_t)k;
+        k = (k - 1U) / 2U;
+    }
+    for (;;) {
+        unsigned int c = 2U * k + 1U;
+        if (c >= n) break;
+        if (c + 1U < n && HEAP_KEY(tlb, heap[c + 1U]) < HEAP_KEY(tlb, heap[c]))
+            ++c;
+        if (HEAP_KEY(tlb, heap[c]) >= key) break;
+        heap[k] = heap[c];
+        HEAP_POS(tlb, heap[k]) = (uint16_t)k;
+        k = c;
+    }
+    heap[k] = idx;
+    HEAP_POS(tlb, idx) = (uint16_t)k;
+}
+
+static void heap_push(char *tlb, unsigned int set, uint16_t idx)
+{
+    uint16_t *heap = HEAP_AT(tlb, set);
+    unsigned int n = FIELD16(SET_AT(tlb, set), SET_COUNT)++;
+    heap[n] = idx;
+    heap_sift(tlb, heap, n + 1U, n);
+}
+
+static void heap_remove(char *tlb, unsigned int set, uint16_t idx)
+{
+    uint16_t *heap = HEAP_AT(tlb, set);
+    unsigned int n = --FIELD16(SET_AT(tlb, set), SET_COUNT);
+    unsigned int k = HEAP_POS(tlb, idx);
+    if (k == n) return;
+    heap[k] = heap[n];
+    heap_sift(tlb, heap, n, k);
+}
+
+/* Árbol pseudo-LRU: nodos 1..hojas-1 (hijos 2n y 2n+1), bit 0 = la
+   víctima está a la izquierda. Si las vías no son potencia de 2 las
+   hojas sobrantes nunca se eligen. */
+#define PLRU_GET(b, n) (((b)[(n) >> 3] >> ((n) & 7U)) & 1U)
+
+static void plru_touch(char *tlb, unsigned int set, unsigned int way)
+{
+    unsigned char *bits = PLRU_AT(tlb, set);
+    unsigned int n = way + FIELD32(tlb, H_PLRU_LEAVES);
+    while (n > 1U) {
+        unsigned int parent = n >> 1;
+        /* apuntar al hermano: lejos del recién usado */
+        if (n & 1U) bits[parent >> 3] &= (unsigned char)~(1U << (parent & 7U));
+        else bits[parent >> 3] |= (unsigned char)(1U << (parent & 7U));
+        n = parent;
+    }
+}
+
+static unsigned int plru_victim(char *tlb, unsigned int set)
+{
+    const unsigned char *bits = PLRU_AT(tlb, set);
+    unsigned int leaves = FIELD32(tlb, H_PLRU_LEAVES);
+    unsigned int span = leaves;
+    unsigned int n = 1U;
+    while (n < leaves) {
+        unsigned int child = 2U * n + PLRU_GET(bits, n);
+        span >>= 1;
+        if (child * span - leaves >= FIELD32(tlb, H_WAYS)) child = 2U * n;
+        n = child;
+    }
+    return n - leaves;
+}
+
+/* xorshift64 con el estado H_RNG del TLB: víctima uniforme para
+   RANDOM (reproducible con --seed) */
+static inline unsigned int random_way(char *tlb, unsigned int ways)
+{
+    uint64_t x = FIELD64(tlb, H_RNG);
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    FIELD64(tlb, H_RNG) = x;
+    return (unsigned int)(((x >> 32) * ways) >> 32);
+}
+
+/* ARC (Megiddo y Modha) por conjunto con c = vías. Los fantasmas se
+   buscan por página con su propio índice hash. arc_victim deja en
+   H_ARC_TARGET la lista (T1 = 1, T2 = 2) donde entra el slot que
+   llena a continuación policy_fill. */
+
+static inline unsigned int ghost_bucket(const char *tlb, uint32_t page_num)
+{
+    return (unsigned int)((page_num * 0x9E3779B1U)
+                          >> (32U - FIELD32(tlb, H_GHASH_BITS)));
+}
+
+/* Fantasma de page_num o SLOT_NONE.
+   Usa ≤3 punteros: tlb, cur. */
+static uint16_t ghost_find(char *tlb, uint32_t page_num)
+{
+    uint16_t g = FIELD16(GBUCKET_AT(tlb, ghost_bucket(tlb, page_num)), 0);
+    while (g != SLOT_NONE) {
+        char *cur = GHOST_AT(tlb, g);
+        if (FIELD32(cur, G_PAGE) == page_num) break;
+        g = FIELD16(cur, G_HNEXT);
+    }
+    return g;
+}
+
+/* Saca el fantasma g de su lista (B1 o B2) y del hash y lo devuelve a
+   la lista libre del conjunto.
+   Usa ≤3 punteros: tlb, arc, cur. */
+static void ghost_remove(char *tlb, unsigned int set, uint16_t g)
+{
+    char *arc = ARC_AT(tlb, set);
+    char *cur = GHOST_AT(tlb, g);
+    int b2 = FIELD16(cur, G_LIST) == 2U;
+
+    dl_unlink(GHOST_LINKS(tlb), GHOST_SIZE, arc + (b2 ? ARC_B2 : ARC_B1), g);
+    --FIELD16(arc, b2 ? ARC_NB2 : ARC_NB1);
+    /* quitar del hash: 'arc' pasa a ser el enlace que apunta a g */
+    arc = GBUCKET_AT(tlb, ghost_bucket(tlb, FIELD32(cur, G_PAGE)));
+    while (FIELD16(arc, 0) != g) {
+        arc = GHOST_AT(tlb, FIELD16(arc, 0)) + G_HNEXT;
+    }
+    FIELD16(arc, 0) = FIELD16(cur, G_HNEXT);
+    arc = ARC_AT(tlb, set);
+    FIELD32(cur, G_PAGE) = UINT32_MAX;
+    FIELD16(cur, G_LIST) = 0U;
+    FIELD16(cur, G_NEXT) = FIELD16(arc, ARC_FREE);
+    FIELD16(arc, ARC_FREE) = g;
+}
+
+/* Recuerda page_num como MRU de B1 (list = 1) o B2 (list = 2).
+   Usa ≤3 punteros: tlb, arc, cur. */
+static void ghost_add(char *tlb, unsigned int set, unsigned int list,
+                      uint32_t page_num)
+{
+    char *arc = ARC_AT(tlb, set);
+    uint16_t g = FIELD16(arc, ARC_FREE);
+
+    if (g == SLOT_NONE) {
+        /* no debería ocurrir (|B1| + |B2| <= c): se sacrifica el
+           fantasma más viejo */
+        ghost_remove(tlb, set, FIELD16(arc, FIELD16(arc, ARC_NB2)
+                                       ? ARC_B2 + 2U : ARC_B1 + 2U));
+        g = FIELD16(arc, ARC_FREE);
+    }
+    char *cur = GHOST_AT(tlb, g);
+    FIELD16(arc, ARC_FREE) = FIELD16(cur, G_NEXT);
+    FIELD32(cur, G_PAGE) = page_num;
+    FIELD16(cur, G_LIST) = (uint16_t)list;
+    dl_push_front(GHOST_LINKS(tlb), GHOST_SIZE,
+                  arc + (list == 2U ? ARC_B2 : ARC_B1), g);
+    ++FIELD16(arc, list == 2U ? ARC_NB2 : ARC_NB1);
+    arc = GBUCKET_AT(tlb, ghost_bucket(tlb, page_num));
+    FIELD16(cur, G_HNEXT) = FIELD16(arc, 0);
+    FIELD16(arc, 0) = g;
+}
+
+/* REPLACE de ARC: expulsa el LRU de T1 o de T2 según p y lo pasa a su
+   lista fantasma. Devuelve el slot liberado (aún con la página vieja).
+   Usa ≤3 punteros: tlb, arc. */
+static uint16_t arc_replace(char *tlb, unsigned int set, int in_b2)
+{
+    char *arc = ARC_AT(tlb, set);
+    unsigned int nt1 = FIELD16(arc, ARC_NT1);
+    unsigned int p = FIELD16(arc, ARC_P);
+    int from_t1 = nt1 > 0U
+        && ((in_b2 && nt1 == p) || nt1 > p || FIELD16(arc, ARC_NT2) == 0U);
+    uint16_t idx = FIELD16(arc, (from_t1 ? ARC_T1 : ARC_T2) + 2U);
+
+    dl_unlink(SLOT_LINKS(tlb), SLOT_SIZE, arc + (from_t1 ? ARC_T1 : ARC_T2),
+              idx);
+    --FIELD16(arc, from_t1 ? ARC_NT1 : ARC_NT2);
+    ghost_add(tlb, set, from_t1 ? 1U : 2U,
+              FIELD32(SLOT_AT(tlb, idx), OFF_PAGE));
+    return idx;
+}
+
+/* Elige el slot para page_num en ARC (casos II-IV del algoritmo:
+   adaptar p en un acierto fantasma, acotar el directorio a 2c) y deja
+   en H_ARC_TARGET la lista donde entrará.
+   Usa ≤3 punteros: tlb, arc. */
+static uint16_t arc_victim(char *tlb, unsigned int set, uint32_t page_num)
+{
+    char *arc = ARC_AT(tlb, set);
+    unsigned int c = FIELD32(tlb, H_WAYS);
+    unsigned int nb1 = FIELD16(arc, ARC_NB1);
+    unsigned int nb2 = FIELD16(arc, ARC_NB2);
+    uint16_t g = ghost_find(tlb, page_num);
+    uint16_t idx = FIELD16(SET_AT(tlb, set), SET_TAIL);
+    int in_b2 = 0;
+
+    if (g != SLOT_NONE) {
+        unsigned int p = FIELD16(arc, ARC_P);
+        in_b2 = FIELD16(GHOST_AT(tlb, g), G_LIST) == 2U;
+        if (in_b2) {
+            unsigned int d = nb1 > nb2 ? nb1 / nb2 : 1U;
+            p = p > d ? p - d : 0U;
+        } else {
+            unsigned int d = nb2 > nb1 ? nb2 / nb1 : 1U;
+            p = p + d < c ? p + d : c;
+        }
+        FIELD16(arc, ARC_P) = (uint16_t)p;
+        ghost_remove(tlb, set, g);
+        FIELD32(tlb, H_ARC_TARGET) = 2U;
+    } else {
+        unsigned int nt1 = FIELD16(arc, ARC_NT1);
+        unsigned int total = nt1 + nb1 + FIELD16(arc, ARC_NT2) + nb2;
+        FIELD32(tlb, H_ARC_TARGET) = 1U;
+        if (nt1 + nb1 >= c) {
+            if (nb1 > 0U) {
+                ghost_remove(tlb, set, FIELD16(arc, ARC_B1 + 2U));
+            } else if (idx == SLOT_NONE) {
+                /* T1 ocupa todo el conjunto: se expulsa sin fantasma */
+                idx = FIELD16(arc, ARC_T1 + 2U);
+                dl_unlink(SLOT_LINKS(tlb), SLOT_SIZE, arc + ARC_T1, idx);
+                --FIELD16(arc, ARC_NT1);
+                return idx;
+            }
+        } else if (total >= 2U * c && nb2 > 0U) {
+            ghost_remove(tlb, set, FIELD16(arc, ARC_B2 + 2U));
+        }
+    }
+    if (idx != SLOT_NONE) {
+        lru_unlink(tlb, idx);
+        return idx;
+    }
+    return arc_replace(tlb, set, in_b2);
+}
+
+/* Elige el slot del conjunto donde entra page_num y lo saca de la
+   estructura de la política (el slot conserva aún la página vieja).
+   Con LRU/FIFO es la cola de la lista; con las demás primero un slot
+   libre (cola de la lista libre) y si no hay, la víctima de la política.
+   Usa ≤3 punteros: tlb. */
+static uint16_t policy_victim(char *tlb, unsigned int set, uint32_t page_num)
+{
+    int policy = (int)FIELD32(tlb, H_POLICY);
+    unsigned int ways = FIELD32(tlb, H_WAYS);
+    uint16_t idx;
+
+    if (policy == POL_LRU || policy == POL_FIFO) {
+        return FIELD16(SET_AT(tlb, set), SET_TAIL);
+    }
+    if (policy == POL_ARC) return arc_victim(tlb, set, page_num);
+
+    idx = FIELD16(SET_AT(tlb, set), SET_TAIL);
+    if (idx != SLOT_NONE) {
+        lru_unlink(tlb, idx);
+        return idx;
+    }
+    switch (policy) {
+    case POL_CLOCK: {
+        unsigned int hand = FIELD16(SET_AT(tlb, set), SET_HAND);
+        /* segunda oportunidad: limpiar bits de referencia hasta hallar
+           uno en cero (a lo sumo una vuelta) */
+        while (HEAP_KEY(tlb, set * ways + hand) != 0U) {
+            HEAP_KEY(tlb, set * ways + hand) = 0U;
+            hand = hand + 1U < ways ? hand + 1U : 0U;
+        }
+        idx = (uint16_t)(set * ways + hand);
+        FIELD16(SET_AT(tlb, set), SET_HAND) =
+            (uint16_t)(hand + 1U < ways ? hand + 1U : 0U);
+        return idx;
+    }
+    case POL_PLRU:
+        return (uint16_t)(set * ways + plru_victim(tlb, set));
+    case POL_RANDOM:
+        return (uint16_t)(set * ways + random_way(tlb, ways));
+    default: /* POL_LFU, POL_OPT: la raíz del montículo */
+        idx = HEAP_AT(tlb, set)[0];
+        heap_remove(tlb, set, idx);
+        return idx;
+    }
+}
+
+/* Registra en la política el slot recién llenado.
+   Usa ≤3 punteros: tlb, cur. */
+static void policy_fill(char *tlb, unsigned int set, uint16_t idx)
+{
+    char *cur = SLOT_AT(tlb, idx);
+
+    switch ((int)FIELD32(tlb, H_POLICY)) {
+    case POL_LRU:
+    case POL_FIFO:
+        lru_unlink(tlb, idx);
+        lru_push_front(tlb, idx);
+        break;
+    case POL_CLOCK:
+        FIELD32(cur, OFF_LRU) = 1U;
+        break;
+    case POL_PLRU:
+        plru_touch(tlb, set, idx - set * FIELD32(tlb, H_WAYS));
+        break;
+    case POL_LFU:
+        FIELD32(cur, OFF_LRU) = 1U;
+        heap_push(tlb, set, idx);
+        break;
+    case POL_OPT:
+        FIELD32(cur, OFF_LRU) = ~tlb_policy_hint;
+        heap_push(tlb, set, idx);
+        break;
+    case POL_ARC: {
+        uint32_t target = FIELD32(tlb, H_ARC_TARGET);
+        cur = ARC_AT(tlb, set);
+        dl_push_front(SLOT_LINKS(tlb), SLOT_SIZE,
+                      cur + (target == 2U ? ARC_T2 : ARC_T1), idx);
+        ++FIELD16(cur, target == 2U ? ARC_NT2 : ARC_NT1);
+        FIELD32(SLOT_AT(tlb, idx), OFF_LRU) = target;
+        break;
+    }
+    default: /* POL_RANDOM no guarda estado */
+        break;
+    }
+}
+
+/* Saca el slot de la estructura de la política y lo deja al final de la
+   lista del conjunto (invalidación).
+   Usa ≤3 punteros: tlb, cur. */
+static void policy_release(char *tlb, uint16_t idx)
+{
+    unsigned int set = idx / FIELD32(tlb, H_WAYS);
+    int policy = (int)FIELD32(tlb, H_POLICY);
+    char *cur;
+
+    if (policy == POL_LRU || policy == POL_FIFO) {
+        lru_unlink(tlb, idx);
+    } else if (policy == POL_LFU || policy == POL_OPT) {
+        heap_remove(tlb, set, idx);
+    } else if (policy == POL_ARC) {
+        int t2 = HEAP_KEY(tlb, idx) == 2U;
+        cur = ARC_AT(tlb, set);
+        dl_unlink(SLOT_LINKS(tlb), SLOT_SIZE, cur + (t2 ? ARC_T2 : ARC_T1),
+                  idx);
+        --FIELD16(cur, t2 ? ARC_NT2 : ARC_NT1);
+    }
+    lru_push_back(tlb, idx);
+}
+
+/* Inserta/actualiza una entrada en el TLB según su política.
+   Devuelve la dirección base de memoria (uintptr_t) que fue reemplazada,
+   o (uintptr_t)0 si no hubo reemplazo (inserción en slot libre).
+   La víctima la da policy_victim sin recorrer el TLB. Si hubo
+   reemplazo y evicted no es NULL, deja en *evicted la página que salió
+   del TLB.
+   Usa ≤3 punteros: tlb, victim. */
+uintptr_t tlb_insert(char *tlb, uint32_t page_num,
+                     uint32_t offset_num,
+                     const char *page_bin, const char *off_bin,
+                     uint32_t *evicted)
+{
+    unsigned int set = tlb_set_of(tlb, page_num);
+
+    if (FIELD32(tlb, H_LAYOUT) == LAYOUT_COMPACT) {
+        return compact_insert(tlb, page_num, evicted);
+    }
+    if (FIELD32(tlb, H_LRU_MODE) == LRU_SCAN) {
+        return tlb_insert_scan(tlb, set, page_num, offset_num,
+                               page_bin, off_bin, evicted);
+    }
+
+    uint16_t idx = policy_victim(tlb, set, page_num);
+    char *victim = SLOT_AT(tlb, idx);
+    uintptr_t replaced_base = (uintptr_t)0;
+    int hashed = FIELD32(tlb, H_HASH_BITS) != 0U;
+
+    if (*((uint32_t *)(victim + OFF_PAGE)) != UINT32_MAX) {
+        replaced_base = *((uintptr_t *)(victim + OFF_BASE));
+        if (evicted) *evicted = *((uint32_t *)(victim + OFF_PAGE));
+        if (hashed) hash_remove(tlb, idx);
+    }
+    slot_fill(tlb, victim, page_num, offset_num, page_bin, off_bin);
+    if (hashed) hash_insert(tlb, idx);
+    policy_fill(tlb, set, idx);
+    return replaced_base;
+}
+
+/* Registra un acierto en la entrada: contador del TLB en modo scan,
+   mover a la cabeza de la lista en LRU, o el estado de la política
+   (bit de referencia, árbol PLRU, frecuencia, próxima referencia o
+   paso de T1 a T2 en ARC). FIFO y RANDOM no cambian nada.
+   Usa ≤3 punteros: tlb, slot_ptr, arc. */
+void tlb_update_lru(char *tlb, char *slot_ptr)
+{
+    if (FIELD32(tlb, H_LAYOUT) == LAYOUT_COMPACT) {
+        compact_touch(tlb, slot_ptr);
+        return;
+    }
+    if (FIELD32(tlb, H_LRU_MODE) == LRU_SCAN) {
+        *((uint32_t *)(slot_ptr + OFF_LRU)) = FIELD32(tlb, H_COUNTER)++;
+        return;
+    }
+    uint16_t idx = SLOT_INDEX(tlb, slot_ptr);
+    unsigned int set = idx / FIELD32(tlb, H_WAYS);
+    switch ((int)FIELD32(tlb, H_POLICY)) {
+    case POL_LRU:
+        if (FIELD16(SET_AT(tlb, set), SET_HEAD) != idx) {
+            lru_unlink(tlb, idx);
+            lru_push_front(tlb, idx);
+        }
+        break;
+    case POL_CLOCK:
+        *((uint32_t *)(slot_ptr + OFF_LRU)) = 1U;
+        break;
+    case POL_PLRU:
+        plru_touch(tlb, set, idx - set * FIELD32(tlb, H_WAYS));
+        break;
+    case POL_LFU:
+        if (*((uint32_t *)(slot_ptr + OFF_LRU)) != UINT32_MAX) {
+            ++*((uint32_t *)(slot_ptr + OFF_LRU));
+            heap_sift(tlb, HEAP_AT(tlb, set),
+                      FIELD16(SET_AT(tlb, set), SET_COUNT),
+                      HEAP_POS(tlb, idx));
+        }
+        break;
+    case POL_OPT:
+        *((uint32_t *)(slot_ptr + OFF_LRU)) = ~tlb_policy_hint;
+        heap_sift(tlb, HEAP_AT(tlb, set),
+                  FIELD16(SET_AT(tlb, set), SET_COUNT), HEAP_POS(tlb, idx));
+        break;
+    case POL_ARC: {
+        char *arc = ARC_AT(tlb, set);
+        int t2 = *((uint32_t *)(slot_ptr + OFF_LRU)) == 2U;
+        if (t2 && FIELD16(arc, ARC_T2) == idx) break;
+        dl_unlink(SLOT_LINKS(tlb), SLOT_SIZE, arc + (t2 ? ARC_T2 : ARC_T1),
+                  idx);
+        dl_push_front(SLOT_LINKS(tlb), SLOT_SIZE, arc + ARC_T2, idx);
+        if (!t2) {
+            --FIELD16(arc, ARC_NT1);
+            ++FIELD16(arc, ARC_NT2);
+            *((uint32_t *)(slot_ptr + OFF_LRU)) = 2U;
+        }
+        break;
+    }
+    default: /* POL_FIFO, POL_RANDOM */
+        break;
+    }
+}
+
+/* Invalida la entrada del slot: queda vacía (page = UINT32_MAX) y pasa
+   a ser la próxima víctima de su conjunto.
+   Usa ≤3 punteros: tlb, slot_ptr. */
+void tlb_invalidate(char *tlb, char *slot_ptr)
+{
+    if (FIELD32(tlb, H_LAYOUT) == LAYOUT_COMPACT) {
+        FIELD64(slot_ptr, 0) = compact_stamp(tlb); /* inválida, con marca */
+        return;
+    }
+    uint16_t idx = SLOT_INDEX(tlb, slot_ptr);
+    uint32_t ways = FIELD32(tlb, H_WAYS);
+    int scan = FIELD32(tlb, H_LRU_MODE) == LRU_SCAN;
+    /* el modo scan no mantiene el índice hash */
+    if (FIELD32(tlb, H_HASH_BITS) != 0U && !scan) hash_remove(tlb, idx);
+    if (FIELD32(tlb, H_LAYOUT) == LAYOUT_SOA) {
+        TAGS_AT(tlb, idx / ways)[idx % ways] = UINT32_MAX;
+    }
+    if (!scan) policy_release(tlb, idx);
+    *((uint32_t *)(slot_ptr + OFF_PAGE)) = UINT32_MAX;
+    /* en modo scan la marca ordena los vacíos para tlb_insert_scan */
+    *((uint32_t *)(slot_ptr + OFF_LRU)) =
+        scan ? FIELD32(tlb, H_COUNTER)++ : 0U;
+    *((uintptr_t *)(slot_ptr + OFF_BASE)) = (uintptr_t)0;
+}
+
+/* ---------- API de biblioteca (traducir.h) ---------- */
+
+/* Cada tlb_engine es un bloque en heap con el TLB (creado con
+   tlb_alloc) y sus contadores; tlb_translate no reserva memoria. Todo
+   el estado que usa la traducción (modo LRU, sondeo, xorshift de
+   RANDOM, lista de ARC) está en la cabecera del TLB, así que las
+   opciones globales de la línea de órdenes no afectan a una instancia
+   ya abierta. Las cadenas binarias de los slots AoS/SoA quedan en
+   cero: sólo las usa el modo interactivo, que las escribe él mismo. */
+#define E_TLB        0U   /* char*: el TLB */
+#define E_HITS       8U
+#define E_MISSES     16U
+#define E_EVICTIONS  24U
+#define E_FAULTS     32U
+#define ENGINE_SIZE  40U
+#define ENGINE_TLB(e) (*((char **)((char *)(e) + E_TLB)))
+
+/* Si la línea de órdenes no lo eligió con --simd, el sondeo SIMD se
+   detecta una vez; cada instancia copia el resultado en su H_PROBE */
+static pthread_once_t engine_probe_once = PTHREAD_ONCE_INIT;
+
+static void engine_select_probe(void)
+{
+    if (!probe_chosen) tlb_select_probe("auto");
+}
+
+tlb_engine *tlb_engine_open(unsigned int sets, unsigned int ways,
+                            const char *index, const char *policy,
+                            const char *layout)
+{
+    int index_fn = INDEX_LOW;
+    int pol = POL_LRU;
+    int lay = LAYOUT_AOS;
+    int scan = policy && strcmp(policy, "lru-scan") == 0;
+    char *e;
+
+    if (index && strcmp(index, "xor") == 0) {
+        index_fn = INDEX_XOR;
+    } else if (index && strcmp(index, "low") != 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (policy && !scan) {
+        for (pol = 0; pol < POL_COUNT; ++pol) {
+            if (strcmp(policy, tlb_policy_names[pol]) == 0) break;
+        }
+    }
+    if (layout) {
+        for (lay = LAYOUT_AOS; lay <= LAYOUT_COMPACT; ++lay) {
+            if (strcmp(layout, lay == LAYOUT_AOS ? "aos"
+                       : lay == LAYOUT_SOA ? "soa" : "compact") == 0) break;
+        }
+    }
+    /* opt necesita la traza completa por adelantado */
+    if (pol == POL_COUNT || pol == POL_OPT || lay > LAYOUT_COMPACT
+        || (lay == LAYOUT_COMPACT && (pol != POL_LRU || scan))
+        || sets == 0U || ways == 0U || (sets & (sets - 1U)) != 0U
+        || (unsigned long)sets * ways > TLB_ENTRIES_LIMIT) {
+        errno = EINVAL;
+        return NULL;
+    }
+    e = (char *)calloc(1U, ENGINE_SIZE);
+    if (!e) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    pthread_once(&engine_probe_once, engine_select_probe);
+    ENGINE_TLB(e) = tlb_alloc(sets, ways, index_fn, lay, pol);
+    if (!ENGINE_TLB(e)) {
+        free(e);
+        errno = ENOMEM;
+        return NULL;
+    }
+    FIELD32(ENGINE_TLB(e), H_PROBE) = tlb_probe_kind;
+    if (scan) FIELD32(ENGINE_TLB(e), H_LRU_MODE) = LRU_SCAN;
+    return (tlb_engine *)e;
+}
+
+void tlb_engine_seed(tlb_engine *e, uint64_t seed)
+{
+    tlb_seed(ENGINE_TLB(e), seed);
+}
+
+char *tlb_engine_tlb(tlb_engine *e)
+{
+    return ENGINE_TLB(e);
+}
+
+void tlb_engine_close(tlb_engine *e)
+{
+    if (!e) return;
+    tlb_destroy(ENGINE_TLB(e));
+    free(e);
+}
+
+void tlb_translate(tlb_engine *e, const uint64_t *addrs, size_t n,
+                   uint8_t *results, uint64_t *evicted)
+{
+    tlb_translate_slots(e, addrs, n, results, evicted, NULL);
+}
+
+/* Usa ≤3 punteros: b, tlb, slot. */
+void tlb_translate_slots(tlb_engine *e, const uint64_t *addrs, size_t n,
+                         uint8_t *results, uint64_t *evicted,
+                         uint32_t *slots)
+{
+    static const char zeros[PAGE_BIN_SIZE];
+    char *b = (char *)e;
+    char *tlb = ENGINE_TLB(b);
+    char *slot;
+    size_t i;
+
+    for (i = 0U; i < n; ++i) {
+        uint64_t vaddr = addrs[i];
+        uint32_t page = (uint32_t)(vaddr >> 12);
+        uint32_t out = UINT32_MAX;
+
+        if (evicted) evicted[i] = TLB_NO_EVICT;
+        if (slots) slots[i] = TLB_NO_SLOT;
+        if (vaddr > 0xFFFFFFFFULL) {
+            results[i] = TLB_RES_FAULT;
+            ++FIELD64(b, E_FAULTS);
+            continue;
+        }
+        slot = tlb_find(tlb, page);
+        if (slot) {
+            tlb_update_lru(tlb, slot);
+            results[i] = TLB_RES_HIT;
+            ++FIELD64(b, E_HITS);
+            continue;
+        }
+        results[i] = TLB_RES_MISS;
+        ++FIELD64(b, E_MISSES);
+        slot = (char *)tlb_insert(tlb, page, (uint32_t)vaddr & 0xFFFU,
+                                  zeros, zeros, &out);
+        if (slot) {
+            ++FIELD64(b, E_EVICTIONS);
+            if (evicted) evicted[i] = (uint64_t)out << 12;
+            if (slots) {
+                slots[i] = FIELD32(tlb, H_LAYOUT) == LAYOUT_COMPACT
+                           ? CSLOT_INDEX(tlb, slot) : SLOT_INDEX(tlb, slot);
+            }
+        }
+    }
+}
+
+void tlb_engine_stats(const tlb_engine *e, uint64_t *hits,
+                      uint64_t *misses, uint64_t *evictions,
+                      uint64_t *faults)
+{
+    const char *b = (const char *)e;
+    if (hits) *hits = *((const uint64_t *)(b + E_HITS));
+    if (misses) *misses = *((const uint64_t *)(b + E_MISSES));
+    if (evictions) *evictions = *((const uint64_t *)(b + E_EVICTIONS));
+    if (faults) *faults = *((const uint64_t *)(b + E_FAULTS));
+}
@@ -0,0 +1,269 @@
+/* tlb.h
+ * Formato del TLB en heap y motor de traducción (tlb.c), compartidos
+ * por la línea de órdenes (traducir.c) y la biblioteca libtraducir.a.
+ * No es parte de la API: los clientes de la biblioteca sólo incluyen
+ * traducir.h. Todo símbolo que exporta tlb.c empieza con tlb_.
+ */
+#ifndef TLB_H
+#define TLB_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "traducir.h"
+
+/* RESTRICCIONES del TLB (configuración por defecto del enunciado) */
+#define TLB_MAX_BYTES 300U
+#define TLB_MAX_ENTRIES 5U
+
+/* Con --entries/--sets/--ways se pueden modelar TLB más grandes; los
+   enlaces de las listas LRU y de la tabla hash son índices de 16 bits. */
+#define TLB_ENTRIES_LIMIT 65534U
+#define SLOT_NONE 0xFFFFU    /* índice nulo en listas y tabla hash */
+
+/* Con pocas vías la búsqueda recorre las vías del conjunto; con más
+   (p. ej. un TLB totalmente asociativo grande) se usa el índice hash. */
+#define PROBE_WAYS_MAX 16U
+
+/* tamaños de cadenas binarias dentro de cada slot */
+#define PAGE_BIN_SIZE 21U  /* 20 bits + '\\0' */
+#define OFF_BIN_SIZE  13U  /* 12 bits + '\\0' */
+
+/* Offsets dentro del slot calculados de forma portable.
+   OFF_PREV/OFF_NEXT enlazan el slot en la lista de recencia (LRU) de
+   su conjunto y OFF_HNEXT en la cadena de su cubeta del índice hash. */
+#define OFF_BASE    0U
+#define OFF_PAGE    (OFF_BASE + (unsigned int)sizeof(uintptr_t))
+#define OFF_OFFS    (OFF_PAGE + (unsigned int)sizeof(uint32_t))
+#define OFF_PAGE_BIN (OFF_OFFS + (unsigned int)sizeof(uint32_t))
+#define OFF_OFF_BIN  (OFF_PAGE_BIN + PAGE_BIN_SIZE)
+#define OFF_LRU      (OFF_OFF_BIN + OFF_BIN_SIZE)
+#define OFF_PREV     (OFF_LRU + (unsigned int)sizeof(uint32_t))
+#define OFF_NEXT     (OFF_PREV + (unsigned int)sizeof(uint16_t))
+#define OFF_HNEXT    (OFF_NEXT + (unsigned int)sizeof(uint16_t))
+#define SLOT_SIZE    (OFF_HNEXT + (unsigned int)sizeof(uint16_t))
+
+/* Comprobación estática del presupuesto del TLB (sizeof no es válido en #if) */
+_Static_assert(SLOT_SIZE * TLB_MAX_ENTRIES <= TLB_MAX_BYTES,
+               "SLOT_SIZE * TLB_MAX_ENTRIES excede TLB_MAX_BYTES");
+
+/* Entrada compacta (--layout compact): un uint64 con la etiqueta en los
+   bits 0..31, la edad LRU (marca del último uso) en los 31 bits
+   CSLOT_AGE_SHIFT.. y el bit de validez en el 63. Las cadenas
+   binarias, el desplazamiento y la dirección base no se guardan: se
+   derivan de la dirección traducida o de la posición de la entrada
+   cuando hacen falta. 8 bytes alineados a 8 nunca cruzan una línea de
+   caché, y en el presupuesto de 300 bytes caben 37 entradas. */
+#define CSLOT_SIZE      8U
+#define CSLOT_AGE_SHIFT 32U
+#define CSLOT_AGE_MASK  0x7FFFFFFFULL
+#define CSLOT_VALID     (1ULL << 63)
+#define TLB_COMPACT_ENTRIES (TLB_MAX_BYTES / CSLOT_SIZE)
+#define CSLOT_AGE(e)  ((uint32_t)(((e) >> CSLOT_AGE_SHIFT) & CSLOT_AGE_MASK))
+
+_Static_assert(64U % CSLOT_SIZE == 0U,
+               "una entrada compacta cruzaría una línea de caché");
+
+/* Cada TLB es un bloque en heap con esta cabecera (uint32 cada campo),
+   seguida de los slots (agrupados por conjunto: el conjunto s ocupa
+   los slots [s*ways, (s+1)*ways)), de la tabla de conjuntos (cabeza y
+   cola uint16 de la lista LRU de cada uno) y de las cubetas hash. */
+#define H_ENTRIES   0U   /* número de slots */
+#define H_SETS      4U   /* número de conjuntos (potencia de 2) */
+#define H_WAYS      8U   /* vías por conjunto */
+#define H_SET_BITS  12U  /* log2(conjuntos) */
+#define H_INDEX     16U  /* función de índice (INDEX_LOW / INDEX_XOR) */
+#define H_BYTES     20U  /* bytes reservados para los slots */
+#define H_SETS_OFF  24U  /* offset de la tabla de conjuntos */
+#define H_HASH_OFF  28U  /* offset de las cubetas hash */
+#define H_HASH_BITS 32U  /* log2(cubetas), 0 = sin índice hash */
+#define H_COUNTER   36U  /* contador LRU (modo scan) */
+#define H_LAYOUT    40U  /* LAYOUT_AOS / LAYOUT_SOA */
+#define H_TAGS_OFF  44U  /* offset del arreglo contiguo de etiquetas (SoA) */
+#define H_TAG_STRIDE 48U /* etiquetas por conjunto (vías redondeadas a 8) */
+#define H_POLICY    52U  /* política de reemplazo (POL_*) */
+#define H_HEAP_OFF  56U  /* montículos por conjunto (LFU / OPT) */
+#define H_PLRU_OFF  60U  /* bits del árbol pseudo-LRU de cada conjunto */
+#define H_PLRU_STRIDE 64U /* bytes de árbol por conjunto */
+#define H_PLRU_LEAVES 68U /* hojas del árbol (vías redondeadas a 2^k) */
+#define H_ARC_OFF   72U  /* registros ARC por conjunto */
+#define H_GHOST_OFF 76U  /* entradas fantasma de ARC */
+#define H_GHASH_OFF 80U  /* cubetas hash de los fantasmas */
+#define H_GHASH_BITS 84U /* log2(cubetas de fantasmas) */
+#define H_TOTAL     88U  /* bytes del bloque completo (checkpoint) */
+#define H_LRU_MODE  92U  /* LRU_LIST / LRU_SCAN */
+#define H_PROBE     96U  /* versión del sondeo SIMD (PROBE_*) */
+#define H_ARC_TARGET 100U /* lista de ARC del próximo llenado (1 o 2) */
+#define H_RNG       104U /* estado xorshift64 de RANDOM */
+#define TLB_HDR_SIZE 128U
+
+/* Entrada de la tabla de conjuntos. En LRU y FIFO la lista contiene
+   todos los slots del conjunto; en el resto de políticas contiene sólo
+   los slots vacíos (lista libre) y la política lleva su propio orden. */
+#define SET_HEAD  0U   /* slot más reciente */
+#define SET_TAIL  2U   /* slot menos reciente (víctima) */
+#define SET_HAND  4U   /* manecilla de CLOCK (vía) */
+#define SET_COUNT 6U   /* elementos en el montículo (LFU / OPT) */
+#define SET_SIZE  8U
+
+/* Políticas de reemplazo. Todas son O(1) u O(log vías) por acceso:
+   LRU/FIFO usan la lista del conjunto, CLOCK una manecilla, PLRU un
+   árbol de bits, LFU y OPT un montículo mínimo indexado por slot y ARC
+   cuatro listas (T1, T2 y los fantasmas B1, B2) por conjunto. OPT
+   (Belady) es fuera de línea: necesita la próxima referencia de cada
+   acceso, que se calcula recorriendo la traza antes de simularla. */
+#define POL_LRU    0
+#define POL_FIFO   1
+#define POL_CLOCK  2
+#define POL_PLRU   3
+#define POL_RANDOM 4
+#define POL_LFU    5
+#define POL_ARC    6
+#define POL_OPT    7
+#define POL_COUNT  8
+
+/* nombres de --policy y de tlb_engine_open, indexados por POL_* */
+extern const char *const tlb_policy_names[POL_COUNT];
+
+/* Registro ARC de cada conjunto (uint16 cada campo). Cada lista es
+   cabeza (MRU) y cola (LRU); T1/T2 enlazan slots, B1/B2 fantasmas. */
+#define ARC_T1    0U
+#define ARC_T2    4U
+#define ARC_B1    8U
+#define ARC_B2    12U
+#define ARC_FREE  16U  /* lista libre de fantasmas (enlace G_NEXT) */
+#define ARC_NT1   18U
+#define ARC_NT2   20U
+#define ARC_NB1   22U
+#define ARC_NB2   24U
+#define ARC_P     26U  /* tamaño objetivo de T1 */
+#define ARC_SIZE  28U
+
+/* Entrada fantasma de ARC: sólo recuerda el número de página. Cada
+   conjunto tiene 'ways' fantasmas (|B1| + |B2| <= vías). */
+#define G_PAGE    0U
+#define G_PREV    4U
+#define G_NEXT    6U
+#define G_HNEXT   8U
+#define G_LIST    10U  /* 1 = B1, 2 = B2 */
+#define GHOST_SIZE 12U
+
+/* Funciones de índice de conjunto */
+#define INDEX_LOW 0    /* bits bajos del número de página */
+#define INDEX_XOR 1    /* XOR de los campos de set_bits bits */
+
+/* Disposición de las etiquetas: sólo en los slots (AoS, la original)
+   o además copiadas de forma contigua (SoA) para compararlas con SIMD.
+   En SoA cada conjunto ocupa tag_stride uint32 alineados a 32 bytes;
+   el relleno vale UINT32_MAX, igual que un slot vacío. */
+#define LAYOUT_AOS 0
+#define LAYOUT_SOA 1
+#define LAYOUT_COMPACT 2  /* entradas de CSLOT_SIZE bytes, sólo LRU */
+
+/* Acceso a campos dentro del bloque del TLB */
+#define FIELD16(p, off) (*((uint16_t *)((p) + (off))))
+#define FIELD32(p, off) (*((uint32_t *)((p) + (off))))
+#define FIELD64(p, off) (*((uint64_t *)((p) + (off))))
+#define TLB_SLOTS(t)    ((t) + TLB_HDR_SIZE)
+#define SLOT_AT(t, i)   (TLB_SLOTS(t) + (size_t)(i) * (size_t)SLOT_SIZE)
+#define SLOT_INDEX(t, p) \
+    ((uint16_t)((size_t)((p) - TLB_SLOTS(t)) / SLOT_SIZE))
+#define CSLOT_AT(t, i)  (TLB_SLOTS(t) + (size_t)(i) * CSLOT_SIZE)
+#define CSLOT_INDEX(t, p) \
+    ((uint16_t)((size_t)((p) - TLB_SLOTS(t)) / CSLOT_SIZE))
+#define SET_AT(t, s)    ((t) + FIELD32(t, H_SETS_OFF) + (size_t)(s) * SET_SIZE)
+#define BUCKET_AT(t, b) ((t) + FIELD32(t, H_HASH_OFF) + (size_t)(b) * 2U)
+#define TAGS_AT(t, s) \
+    ((uint32_t *)((t) + FIELD32(t, H_TAGS_OFF)) \
+     + (size_t)(s) * FIELD32(t, H_TAG_STRIDE))
+#define HEAP_AT(t, s) \
+    ((uint16_t *)((t) + FIELD32(t, H_HEAP_OFF)) \
+     + (size_t)(s) * FIELD32(t, H_WAYS))
+#define HEAP_POS(t, i) \
+    (((uint16_t *)((t) + FIELD32(t, H_HEAP_OFF)))[FIELD32(t, H_ENTRIES) + (i)])
+#define PLRU_AT(t, s) \
+    ((unsigned char *)((t) + FIELD32(t, H_PLRU_OFF)) \
+     + (size_t)(s) * FIELD32(t, H_PLRU_STRIDE))
+#define ARC_AT(t, s)   ((t) + FIELD32(t, H_ARC_OFF) + (size_t)(s) * ARC_SIZE)
+#define GHOST_AT(t, g) \
+    ((t) + FIELD32(t, H_GHOST_OFF) + (size_t)(g) * GHOST_SIZE)
+#define GBUCKET_AT(t, b) ((t) + FIELD32(t, H_GHASH_OFF) + (size_t)(b) * 2U)
+
+/* Nodo de lista doblemente enlazada por índices: 'nodes' apunta al
+   campo prev del nodo 0 y next va 2 bytes después (slots y fantasmas
+   comparten este formato); 'ht' apunta a cabeza y cola uint16. */
+#define DL_AT(n, stride, i) ((n) + (size_t)(i) * (stride))
+#define SLOT_LINKS(t)  (TLB_SLOTS(t) + OFF_PREV)
+#define GHOST_LINKS(t) (GHOST_AT(t, 0) + G_PREV)
+
+/* Búsqueda de víctima: lista de recencia O(1) (por defecto) o el
+   recorrido de contadores original, que se conserva como referencia. */
+#define LRU_LIST 0
+#define LRU_SCAN 1
+
+/* Versiones del sondeo SIMD (H_PROBE de cada TLB) */
+#define PROBE_SCALAR 0U
+#define PROBE_SSE2   1U
+#define PROBE_AVX2   2U
+
+/* Semilla fija del xorshift de RANDOM (H_RNG de los TLB nuevos) */
+#define TLB_RNG_SEED 0x9E3779B97F4A7C15ULL
+
+/* ---------- Estado del motor (tlb.c) ---------- */
+
+/* versión del sondeo elegida con tlb_select_probe: la línea de
+   órdenes la copia en H_PROBE de cada TLB nuevo */
+extern unsigned int tlb_probe_kind;
+/* nombres de la versión elegida (para los informes) */
+extern const char *tlb_tags_probe_name;
+extern const char *tlb_cslots_probe_name;
+/* próxima referencia del acceso en curso (OPT), una por hilo: la pone
+   trace_step antes de cada acceso */
+extern _Thread_local uint32_t tlb_policy_hint;
+
+char *tlb_alloc(unsigned int sets, unsigned int ways, int index_fn,
+                int layout, int policy);
+void tlb_seed(char *tlb, uint64_t seed);
+void tlb_destroy(char *tlb);
+int tlb_select_probe(const char *want);
+char *tlb_find(char *tlb, uint32_t page_num);
+uintptr_t tlb_insert(char *tlb, uint32_t page_num, uint32_t offset_num,
+                     const char *page_bin, const char *off_bin,
+                     uint32_t *evicted);
+void tlb_update_lru(char *tlb, char *slot_ptr);
+void tlb_invalidate(char *tlb, char *slot_ptr);
+/* TLB de una instancia de la API (para el modo interactivo) */
+char *tlb_engine_tlb(tlb_engine *e);
+
+/* Conjunto al que corresponde un número de página */
+static inline unsigned int tlb_set_of(const char *tlb, uint32_t page_num)
+{
+    uint32_t bits = FIELD32(tlb, H_SET_BITS);
+    uint32_t mask = FIELD32(tlb, H_SETS) - 1U;
+    if (FIELD32(tlb, H_INDEX) == INDEX_XOR && bits > 0U) {
+        uint32_t h = page_num;
+        uint32_t p = page_num >> bits;
+        while (p != 0U) {
+            h ^= p;
+            p >>= bits;
+        }
+        return h & mask;
+    }
+    return page_num & mask;
+}
+
+/* Slot i y su etiqueta (UINT32_MAX si está vacío) en cualquier
+   disposición, para los recorridos de todo el TLB */
+#define TLB_ENTRY_AT(t, i) \
+    (FIELD32(t, H_LAYOUT) == LAYOUT_COMPACT ? CSLOT_AT(t, i) : SLOT_AT(t, i))
+
+static inline uint32_t tlb_tag_at(char *tlb, uint32_t i)
+{
+    if (FIELD32(tlb, H_LAYOUT) == LAYOUT_COMPACT) {
+        uint64_t e = FIELD64(CSLOT_AT(tlb, i), 0);
+        return (e & CSLOT_VALID) ? (uint32_t)e : UINT32_MAX;
+    }
+    return FIELD32(SLOT_AT(tlb, i), OFF_PAGE);
+}
+
+#endif /* TLB_H */
@@ -2,287 +2,6226 @@
  * Versión corregida para cumplir todas las restricciones solicitadas.
  *
  * Compilar:
- *   gcc -std=c11 -Wall -Wextra -o traducir_fix traducir_fix.c
+ *   make               traducir (este archivo + el motor de tlb.c)
+ *   make check         prueba de la API (traducir.h) con libtraducir.a
+ * o a mano:
+ *   gcc -std=c11 -Wall -Wextra -O2 -pthread -o traducir traducir.c tlb.c -lm
+ *
+ * Uso:
+ *   ./traducir [OPCIONES DEL TLB]                 modo interactivo
+ *   ./traducir --trace ARCHIVO [--summary]   traza por lotes
+ *   ./traducir --trace ARCHIVO --policy opt  reemplazo óptimo (Belady)
+ *   ./traducir --trace ARCHIVO --cores 1,2,4     núcleos con shootdowns
+ *   ./traducir --trace ARCHIVO --parallel 0      réplica paralela por trozos
+ *   ./traducir --trace ARCHIVO --asids 16         ASID, invlpg y vaciados
+ *   ./traducir --trace ARCHIVO --va-bits 48 --walk  x86-64, 4 niveles
+ *   ./traducir --trace ARCHIVO --layout compact  37 entradas de 8 bytes
+ *   ./traducir --trace ARCHIVO --prefetch stride  prefetch de traducciones
+ *   ./traducir --gen zipf:1.1,seq@0.5 --gen-count 1e9  carga sintética
+ *   ./traducir --trace ARCHIVO --metrics unix:/tmp/m.sock  métricas en vivo
+ *   ./traducir --trace ARCHIVO --checkpoint-at 1e6 --checkpoint C  calentar
+ *   ./traducir --trace ARCHIVO --restore C --policy arc  seguir desde C
+ *   ./traducir --convert ENTRADA SALIDA [--delta]   decimal -> binaria
+ *   ./traducir --bench-lookup                     ns/búsqueda AoS vs SoA
+ *   ./traducir --bench-engines --bench-format json  mt vs traducir (CSV/JSON)
+ *     (mt: make mt; otra ruta con --mt RUTA)
+ *   ./traducir --mrc ARCHIVO [--mrc-max N]        curva de fallos LRU
  */
 
+#define _GNU_SOURCE  /* mmap, madvise y demás llamadas POSIX con -std=c11 */
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
+#include <stdarg.h>
 #include <sys/time.h>
+#include <time.h>
 #include <inttypes.h>
 #include <limits.h>
 #include <errno.h>
-
-/* RESTRICCIONES del TLB */
-#define TLB_MAX_BYTES 300U
-#define TLB_MAX_ENTRIES 5U
-
-/* tamaños de cadenas binarias dentro de cada slot */
-#define PAGE_BIN_SIZE 21U  /* 20 bits + '\\0' */
-#define OFF_BIN_SIZE  13U  /* 12 bits + '\\0' */
-
-/* Offsets dentro del slot calculados de forma portable */
-#define OFF_BASE    0U
-#define OFF_PAGE    (OFF_BASE + (unsigned int)sizeof(uintptr_t))
-#define OFF_OFFS    (OFF_PAGE + (unsigned int)sizeof(uint32_t))
-#define OFF_PAGE_BIN (OFF_OFFS + (unsigned int)sizeof(uint32_t))
-#define OFF_OFF_BIN  (OFF_PAGE_BIN + PAGE_BIN_SIZE)
-#define OFF_LRU      (OFF_OFF_BIN + OFF_BIN_SIZE)
-#define SLOT_SIZE    (OFF_LRU + (unsigned int)sizeof(uint32_t))
-
-/* Comprobación estática simple (no fatal en tiempo de compilación) */
-#if (SLOT_SIZE * TLB_MAX_ENTRIES) > TLB_MAX_BYTES
-#warning "SLOT_SIZE * TLB_MAX_ENTRIES excede TLB_MAX_BYTES; ajustar tamaños"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <pthread.h>
+#include <sched.h>
+#include <math.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>  /* rdtsc y lfence (--timer tsc) */
 #endif
 
+#include "traducir.h"
+#include "tlb.h"
+
+/* Espacios de direcciones (--asids): el ASID ocupa los bits
+   ASID_SHIFT.. de la etiqueta OFF_PAGE, por encima de la página y su
+   tamaño. Cada slot queda así etiquetado con su ASID sin crecer y la
+   comparación (escalar o SIMD) sigue siendo de un solo uint32. */
+#define ASID_SHIFT 21U
+#define ASID_MAX   256U
+#define TAG_PAGE_MASK ((1U << ASID_SHIFT) - 1U)
+#define TAG_ASID(t)   ((t) >> ASID_SHIFT)
+
 /* Variables globales del TLB en heap */
 static char *tlb_heap = NULL;        /* puntero a inicio del TLB (heap) */
-static const unsigned int tlb_bytes = TLB_MAX_BYTES;
-static uint32_t access_counter = 1U; /* contador para LRU */
+static unsigned int tlb_entries = TLB_MAX_ENTRIES;
+static unsigned int tlb_sets = 1U;
+static int tlb_index_fn = INDEX_LOW;
+static int tlb_layout = LAYOUT_AOS;
+static int lru_mode = LRU_LIST;      /* --lru: H_LRU_MODE de los TLB nuevos */
+static int tlb_policy = POL_LRU;
+static uint64_t policy_seed = TLB_RNG_SEED; /* --seed */
+static uint32_t *opt_next = NULL;   /* acceso -> próximo acceso (OPT) */
+static uint64_t opt_pos = 0U;       /* acceso actual de la traza (OPT) */
+static unsigned int asid_count = 0U; /* --asids (0 = sin registros ASID) */
+static uint32_t asid_tag = 0U;       /* ASID actual << ASID_SHIFT */
+static unsigned int va_bits = 32U;   /* --va-bits: 32, 48 o 57 */
+static uint64_t va_mask = UINT32_MAX; /* bits válidos de la dirección */
+static uint64_t va_parse_max = UINT32_MAX; /* cota para agregar un dígito */
 
 /* ---------- Funciones auxiliares (conversiones) ---------- */
 
-/* decimal -> binario: usa >> y & tal como pide el enunciado.
-   'bits' es el número de bits a producir, out debe tener espacio
-   para bits + 1 (NUL). */
-void dec_to_bin(uint32_t val, int bits, char *out)
+/* Tabla de conversión: BIN_LUT[b] son los 8 caracteres '0'/'1' del
+   byte b, del bit más significativo al menos significativo. Se arma en
+   tiempo de compilación con >> y &. */
+#define BIN_ROW(b) { \
+    (char)('0' + (((b) >> 7) & 1)), (char)('0' + (((b) >> 6) & 1)), \
+    (char)('0' + (((b) >> 5) & 1)), (char)('0' + (((b) >> 4) & 1)), \
+    (char)('0' + (((b) >> 3) & 1)), (char)('0' + (((b) >> 2) & 1)), \
+    (char)('0' + (((b) >> 1) & 1)), (char)('0' + ((b) & 1)) }
+#define BIN_ROW4(b)  BIN_ROW(b), BIN_ROW((b) + 1), BIN_ROW((b) + 2), \
+                     BIN_ROW((b) + 3)
+#define BIN_ROW16(b) BIN_ROW4(b), BIN_ROW4((b) + 4), BIN_ROW4((b) + 8), \
+                     BIN_ROW4((b) + 12)
+#define BIN_ROW64(b) BIN_ROW16(b), BIN_ROW16((b) + 16), \
+                     BIN_ROW16((b) + 32), BIN_ROW16((b) + 48)
+
+static const char bin_lut[256][8] = {
+    BIN_ROW64(0), BIN_ROW64(64), BIN_ROW64(128), BIN_ROW64(192)
+};
+
+/* decimal -> binario: usa >> y & tal como pide el enunciado, un byte
+   por paso con bin_lut (primero los bits % 8 más altos).
+   'bits' es el número de bits a producir (hasta 64, p. ej. 45 para
+   una página de 57 bits), out debe tener espacio para bits + 1 (NUL). */
+void dec_to_bin(uint64_t val, int bits, char *out)
 {
-    int i;
+    int lead = bits & 7;
     int pos = 0;
-    for (i = bits - 1; i >= 0; --i) {
-        out[pos++] = ((val >> i) & 1U) ? '1' : '0';
+    int i;
+    if (lead != 0) {
+        memcpy(out, bin_lut[(val >> (bits - lead)) & ((1U << lead) - 1U)]
+                    + (8 - lead), (size_t)lead);
+        pos = lead;
+    }
+    for (i = bits - lead - 8; i >= 0; i -= 8) {
+        memcpy(out + pos, bin_lut[(val >> i) & 0xFFU], 8U);
+        pos += 8;
     }
     out[pos] = '\0';
 }
 
 /* binario (cadena) -> decimal: suma acumulada de 2^posición */
-uint32_t bin_to_dec(const char *bin)
+uint64_t bin_to_dec(const char *bin)
 {
-    uint32_t res = 0U;
+    uint64_t res = 0U;
     size_t len = strlen(bin);
     size_t p;
     for (p = 0; p < len; ++p) {
         char c = bin[len - 1 - p];
         if (c == '1') {
-            res += (1U << (unsigned int)p);
+            res += (1ULL << (unsigned int)p);
         }
     }
     return res;
 }
 
-/* Comprueba si el valor de addr (string) es válido para espacio 32-bit.
+/* Forma canónica de x86-64 (sólo con --va-bits 48/57): los bits
+   va_bits-1..63 son todos 0 o todos 1 */
+static inline int va_canonical(uint64_t v)
+{
+    uint64_t top = v >> (va_bits - 1U);
+    return top == 0U || top == (UINT64_MAX >> (va_bits - 1U));
+}
+
+/* Comprueba si el valor de addr (string) es válido para el espacio
+   virtual (32 bits o, con --va-bits, 48/57 bits en forma canónica).
    Si válido, deja el valor en *out. */
-int parse_address(const char *s, uint32_t *out)
+int parse_address(const char *s, uint64_t *out)
 {
     char *endptr = NULL;
     errno = 0;
-    unsigned long val = strtoul(s, &endptr, 10);
+    if (va_bits != 32U && strchr(s, '-')) return 0; /* -1 daría 2^64-1 */
+    unsigned long long val = strtoull(s, &endptr, 10);
     if (endptr == s || *endptr != '\0' || errno != 0) {
         return 0; /* no parseable */
     }
-    if (val > UINT32_MAX) return 0;
-    *out = (uint32_t)val;
+    if (va_bits == 32U ? val > UINT32_MAX : !va_canonical(val)) return 0;
+    *out = (uint64_t)val;
+    return 1;
+}
+
+/* Lee un tamaño decimal de la línea de órdenes en [0, max]. El rango se
+   comprueba sobre el unsigned long, antes de estrecharlo a unsigned
+   int, para que 4294967297 no se convierta en 1. */
+int parse_size(const char *s, unsigned long max, unsigned long *out)
+{
+    char *endptr = NULL;
+    errno = 0;
+    if (strchr(s, '-')) return 0; /* strtoul acepta "-1" */
+    unsigned long val = strtoul(s, &endptr, 10);
+    if (endptr == s || *endptr != '\0' || errno != 0 || val > max) {
+        return 0;
+    }
+    *out = val;
     return 1;
 }
 
-/* ---------- Gestión del TLB (todas las funciones usan máximo 3
-   variables apuntador char* cuando manipulan el TLB) ---------- */
+/* Tope de cualquier latencia en ciclos: con él las sumas en unsigned
+   int (L1 + walk, 5 niveles de walk + fallo) no pueden desbordarse. */
+#define LAT_LIMIT 1000000UL
 
-/* Inicializa el TLB (malloc en heap) y marca entradas vacías.
-   Esta función usa a lo sumo 3 punteros: base, cur, (tlb_heap global no cuenta). */
-void init_tlb(void)
+/* Lee "L1,L2,WALK" (--lat): exactamente tres latencias separadas por
+   comas, cada una validada con parse_size en [0, LAT_LIMIT]. */
+int parse_lat_list(const char *s, unsigned int *l1, unsigned int *l2,
+                   unsigned int *walk)
+{
+    char field[24];
+    unsigned long v[3];
+    unsigned int k;
+    for (k = 0U; k < 3U; ++k) {
+        size_t n = strcspn(s, ",");
+        if (n >= sizeof(field)) return 0;
+        memcpy(field, s, n);
+        field[n] = '\0';
+        if (!parse_size(field, LAT_LIMIT, &v[k])) return 0;
+        s += n;
+        if (k < 2U) {
+            if (*s != ',') return 0;
+            ++s;
+        }
+    }
+    if (*s != '\0') return 0; /* un cuarto campo */
+    *l1 = (unsigned int)v[0];
+    *l2 = (unsigned int)v[1];
+    *walk = (unsigned int)v[2];
+    return 1;
+}
+
+/* ---------- TLB de la línea de órdenes (el motor está en tlb.c) ---------- */
+
+/* tlb_alloc para la línea de órdenes, con --lru, --simd y --seed: sin
+   memoria no hay simulación posible, así que se informa y se termina */
+char *tlb_create(unsigned int sets, unsigned int ways, int index_fn,
+                 int layout, int policy)
 {
-    tlb_heap = (char *)malloc((size_t)tlb_bytes);
-    if (!tlb_heap) {
+    char *tlb = tlb_alloc(sets, ways, index_fn, layout, policy);
+    if (!tlb) {
         perror("malloc TLB");
         exit(EXIT_FAILURE);
     }
-    /* marcar entradas como vacías: page = UINT32_MAX */
-    char *base = tlb_heap;
-    char *cur;
-    unsigned int i;
-    for (i = 0U; i < TLB_MAX_ENTRIES; ++i) {
-        cur = base + (size_t)i * (size_t)SLOT_SIZE;
-        /* page = UINT32_MAX indica slot vacío */
-        *((uint32_t *)(cur + OFF_PAGE)) = UINT32_MAX;
-        /* lru = 0 */
-        *((uint32_t *)(cur + OFF_LRU)) = 0U;
-        /* base pointer = 0 */
-        *((uintptr_t *)(cur + OFF_BASE)) = (uintptr_t)0;
-        /* limpiar cadenas binarias por claridad (opcional) */
-        memset(cur + OFF_PAGE_BIN, 0, PAGE_BIN_SIZE);
-        memset(cur + OFF_OFF_BIN, 0, OFF_BIN_SIZE);
-    }
+    FIELD32(tlb, H_LRU_MODE) = (uint32_t)lru_mode;
+    FIELD32(tlb, H_PROBE) = tlb_probe_kind;
+    tlb_seed(tlb, policy_seed);
+    return tlb;
+}
+
+/* Inicializa el TLB principal (tlb_heap) con la configuración global */
+void init_tlb(void)
+{
+    tlb_heap = tlb_create(tlb_sets, tlb_entries / tlb_sets, tlb_index_fn,
+                          tlb_layout, tlb_policy);
 }
 
 /* Libera recursos del TLB */
 void free_tlb(void)
 {
     if (tlb_heap) {
-        free(tlb_heap);
+        tlb_destroy(tlb_heap);
         tlb_heap = NULL;
     }
 }
 
-/* Busca en el TLB la entrada cuya page == page_num.
-   Devuelve puntero al slot (char*) o NULL.
-   Usa ≤3 punteros: start, cur, found. */
-char *tlb_find(uint32_t page_num)
+/* ---------- Espacio virtual de 48/57 bits (--va-bits) ---------- */
+
+/* Por defecto el espacio virtual es de 32 bits, como en el enunciado.
+   Con --va-bits 48 o 57 las direcciones son de 64 bits y deben estar
+   en forma canónica (los bits va_bits-1..63 iguales; si no, Page
+   Fault). El número de página (36 o 45 bits) no cabe en la etiqueta
+   uint32 de los slots, así que se le asigna un identificador denso en
+   orden de primera aparición (tabla hash abierta vpn_keys/vpn_ids) y
+   ese identificador es la etiqueta: el TLB, el sondeo SIMD y los
+   arreglos por página no cambian y el caso de 32 bits no paga nada.
+   Los vpn_low_bits bits bajos del identificador son los de la página
+   (los que usa el índice de conjunto del L1 y del L2), así que la
+   asociatividad se simula igual que con la página real; el resto es
+   un contador por cada valor de esos bits. Por eso hay dos límites:
+   VPN_IDS páginas distintas en toda la traza (4 GiB tocados) y
+   VPN_IDS / S páginas con los mismos bits de índice, con S los
+   conjuntos del mayor nivel (con --sets 1024, 1024 páginas separadas
+   por múltiplos de 4 MiB ya lo agotan). El índice XOR pliega todos los
+   bits de la etiqueta, que aquí son los del contador y no los de la
+   página, así que con 48/57 bits sólo se admite el índice bajo.
+   vpn_of_id guarda el número de página completo para el recorrido de
+   la tabla. */
+#define VPN_IDS       (1U << 20)
+#define VPN_HASH_BITS 21U
+#define VPN_BIN_SIZE  46U  /* 45 bits + '\0' */
+
+static uint64_t *vpn_keys = NULL;      /* VPN + 1 (0 = vacío) */
+static uint32_t *vpn_ids = NULL;
+static uint64_t *vpn_of_id = NULL;     /* identificador -> VPN */
+static uint32_t *vpn_next = NULL;      /* bits bajos -> próximo contador */
+static unsigned int vpn_low_bits = 0U;
+
+/* Prepara la tabla de identificadores; 'sets' es el mayor número de
+   conjuntos de los niveles de TLB. */
+int va_init(unsigned int sets)
+{
+    va_mask = (1ULL << va_bits) - 1U;
+    va_parse_max = UINT64_MAX / 10U - 1U;
+    vpn_keys = (uint64_t *)calloc(1U << VPN_HASH_BITS, sizeof(uint64_t));
+    vpn_ids = (uint32_t *)malloc((1U << VPN_HASH_BITS) * sizeof(uint32_t));
+    vpn_of_id = (uint64_t *)malloc(VPN_IDS * sizeof(uint64_t));
+    while ((1U << vpn_low_bits) < sets) ++vpn_low_bits;
+    vpn_next = (uint32_t *)calloc(1U << vpn_low_bits, sizeof(uint32_t));
+    if (!vpn_keys || !vpn_ids || !vpn_of_id || !vpn_next) {
+        perror("malloc páginas de 64 bits");
+        return 0;
+    }
+    return 1;
+}
+
+/* Identificador denso del número de página 'vpn' (lo crea la primera
+   vez). Termina el programa si se agotan los identificadores de sus
+   bits bajos (VPN_IDS >> vpn_low_bits páginas con el mismo índice). */
+static uint32_t vpn_intern(uint64_t vpn)
+{
+    uint32_t h = (uint32_t)((vpn * 0x9E3779B97F4A7C15ULL)
+                            >> (64U - VPN_HASH_BITS));
+    uint32_t low = (uint32_t)vpn & ((1U << vpn_low_bits) - 1U);
+    uint32_t id;
+    while (vpn_keys[h] != 0U) {
+        if (vpn_keys[h] == vpn + 1U) return vpn_ids[h];
+        h = (h + 1U) & ((1U << VPN_HASH_BITS) - 1U);
+    }
+    if (vpn_next[low] == VPN_IDS >> vpn_low_bits) {
+        fprintf(stderr, "Error: con --va-bits %u la traza puede tocar a lo"
+                " sumo %u páginas distintas con los mismos %u bits de"
+                " índice (%u en total)\n", va_bits,
+                VPN_IDS >> vpn_low_bits, vpn_low_bits, VPN_IDS);
+        exit(EXIT_FAILURE);
+    }
+    id = (vpn_next[low]++ << vpn_low_bits) | low;
+    vpn_keys[h] = vpn + 1U;
+    vpn_ids[h] = id;
+    vpn_of_id[id] = vpn;
+    return id;
+}
+
+/* ---------- Tabla de páginas (10/10/12 o 4/5 niveles de 9 bits) ---- */
+
+/* Con --walk cada Miss en todos los niveles de TLB recorre una tabla
+   de páginas estilo x86-32: un directorio de 1024 entradas (punteros a
+   tablas de páginas) y tablas de 1024 PTE uint32 (bit 0 = presente,
+   bits 12..31 = marco). Directorio y tablas se crean en el heap a
+   medida que se tocan. Una página sin PTE presente produce un fallo
+   de página real; el "manejador" le asigna el siguiente marco libre
+   (paginación por demanda). Con --asids cada espacio de direcciones
+   tiene su propio directorio.
+   Con --va-bits 48/57 la tabla es la de x86-64: 4 o 5 niveles de 512
+   entradas (9 bits cada uno) con la raíz por ASID en pt_dir; los
+   niveles intermedios guardan punteros y las hojas 512 PTE uint32.
+   Delante del directorio hay una caché de recorridos (PWC) pequeña,
+   totalmente asociativa y LRU, que guarda prefijo de la página ->
+   tabla hoja: con un Hit el recorrido sólo lee la PTE. */
+#define PT_ENTRIES    1024U
+#define PT_WIDE_ENTRIES 512U
+#define PTE_PRESENT   0x1U
+#define PWC_MAX       64U
+
+/* Slot de la PWC: [0..7] clave (índice de directorio o prefijo de la
+   página y ASID; UINT64_MAX = vacío), [8..15] marca LRU de 64 bits
+   (no da la vuelta), [16..23] puntero a la tabla hoja. */
+#define PWC_OFF_DIR   0U
+#define PWC_OFF_LRU   8U
+#define PWC_OFF_TABLE 16U
+#define PWC_SLOT_SIZE (PWC_OFF_TABLE + (unsigned int)sizeof(uintptr_t))
+
+static int walk_enabled = 0;
+static char *pt_dir = NULL;  /* 1024 uintptr_t por ASID, o una raíz por ASID */
+static char *pwc = NULL;             /* caché de recorridos */
+static unsigned int pwc_entries = 4U;
+static uint64_t pwc_counter = 1U;
+static uint32_t pt_next_frame = 0U;
+static unsigned int lat_mem = 15U;   /* ciclos por acceso a memoria */
+static unsigned int lat_fault = 1000U;
+static int last_fault = 0;           /* el último recorrido falló */
+
+static uint64_t stat_walks = 0U;
+static uint64_t stat_walk_mem = 0U;
+static uint64_t stat_pwc_hits = 0U;
+static uint64_t stat_pt_faults = 0U;
+static uint64_t stat_pt_tables = 0U;
+
+/* Niveles de la tabla de páginas con --va-bits 48/57 */
+#define PT_LEVELS ((va_bits - 12U) / 9U)
+
+/* Vacía la PWC (cambio de contexto sin ASID) */
+void pwc_flush(void)
+{
+    unsigned int i;
+    for (i = 0U; i < pwc_entries; ++i) {
+        *((uint64_t *)(pwc + (size_t)i * PWC_SLOT_SIZE + PWC_OFF_DIR))
+            = UINT64_MAX;
+    }
+}
+
+void pt_init(void)
+{
+    size_t roots = asid_count ? asid_count : 1U;
+    pt_dir = (char *)calloc(va_bits == 32U ? roots * PT_ENTRIES : roots,
+                            sizeof(uintptr_t));
+    pwc = (char *)calloc((size_t)(pwc_entries ? pwc_entries : 1U),
+                         PWC_SLOT_SIZE); /* marcas LRU a 0 */
+    if (!pt_dir || !pwc) {
+        perror("malloc tabla de páginas");
+        exit(EXIT_FAILURE);
+    }
+    pwc_flush();
+}
+
+/* Libera un nodo de la tabla de x86-64 y sus hijos; 'depth' es el
+   número de niveles por debajo de él (0 = hoja). */
+static void pt_free_node(char *node, unsigned int depth)
 {
-    char *start = tlb_heap;
-    char *cur = NULL;
-    char *found = NULL;
     unsigned int i;
-    for (i = 0U; i < TLB_MAX_ENTRIES; ++i) {
-        cur = start + (size_t)i * (size_t)SLOT_SIZE;
-        uint32_t p = *((uint32_t *)(cur + OFF_PAGE));
-        if (p == page_num) { found = cur; break; }
+    if (!node) return;
+    for (i = 0U; depth > 0U && i < PT_WIDE_ENTRIES; ++i) {
+        pt_free_node((char *)*((uintptr_t *)(node + i * sizeof(uintptr_t))),
+                     depth - 1U);
     }
-    return found;
+    free(node);
 }
 
-/* Inserta/actualiza una entrada en el TLB (LRU).
-   Devuelve la dirección base de memoria (uintptr_t) que fue reemplazada,
-   o (uintptr_t)0 si no hubo reemplazo (inserción en slot libre).
-   Usa ≤3 punteros: start, cur, victim. */
-uintptr_t tlb_insert(uint32_t page_num,
-                     uint32_t offset_num,
-                     const char *page_bin, const char *off_bin)
+void pt_free(void)
 {
-    char *start = tlb_heap;
-    char *cur = NULL;
-    char *victim = NULL; /* se usa también como candidato LRU */
     unsigned int i;
+    unsigned int roots = asid_count ? asid_count : 1U;
+    if (pt_dir) {
+        for (i = 0U; i < (va_bits == 32U ? PT_ENTRIES * roots : roots); ++i) {
+            char *node = (char *)*((uintptr_t *)(pt_dir
+                                                 + i * sizeof(uintptr_t)));
+            if (va_bits == 32U) free(node);
+            else pt_free_node(node, PT_LEVELS - 1U);
+        }
+        free(pt_dir);
+        pt_dir = NULL;
+    }
+    free(pwc);
+    pwc = NULL;
+}
 
-    /* 1) Buscar slot vacío */
-    for (i = 0U; i < TLB_MAX_ENTRIES; ++i) {
-        cur = start + (size_t)i * (size_t)SLOT_SIZE;
-        uint32_t p = *((uint32_t *)(cur + OFF_PAGE));
-        if (p == UINT32_MAX) {
-            /* slot vacío -> insertar aquí (guardamos la dirección del slot) */
-            *((uintptr_t *)(cur + OFF_BASE)) = (uintptr_t)cur;
-            *((uint32_t *)(cur + OFF_PAGE)) = page_num;
-            *((uint32_t *)(cur + OFF_OFFS)) = offset_num;
-            memcpy(cur + OFF_PAGE_BIN, page_bin, PAGE_BIN_SIZE);
-            memcpy(cur + OFF_OFF_BIN, off_bin, OFF_BIN_SIZE);
-            *((uint32_t *)(cur + OFF_LRU)) = access_counter++;
-            return (uintptr_t)0; /* no hubo reemplazo */
+/* Devuelve la tabla a la que apunta la entrada 'entry', creándola (de
+   'bytes' bytes) si no existía. Usa ≤3 punteros: entry, table. */
+static char *pt_child(char *entry, size_t bytes)
+{
+    char *table = (char *)*((uintptr_t *)entry);
+    if (!table) {
+        table = (char *)calloc(1U, bytes);
+        if (!table) {
+            perror("malloc tabla de páginas");
+            exit(EXIT_FAILURE);
         }
+        *((uintptr_t *)entry) = (uintptr_t)table;
+        ++stat_pt_tables;
     }
+    return table;
+}
+
+/* Tabla hoja de la clave 'key' sin pasar por la PWC: un acceso a
+   memoria por cada nivel por encima de la hoja (la PDE en 32 bits).
+   Usa ≤3 punteros: node. */
+static char *pt_leaf_of(uint64_t key)
+{
+    char *node;
+    unsigned int lvl;
+    if (va_bits == 32U) {
+        ++stat_walk_mem; /* lectura de la PDE */
+        return pt_child(pt_dir + (size_t)key * sizeof(uintptr_t),
+                        PT_ENTRIES * sizeof(uint32_t));
+    }
+    /* raíz del ASID (CR3: no es un acceso a memoria) */
+    node = pt_child(pt_dir + (size_t)(key >> 48) * sizeof(uintptr_t),
+                    PT_WIDE_ENTRIES * sizeof(uintptr_t));
+    for (lvl = PT_LEVELS - 1U; lvl > 0U; --lvl) {
+        ++stat_walk_mem;
+        node = pt_child(node + (size_t)((key >> (9U * (lvl - 1U))) & 0x1FFU)
+                        * sizeof(uintptr_t),
+                        lvl > 1U ? PT_WIDE_ENTRIES * sizeof(uintptr_t)
+                                 : PT_WIDE_ENTRIES * sizeof(uint32_t));
+    }
+    return node;
+}
+
+/* Busca en la PWC la tabla hoja de 'key': el índice de directorio en
+   32 bits (con --asids, ASID * 1024 + índice) o, con 48/57 bits,
+   ASID << 48 | página >> 9. La PWC también va etiquetada por ASID.
+   Con un Miss se recorren los niveles superiores (pt_leaf_of) y la
+   tabla se guarda en la PWC reemplazando la menos reciente.
+   Usa ≤3 punteros: cur, victim, table. */
+char *pwc_lookup(uint64_t key)
+{
+    char *cur;
+    char *victim = NULL;
+    uint64_t min_lru = UINT64_MAX;
+    unsigned int i;
 
-    /* 2) TLB lleno -> buscar victim por LRU (min) usando 'victim' */
-    uint32_t min_lru = UINT32_MAX;
-    for (i = 0U; i < TLB_MAX_ENTRIES; ++i) {
-        cur = start + (size_t)i * (size_t)SLOT_SIZE;
-        uint32_t l = *((uint32_t *)(cur + OFF_LRU));
-        if (l < min_lru) { min_lru = l; victim = cur; }
+    for (i = 0U; i < pwc_entries; ++i) {
+        cur = pwc + (size_t)i * PWC_SLOT_SIZE;
+        if (*((uint64_t *)(cur + PWC_OFF_DIR)) == key) {
+            ++stat_pwc_hits;
+            *((uint64_t *)(cur + PWC_OFF_LRU)) = pwc_counter++;
+            return (char *)*((uintptr_t *)(cur + PWC_OFF_TABLE));
+        }
+        if (*((uint64_t *)(cur + PWC_OFF_LRU)) < min_lru) {
+            min_lru = *((uint64_t *)(cur + PWC_OFF_LRU));
+            victim = cur;
+        }
     }
 
+    char *table = pt_leaf_of(key);
     if (victim) {
-        uintptr_t replaced_base = *((uintptr_t *)(victim + OFF_BASE));
-        /* reemplazar contenido de victim */
-        *((uintptr_t *)(victim + OFF_BASE)) = (uintptr_t)victim;
-        *((uint32_t *)(victim + OFF_PAGE)) = page_num;
-        *((uint32_t *)(victim + OFF_OFFS)) = offset_num;
-        memcpy(victim + OFF_PAGE_BIN, page_bin, PAGE_BIN_SIZE);
-        memcpy(victim + OFF_OFF_BIN, off_bin, OFF_BIN_SIZE);
-        *((uint32_t *)(victim + OFF_LRU)) = access_counter++;
-        return replaced_base;
+        *((uint64_t *)(victim + PWC_OFF_DIR)) = key;
+        *((uint64_t *)(victim + PWC_OFF_LRU)) = pwc_counter++;
+        *((uintptr_t *)(victim + PWC_OFF_TABLE)) = (uintptr_t)table;
+    }
+    return table;
+}
+
+/* Recorre la tabla de páginas para la etiqueta page_num y devuelve el
+   costo en ciclos (accesos a memoria x lat_mem, más lat_fault si la
+   página no estaba mapeada). Deja el marco en *frame y last_fault
+   actualizado. Usa ≤3 punteros: table. */
+unsigned int pt_walk(uint32_t page_num, uint32_t *frame)
+{
+    uint64_t mem_before = stat_walk_mem;
+    char *table;
+    uint32_t *pte;
+    unsigned int cycles = 0U;
+
+    if (va_bits == 32U) {
+        table = pwc_lookup((TAG_ASID(page_num) << 10)
+                           | ((page_num >> 10) & 0x3FFU));
+        pte = (uint32_t *)(table + (page_num & 0x3FFU) * 4U);
+    } else {
+        uint64_t vpn = vpn_of_id[page_num & TAG_PAGE_MASK];
+        table = pwc_lookup(((uint64_t)TAG_ASID(page_num) << 48) | (vpn >> 9));
+        pte = (uint32_t *)(table + (vpn & 0x1FFU) * 4U);
+    }
+    ++stat_walks;
+    ++stat_walk_mem; /* lectura de la PTE */
+    last_fault = (*pte & PTE_PRESENT) == 0U;
+    if (last_fault) {
+        ++stat_pt_faults;
+        *pte = (pt_next_frame++ << 12) | PTE_PRESENT;
+        cycles += lat_fault;
+    }
+    *frame = *pte >> 12;
+    return cycles + (unsigned int)(stat_walk_mem - mem_before) * lat_mem;
+}
+
+/* ---------- Páginas grandes (--pages) ---------- */
+
+/* Con --pages ARCHIVO cada región virtual puede usar páginas de
+   4 KiB, 2 MiB o 1 GiB. Cada entrada del TLB guarda una etiqueta que
+   identifica a la vez la página y su tamaño:
+     [0, 2^20)                       página de 4 KiB (número de página)
+     [2^20, 2^20 + 2^11)             página de 2 MiB
+     [2^20 + 2^11, 2^20 + 2^11 + 4)  página de 1 GiB
+   de modo que una misma búsqueda encuentra entradas de cualquier
+   tamaño y los arreglos indexados por página (páginas vistas, OPT,
+   MRC) siguen siendo densos. Sin --pages la etiqueta es vaddr >> 12.
+   Con --asids el ASID actual va en los bits altos (asid_tag) y esos
+   arreglos tienen tag_space posiciones.
+
+   Formato del archivo: una región por línea, "INICIO FIN TAMAÑO" con
+   INICIO/FIN (FIN excluido) en decimal o 0x hexadecimal y TAMAÑO 4K,
+   2M o 1G; '#' inicia un comentario y las líneas posteriores
+   sobrescriben a las anteriores. El tamaño se guarda por bloque de
+   2 MiB, así que las regiones deben estar alineadas a su tamaño de
+   página. */
+#define PSIZE_4K 0
+#define PSIZE_2M 1
+#define PSIZE_1G 2
+#define TAG_2M_BASE (1U << 20)
+#define TAG_1G_BASE (TAG_2M_BASE + (1U << 11))
+#define PAGE_TAGS   (TAG_1G_BASE + 4U)
+#define TAG_CLASS(t) \
+    (((t) & TAG_PAGE_MASK) < TAG_2M_BASE ? PSIZE_4K \
+     : (((t) & TAG_PAGE_MASK) < TAG_1G_BASE ? PSIZE_2M : PSIZE_1G))
+
+_Static_assert(PAGE_TAGS <= (1U << ASID_SHIFT),
+               "las etiquetas de página invaden los bits del ASID");
+
+static uint32_t tag_space = PAGE_TAGS; /* etiquetas posibles (con ASID) */
+
+static const unsigned int psize_shift[3] = { 12U, 21U, 30U };
+static const char *const psize_names[3] = { "4 KiB", "2 MiB", "1 GiB" };
+static unsigned char *page_map = NULL;   /* bloque de 2 MiB -> PSIZE_* */
+
+/* TLB separados por tamaño (--split-tlb): con entradas > 0 las páginas
+   de 2 MiB / 1 GiB van a su propio L1 totalmente asociativo en vez de
+   compartir tlb_heap con las de 4 KiB. */
+static char *tlb_huge[2] = { NULL, NULL };
+static unsigned int huge_entries[2] = { 0U, 0U };
+
+/* Comparación con un TLB igual que sólo usa páginas de 4 KiB */
+static char *tlb_base4k = NULL;
+static uint64_t stat_base_hits = 0U;
+static uint64_t stat_size_acc[3];
+static uint64_t stat_size_hits[3];
+
+/* Etiqueta (página y tamaño) de una dirección virtual. Con 48/57 bits
+   es el identificador denso de la página (sin --pages). */
+static inline uint32_t page_tag(uint64_t vaddr)
+{
+    if (va_bits != 32U) return vpn_intern((vaddr & va_mask) >> 12) | asid_tag;
+    if (!page_map) return (uint32_t)(vaddr >> 12) | asid_tag;
+    switch (page_map[vaddr >> 21]) {
+    case PSIZE_2M:
+        return (TAG_2M_BASE + (vaddr >> 21)) | asid_tag;
+    case PSIZE_1G:
+        return (TAG_1G_BASE + (vaddr >> 30)) | asid_tag;
+    default:
+        return (vaddr >> 12) | asid_tag;
     }
-    return (uintptr_t)0;
 }
 
-/* Actualiza el LRU de la entrada al valor actual de access_counter.
-   Usa ≤3 punteros: (no declara más punteros aquí) */
-void tlb_update_lru(char *slot_ptr)
+/* L1 que guarda las entradas de la etiqueta */
+static inline char *l1_of(uint32_t tag)
 {
-    *((uint32_t *)(slot_ptr + OFF_LRU)) = access_counter++;
+    int c = TAG_CLASS(tag);
+    return c != PSIZE_4K && tlb_huge[c - 1] ? tlb_huge[c - 1] : tlb_heap;
 }
 
-/* Muestra la dirección base-fín del TLB como pide el enunciado */
-void print_tlb_bounds(void)
+/* Tamaño en bytes o "4K"/"2M"/"1G" -> PSIZE_*, o -1 */
+static int parse_psize(const char *s)
 {
-    printf("TLB desde %p hasta %p\n",
-           (void *)tlb_heap,
-           (void *)(tlb_heap + (size_t)tlb_bytes - 1U));
+    if (strcmp(s, "4K") == 0 || strcmp(s, "4k") == 0
+        || strcmp(s, "4096") == 0) return PSIZE_4K;
+    if (strcmp(s, "2M") == 0 || strcmp(s, "2m") == 0
+        || strcmp(s, "2097152") == 0) return PSIZE_2M;
+    if (strcmp(s, "1G") == 0 || strcmp(s, "1g") == 0
+        || strcmp(s, "1073741824") == 0) return PSIZE_1G;
+    return -1;
 }
 
-/* ---------- Programa principal ---------- */
+/* Lee un límite de región en *p: decimal o hexadecimal con "0x" (un
+   0 inicial no se toma como octal), sin signo y seguido de un blanco.
+   Avanza *p detrás del número. Devuelve 0 si no es válido. */
+static int parse_region_addr(char **p, unsigned long long *out)
+{
+    char *s = *p;
+    char *endptr = NULL;
+    while (*s == ' ' || *s == '\t') ++s;
+    if (*s == '-' || *s == '+') return 0; /* strtoull acepta "-1" */
+    int hex = s[0] == '0' && (s[1] == 'x' || s[1] == 'X');
+    errno = 0;
+    unsigned long long val = strtoull(s, &endptr, hex ? 16 : 10);
+    if (endptr == s || errno != 0
+        || (*endptr != ' ' && *endptr != '\t')) return 0;
+    *out = val;
+    *p = endptr;
+    return 1;
+}
 
-int main(void)
+/* Carga el archivo de regiones. Devuelve 0 (con mensaje) si es
+   inválido; en ese caso no queda mapa (page_map = NULL). */
+int page_map_load(const char *path)
 {
-    char line[128];
-    init_tlb(); /* crea region en heap y marca vacío */
+    FILE *f = fopen(path, "r");
+    char line[256];
+    unsigned int lineno = 0U;
+    int ok = 1;
 
-    while (1) {
-        printf("Ingrese dirección virtual: ");
-        if (!fgets(line, sizeof(line), stdin)) break;
-        /* quitar '\n' */
-        size_t ln = strlen(line);
-        if (ln > 0 && line[ln - 1] == '\n') line[ln - 1] = '\0';
-        if (strcmp(line, "s") == 0) {
-            printf("Good bye!\n");
+    if (!f) {
+        perror(path);
+        return 0;
+    }
+    page_map = (unsigned char *)calloc(1U << 11, 1U);
+    if (!page_map) {
+        perror("malloc páginas");
+        fclose(f);
+        return 0;
+    }
+    while (ok && fgets(line, sizeof(line), f)) {
+        char size[32];
+        unsigned long long start, end;
+        char *cur = line;
+        char *hash = strchr(line, '#');
+        ++lineno;
+        if (hash) *hash = '\0';
+        if (sscanf(line, "%31s", size) != 1) continue; /* línea vacía */
+        if (!parse_region_addr(&cur, &start)
+            || !parse_region_addr(&cur, &end)
+            || sscanf(cur, "%31s", size) != 1) {
+            fprintf(stderr, "%s:%u: se espera INICIO FIN TAMAÑO\n",
+                    path, lineno);
+            ok = 0;
+            break;
+        }
+        int c = parse_psize(size);
+        if (c < 0 || end > (1ULL << 32) || start >= end
+            || (start | end) & ((1ULL << psize_shift[c]) - 1U)) {
+            fprintf(stderr, "%s:%u: región inválida o no alineada a %s\n",
+                    path, lineno, c < 0 ? size : psize_names[c]);
+            ok = 0;
+            break;
+        }
+        if (c == PSIZE_4K && ((start | end) & ((1ULL << 21) - 1U))) {
+            fprintf(stderr, "%s:%u: las regiones de 4 KiB deben cubrir"
+                    " bloques de 2 MiB completos\n", path, lineno);
+            ok = 0;
             break;
         }
+        memset(page_map + (start >> 21), c, (size_t)((end - start) >> 21));
+    }
+    fclose(f);
+    if (!ok) {
+        free(page_map);
+        page_map = NULL;
+    }
+    return ok;
+}
 
-        /* imprimir bounds (requisito) */
-        print_tlb_bounds();
+/* Crea los L1 por tamaño y el TLB de comparación de 4 KiB */
+void huge_init(void)
+{
+    unsigned int c;
+    if (!page_map) return;
+    for (c = 0U; c < 2U; ++c) {
+        if (huge_entries[c]) {
+            tlb_huge[c] = tlb_create(1U, huge_entries[c], INDEX_LOW,
+                                     tlb_layout, tlb_policy == POL_OPT
+                                     ? POL_LRU : tlb_policy);
+        }
+    }
+    tlb_base4k = tlb_create(tlb_sets, tlb_entries / tlb_sets, tlb_index_fn,
+                            tlb_layout,
+                            tlb_policy == POL_OPT ? POL_LRU : tlb_policy);
+}
 
-        /* parseo y validación */
-        uint32_t vaddr;
-        if (!parse_address(line, &vaddr)) {
-            printf("Page Fault\n");
-            continue;
+void huge_free(void)
+{
+    unsigned int c;
+    for (c = 0U; c < 2U; ++c) {
+        if (tlb_huge[c]) tlb_destroy(tlb_huge[c]);
+        tlb_huge[c] = NULL;
+    }
+    if (tlb_base4k) tlb_destroy(tlb_base4k);
+    tlb_base4k = NULL;
+}
+
+/* Estadísticas por tamaño y el mismo acceso en el TLB de sólo 4 KiB.
+   Usa ≤3 punteros: slot. */
+void huge_account(uint64_t vaddr, int hit)
+{
+    static const char zeros[PAGE_BIN_SIZE];
+    int c = TAG_CLASS(page_tag(vaddr));
+    char *slot;
+
+    ++stat_size_acc[c];
+    if (hit) ++stat_size_hits[c];
+    slot = tlb_find(tlb_base4k, (uint32_t)(vaddr >> 12) | asid_tag);
+    if (slot) {
+        tlb_update_lru(tlb_base4k, slot);
+        ++stat_base_hits;
+    } else {
+        tlb_insert(tlb_base4k, (uint32_t)(vaddr >> 12) | asid_tag, 0U, zeros,
+                   zeros, NULL);
+    }
+}
+
+/* Alcance (bytes cubiertos por las entradas válidas) de un TLB */
+uint64_t tlb_reach(char *tlb)
+{
+    uint64_t reach = 0U;
+    uint32_t i;
+    if (!tlb) return 0U;
+    for (i = 0U; i < FIELD32(tlb, H_ENTRIES); ++i) {
+        uint32_t tag = tlb_tag_at(tlb, i);
+        if (tag != UINT32_MAX) reach += 1ULL << psize_shift[TAG_CLASS(tag)];
+    }
+    return reach;
+}
+
+/* Resumen de páginas grandes: Hit por tamaño, alcance y Hit sin ellas */
+void print_huge_summary(uint64_t translated)
+{
+    int c;
+    if (!page_map) return;
+    printf("Páginas grandes:\n");
+    for (c = PSIZE_4K; c <= PSIZE_1G; ++c) {
+        if (stat_size_acc[c] == 0U) continue;
+        printf("  %s: %" PRIu64 " accesos, Hit %.2f%%", psize_names[c],
+               stat_size_acc[c],
+               100.0 * (double)stat_size_hits[c] / (double)stat_size_acc[c]);
+        if (c != PSIZE_4K && tlb_huge[c - 1]) {
+            printf(" (L1 propio de %u entradas)", huge_entries[c - 1]);
         }
+        printf("\n");
+    }
+    printf("  Alcance del TLB al final: %.2f MiB (sólo 4 KiB: %.2f MiB)\n",
+           (double)(tlb_reach(tlb_heap) + tlb_reach(tlb_huge[0])
+                    + tlb_reach(tlb_huge[1])) / 1048576.0,
+           (double)tlb_reach(tlb_base4k) / 1048576.0);
+    printf("  TLB Hit sin páginas grandes: %" PRIu64 " (%.2f%%)\n",
+           stat_base_hits,
+           translated ? 100.0 * (double)stat_base_hits / (double)translated
+                      : 0.0);
+}
 
-        /* calcular página y offset */
-        uint32_t page_num = vaddr >> 12;         /* 20 bits */
-        uint32_t offset_num = vaddr & 0xFFFU;    /* 12 bits */
+/* ---------- Jerarquía de TLB (L1 + L2/STLB) ---------- */
 
-        /* preparar representaciones binarias (variables requeridas) */
-        char page_bin[PAGE_BIN_SIZE]; /* variable para pagina en binario */
-        char off_bin[OFF_BIN_SIZE];   /* variable para offset en binario */
-        dec_to_bin(page_num, 20, page_bin);
-        dec_to_bin(offset_num, 12, off_bin);
+/* Niveles devueltos por tlb_access */
+#define LEVEL_MISS 0
+#define LEVEL_L1   1
+#define LEVEL_L2   2
+
+/* El TLB principal (tlb_heap) es el L1. Con --l2-entries se agrega un
+   L2 compartido (STLB) que se consulta sólo tras un Miss en L1:
+   - inclusivo: todo lo que está en L1 está en L2; al expulsar de L2
+     se invalida la copia en L1 (back-invalidation).
+   - exclusivo: L1 y L2 son disjuntos; un Hit en L2 mueve la entrada a
+     L1 y la víctima de L1 baja a L2.
+   Cada nivel suma su latencia al costo simulado en ciclos; un Miss en
+   todos los niveles suma además lat_walk o, con --walk, el costo real
+   del recorrido de la tabla de páginas (pt_walk). */
+static char *tlb_l2 = NULL;
+static unsigned int l2_entries = 0U;
+static unsigned int l2_sets = 1U;
+static int l2_exclusive = 0;
+static unsigned int lat_l1 = 1U;
+static unsigned int lat_l2 = 7U;
+static unsigned int lat_walk = 30U;
+
+static uint64_t stat_l2_hits = 0U;
+static uint64_t stat_l2_evictions = 0U;
+static uint64_t stat_back_inval = 0U;
+static uint64_t stat_cycles = 0U;
+
+/* Prefetch de traducciones (--prefetch). Tras cada Miss del L1 (de
+   una página de 4 KiB) y cada primer uso de una predicción el
+   prefetcher predice las próximas páginas:
+   - seq: las pf_degree páginas siguientes a la del Miss;
+   - stride: si la distancia entre este Miss y el anterior repite la
+     del par anterior (y no es 0), pf_degree páginas más con ese paso.
+   Las traducciones predichas van a un buffer de prefetch (tlb_pf,
+   totalmente asociativo) que se consulta junto con el L1: un Hit en
+   el buffer es un Hit del acceso (sin walk) y la entrada pasa al L1.
+   Con --prefetch-buf 0 se instalan directamente en el L1 y pueden
+   expulsar entradas útiles. Sin --walk instalar una predicción no
+   suma ciclos. Con --walk cada predicción hace su propio recorrido
+   (pt_probe) fuera del camino crítico: sus accesos a memoria se
+   cuentan aparte (stat_pf_walks, stat_pf_walk_mem) y no en los ciclos
+   ni en los walks de demanda. Si la PTE no está presente la
+   predicción se descarta: el prefetcher no provoca fallos de página,
+   así que el acceso de demanda falla y recorre la tabla como sin
+   prefetch. pf_pending marca con un bit por etiqueta las páginas
+   predichas aún no usadas. Un L1 igual sin prefetch (tlb_pf_base,
+   con su propio xorshift y la misma semilla, así que RANDOM elige las
+   mismas víctimas que sin prefetch; recibe los vaciados de ASID pero
+   no las invalidaciones del L2 inclusivo) da los Miss de referencia
+   para la cobertura; un Miss del L1 que ese TLB habría acertado es un
+   Miss por contaminación. */
+#define PF_NONE       0
+#define PF_SEQ        1
+#define PF_STRIDE     2
+#define PF_DEGREE_MAX 16U
+#define PF_BIT(t)     ((pf_pending[(t) >> 3] >> ((t) & 7U)) & 1U)
+#define PF_SET(t) \
+    (pf_pending[(t) >> 3] |= (unsigned char)(1U << ((t) & 7U)))
+#define PF_CLEAR(t) \
+    (pf_pending[(t) >> 3] &= (unsigned char)~(1U << ((t) & 7U)))
+
+static const char *const pf_names[] = { "ninguno", "seq", "stride" };
+static int pf_kind = PF_NONE;            /* --prefetch */
+static unsigned int pf_buf_entries = 16U; /* --prefetch-buf (0 = al L1) */
+static unsigned int pf_degree = 1U;      /* --prefetch-degree */
+static char *tlb_pf = NULL;              /* buffer de prefetch */
+static char *tlb_pf_base = NULL;         /* L1 sin prefetch */
+static unsigned char *pf_pending = NULL;
+static uint64_t pf_last_vpn = UINT64_MAX; /* página del Miss anterior */
+static int64_t pf_stride = 0;
+
+static uint64_t stat_pf_issued = 0U;     /* predicciones instaladas */
+static uint64_t stat_pf_redundant = 0U;  /* ya estaban en el L1 o buffer */
+static uint64_t stat_pf_useful = 0U;     /* usadas por un acceso */
+static uint64_t stat_pf_evictions = 0U;  /* entradas del L1 expulsadas */
+/* Miss que el L1 sin prefetch habría acertado */
+static uint64_t stat_pf_pollution = 0U;
+static uint64_t stat_pf_base_misses = 0U; /* Miss del L1 sin prefetch */
+static uint64_t stat_pf_walks = 0U;      /* recorridos de predicciones */
+static uint64_t stat_pf_walk_mem = 0U;   /* sus accesos a memoria */
+static uint64_t stat_pf_dropped = 0U;    /* descartadas: PTE no presente */
+
+void pf_init(void)
+{
+    if (pf_kind == PF_NONE) return;
+    pf_pending = (unsigned char *)calloc(((size_t)tag_space + 7U) / 8U, 1U);
+    if (!pf_pending) {
+        perror("malloc prefetch");
+        exit(EXIT_FAILURE);
+    }
+    tlb_pf_base = tlb_create(tlb_sets, tlb_entries / tlb_sets, tlb_index_fn,
+                             tlb_layout, tlb_policy);
+    if (pf_buf_entries) {
+        tlb_pf = tlb_create(1U, pf_buf_entries, INDEX_LOW, LAYOUT_AOS,
+                            POL_LRU);
+    }
+}
+
+void pf_free(void)
+{
+    free(pf_pending);
+    pf_pending = NULL;
+    if (tlb_pf_base) {
+        tlb_destroy(tlb_pf_base);
+        tlb_pf_base = NULL;
+    }
+    if (tlb_pf) {
+        tlb_destroy(tlb_pf);
+        tlb_pf = NULL;
+    }
+}
+
+void init_levels(void)
+{
+    init_tlb();
+    huge_init();
+    if (walk_enabled) pt_init();
+    if (l2_entries) {
+        /* el L2 siempre es LRU: --policy sólo afecta al L1 */
+        tlb_l2 = tlb_create(l2_sets, l2_entries / l2_sets, tlb_index_fn,
+                            tlb_layout, POL_LRU);
+    }
+    pf_init();
+}
+
+void free_levels(void)
+{
+    if (tlb_l2) {
+        tlb_destroy(tlb_l2);
+        tlb_l2 = NULL;
+    }
+    pf_free();
+    pt_free();
+    huge_free();
+    free_tlb();
+}
 
-        /* medir tiempo: inicio */
-        struct timeval t0, t1;
-        gettimeofday(&t0, NULL);
+/* Instala una página en el L2. En la política inclusiva la página
+   expulsada del L2 se invalida también en el L1.
+   Usa ≤3 punteros: slot. */
+void l2_install(uint32_t page_num, uint32_t offset_num)
+{
+    char page_bin[PAGE_BIN_SIZE];
+    char off_bin[OFF_BIN_SIZE];
+    uint32_t evicted = UINT32_MAX;
 
-        /* buscar en TLB */
-        char *slot = tlb_find(page_num);
+    dec_to_bin(page_num, 20, page_bin);
+    dec_to_bin(offset_num, 12, off_bin);
+    if (tlb_insert(tlb_l2, page_num, offset_num, page_bin, off_bin,
+                   &evicted) == (uintptr_t)0) {
+        return;
+    }
+    ++stat_l2_evictions;
+    if (!l2_exclusive) {
+        char *slot = tlb_find(l1_of(evicted), evicted);
         if (slot) {
-            /* HIT */
-            printf("TLB Hit\n");
-            tlb_update_lru(slot);
-            /* al ser hit, no hubo reemplazo -> mostrar 0x0 */
-            printf("Politica de reemplazo: 0x0\n");
+            tlb_invalidate(l1_of(evicted), slot);
+            ++stat_back_inval;
+        }
+    }
+}
+
+/* Instala una predicción en el L1 (--prefetch-buf 0) como lo haría un
+   Miss, con la víctima al L2 exclusivo o la copia en el L2 inclusivo.
+   Usa ≤3 punteros: l1. */
+static void pf_install_l1(uint32_t tag)
+{
+    char page_bin[PAGE_BIN_SIZE];
+    char off_bin[OFF_BIN_SIZE];
+    char *l1 = l1_of(tag);
+    uint32_t evicted = UINT32_MAX;
+
+    if (tlb_layout != LAYOUT_COMPACT) {
+        dec_to_bin(tag & TAG_PAGE_MASK, 20, page_bin);
+        dec_to_bin(0U, 12, off_bin);
+    }
+    if (tlb_insert(l1, tag, 0U, page_bin, off_bin, &evicted)
+        != (uintptr_t)0) {
+        ++stat_pf_evictions;
+        if (tlb_l2 && l2_exclusive) l2_install(evicted, 0U);
+    }
+    if (tlb_l2 && !l2_exclusive) l2_install(tag, 0U);
+}
+
+/* Repite el acceso en el L1 sin prefetch; devuelve 1 si acierta.
+   Usa ≤3 punteros: slot. */
+static int pf_base_access(uint32_t tag)
+{
+    static const char zeros[PAGE_BIN_SIZE];
+    char *slot = tlb_find(tlb_pf_base, tag);
+    if (slot) {
+        tlb_update_lru(tlb_pf_base, slot);
+        return 1;
+    }
+    ++stat_pf_base_misses;
+    tlb_insert(tlb_pf_base, tag, 0U, zeros, zeros, NULL);
+    return 0;
+}
+
+/* Recorrido del prefetcher para la página de 4 KiB page_num (sólo 32
+   bits): lee la PWC sin actualizarla, o la PDE, y la PTE. No crea
+   tablas, no asigna marcos y no toca los contadores de demanda; sus
+   accesos van a stat_pf_walks/stat_pf_walk_mem. Devuelve 1 si la PTE
+   está presente. Usa ≤3 punteros: cur, table. */
+static int pt_probe(uint32_t page_num)
+{
+    uint64_t key = (TAG_ASID(page_num) << 10) | ((page_num >> 10) & 0x3FFU);
+    char *table = NULL;
+    char *cur;
+    unsigned int i;
+
+    ++stat_pf_walks;
+    for (i = 0U; i < pwc_entries; ++i) {
+        cur = pwc + (size_t)i * PWC_SLOT_SIZE;
+        if (*((uint64_t *)(cur + PWC_OFF_DIR)) == key) {
+            table = (char *)*((uintptr_t *)(cur + PWC_OFF_TABLE));
+            break;
+        }
+    }
+    if (i == pwc_entries) {
+        ++stat_pf_walk_mem; /* lectura de la PDE */
+        table = (char *)*((uintptr_t *)(pt_dir
+                                        + (size_t)key * sizeof(uintptr_t)));
+        if (!table) return 0;
+    }
+    ++stat_pf_walk_mem; /* lectura de la PTE */
+    return (*(uint32_t *)(table + (page_num & 0x3FFU) * 4U)
+            & PTE_PRESENT) != 0U;
+}
+
+/* Entrena el prefetcher con el Miss del L1 en vaddr e instala sus
+   predicciones (que no estén ya en el L1 ni en el buffer y, con
+   --walk, cuya PTE esté presente). */
+static void pf_trigger(uint64_t vaddr)
+{
+    uint64_t vpn = vaddr >> 12;
+    int64_t step = 1;
+    unsigned int k;
+
+    if (pf_kind == PF_STRIDE) {
+        step = (int64_t)(vpn - pf_last_vpn);
+        int confirmed = pf_last_vpn != UINT64_MAX && step == pf_stride
+                        && step != 0;
+        pf_stride = step;
+        pf_last_vpn = vpn;
+        if (!confirmed) return;
+    }
+    for (k = 1U; k <= pf_degree; ++k) {
+        uint64_t next = vpn + (uint64_t)(step * (int64_t)k);
+        if (next >= (1ULL << 20)) break; /* fuera del espacio de 32 bits */
+        uint32_t tag = page_tag(next << 12);
+        if (TAG_CLASS(tag) != PSIZE_4K) continue;
+        if (tlb_find(l1_of(tag), tag)
+            || (tlb_pf && tlb_find(tlb_pf, tag))) {
+            ++stat_pf_redundant;
+            continue;
+        }
+        if (walk_enabled && !pt_probe(tag)) {
+            ++stat_pf_dropped;
+            continue;
+        }
+        ++stat_pf_issued;
+        PF_SET(tag);
+        if (tlb_pf) {
+            static const char zeros[PAGE_BIN_SIZE];
+            tlb_insert(tlb_pf, tag, 0U, zeros, zeros, NULL);
         } else {
-            /* MISS: insertar y posiblemente reemplazar */
-            printf("TLB Miss\n");
-            uintptr_t replaced = tlb_insert(page_num, offset_num,
-                                            page_bin, off_bin);
-            if (replaced == (uintptr_t)0) {
-                printf("Politica de reemplazo: 0x0\n");
+            pf_install_l1(tag);
+        }
+    }
+}
+
+/* Traduce una dirección recorriendo los niveles de TLB.
+   Devuelve el nivel que acertó (LEVEL_L1, LEVEL_L2 o LEVEL_MISS) y deja
+   en *replaced la dirección base de la entrada reemplazada en L1, o 0.
+   page_bin/off_bin pueden ser NULL: las cadenas binarias sólo se
+   generan cuando hay que escribir una entrada nueva en L1.
+   Con --pages la página es la etiqueta de page_tag (cualquier tamaño)
+   y l1 el TLB que guarda ese tamaño. Con --prefetch un Hit en el
+   buffer de prefetch devuelve LEVEL_L1 (el acceso no espera un walk)
+   y cada Miss del L1 entrena al prefetcher.
+   Usa ≤3 punteros: slot, l1, page_bin (off_bin va con page_bin). */
+int tlb_access(uint64_t vaddr, const char *page_bin, const char *off_bin,
+               uintptr_t *replaced)
+{
+    uint32_t page_num = page_tag(vaddr);
+    uint32_t offset_num =
+        (uint32_t)vaddr & ((1U << psize_shift[TAG_CLASS(page_num)]) - 1U);
+    uint32_t evicted = UINT32_MAX;
+    int level = LEVEL_MISS;
+    char *l1 = l1_of(page_num);
+    char *slot = tlb_find(l1, page_num);
+
+    int pf_hit = 0;
+
+    stat_cycles += lat_l1;
+    if (pf_pending) {
+        /* los L1 de páginas grandes no reciben predicciones: su
+           resultado es el de referencia */
+        if (l1 != tlb_heap) stat_pf_base_misses += slot == NULL;
+        else if (pf_base_access(page_num) && !slot) ++stat_pf_pollution;
+    }
+    if (slot) {
+        tlb_update_lru(l1, slot);
+        *replaced = (uintptr_t)0;
+        if (pf_pending && PF_BIT(page_num)) {
+            /* primer uso de una predicción: cuenta como Miss evitado y
+               entrena al prefetcher igual que un Hit en el buffer */
+            PF_CLEAR(page_num);
+            ++stat_pf_useful;
+            pf_trigger(vaddr);
+        }
+        return LEVEL_L1;
+    }
+    if (pf_pending) {
+        slot = tlb_pf ? tlb_find(tlb_pf, page_num) : NULL;
+        if (slot) {
+            tlb_invalidate(tlb_pf, slot);
+            ++stat_pf_useful;
+            pf_hit = 1;
+        }
+        PF_CLEAR(page_num);
+    }
+    if (tlb_l2 && !pf_hit) {
+        stat_cycles += lat_l2;
+        slot = tlb_find(tlb_l2, page_num);
+        if (slot) {
+            level = LEVEL_L2;
+            if (l2_exclusive) {
+                tlb_invalidate(tlb_l2, slot);
             } else {
-                printf("Politica de reemplazo: %p\n", (void *)replaced);
+                tlb_update_lru(tlb_l2, slot);
             }
         }
+    }
+    last_fault = 0;
+    if (level == LEVEL_MISS && !pf_hit) {
+        uint32_t frame;
+        if (!walk_enabled) {
+            stat_cycles += lat_walk;
+        } else if (TAG_CLASS(page_num) != PSIZE_4K) {
+            /* página grande: la entrada del directorio es la hoja */
+            ++stat_walks;
+            ++stat_walk_mem;
+            stat_cycles += lat_mem;
+        } else {
+            stat_cycles += pt_walk(page_num, &frame);
+        }
+    }
+
+    char pb[PAGE_BIN_SIZE];
+    char ob[OFF_BIN_SIZE];
+    if (!page_bin && tlb_layout != LAYOUT_COMPACT) {
+        /* las cadenas muestran la vista de 4 KiB, como el enunciado
+           (con 48/57 bits, los 20 bits bajos de la página: el slot no
+           tiene lugar para 45) */
+        dec_to_bin(vaddr >> 12, 20, pb);
+        dec_to_bin(vaddr & 0xFFFU, 12, ob);
+        page_bin = pb;
+        off_bin = ob;
+    }
+    *replaced = tlb_insert(l1, page_num, offset_num,
+                           page_bin, off_bin, &evicted);
+    if (tlb_l2) {
+        if (l2_exclusive) {
+            if (*replaced != (uintptr_t)0) l2_install(evicted, 0U);
+        } else if (level == LEVEL_MISS) {
+            l2_install(page_num, offset_num);
+        }
+    }
+    if (pf_kind != PF_NONE && TAG_CLASS(page_num) == PSIZE_4K) {
+        pf_trigger(vaddr);
+    }
+    return pf_hit ? LEVEL_L1 : level;
+}
 
-        /* medir tiempo: fin */
-        gettimeofday(&t1, NULL);
-        double elapsed = (t1.tv_sec - t0.tv_sec) +
-            (t1.tv_usec - t0.tv_usec) / 1e6;
+/* ---------- Medición de tiempo de alta resolución (--timer) ---------- */
 
-        /* Mostrar resultados (formato similar al ejemplo) */
-        printf("Página: %u\n", page_num);
-        printf("Desplazamiento: %u\n", offset_num);
-        printf("Página en binario: %s\n", page_bin);
-        printf("Desplazamiento en binario: %s\n", off_bin);
-        printf("Tiempo: %.6f segundos\n\n", elapsed);
+/* gettimeofday (el del enunciado, resolución de 1 us) es el reloj por
+   defecto. Con --timer mono se usa CLOCK_MONOTONIC_RAW y con --timer
+   tsc el contador de ciclos calibrado contra él. En ambos casos se
+   resta el costo de leer el propio reloj y cada traducción se acumula
+   en un histograma por separado para Hit y Miss. */
+#define TIMER_GTOD 0
+#define TIMER_MONO 1
+#define TIMER_TSC  2
+
+static int timer_kind = TIMER_GTOD;
+static uint64_t timer_overhead = 0U;   /* ticks de una lectura vacía */
+static double timer_ns_per_tick = 1.0;
+
+static inline uint64_t mono_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000U + (uint64_t)ts.tv_nsec;
+}
+
+/* Lectura del reloj elegido en ticks (ns en mono, ciclos en tsc). Las
+   barreras lfence impiden que rdtsc se adelante o se atrase respecto
+   de la traducción medida. */
+static inline uint64_t timer_now(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    if (timer_kind == TIMER_TSC) {
+        uint64_t t;
+        _mm_lfence();
+        t = __rdtsc();
+        _mm_lfence();
+        return t;
     }
+#endif
+    return mono_ns();
+}
 
-    free_tlb();
+/* Mide el costo mínimo de dos lecturas seguidas y, con tsc, los ns por
+   ciclo (unos 20 ms contra CLOCK_MONOTONIC_RAW). Devuelve 0 si el reloj
+   pedido no está disponible. */
+int timer_calibrate(void)
+{
+    uint64_t best = UINT64_MAX;
+    int i;
+
+#if !defined(__x86_64__) && !defined(__i386__)
+    if (timer_kind == TIMER_TSC) return 0;
+#endif
+    if (timer_kind == TIMER_TSC) {
+        uint64_t n0 = mono_ns();
+        uint64_t c0 = timer_now();
+        uint64_t n1;
+        while ((n1 = mono_ns()) - n0 < 20000000U) {
+        }
+        uint64_t c1 = timer_now();
+        if (c1 <= c0) return 0;
+        timer_ns_per_tick = (double)(n1 - n0) / (double)(c1 - c0);
+    }
+    for (i = 0; i < 10000; ++i) {
+        uint64_t t0 = timer_now();
+        uint64_t t1 = timer_now();
+        if (t1 - t0 < best) best = t1 - t0;
+    }
+    timer_overhead = best;
+    return 1;
+}
+
+/* Histograma logarítmico al estilo HDR: los valores < 2^HIST_SUB_BITS
+   tienen cubeta propia y cada potencia de 2 posterior se divide en
+   2^HIST_SUB_BITS cubetas iguales (error relativo <= 1/16). */
+#define HIST_SUB_BITS 4U
+#define HIST_SUB      (1U << HIST_SUB_BITS)
+#define HIST_BUCKETS  (64U * HIST_SUB)
+
+#define HIST_HIT  0
+#define HIST_MISS 1
+
+/* Estadísticas de latencia en un arreglo plano de uint64 para poder
+   llevar una copia por hilo y sumarlas: los dos histogramas y, por
+   tipo, número de muestras, suma y máximo. */
+#define LAT_HIST(st, k)  ((st) + (size_t)(k) * HIST_BUCKETS)
+#define LAT_COUNT(st, k) ((st)[2U * HIST_BUCKETS + (unsigned int)(k)])
+#define LAT_SUM(st, k)   ((st)[2U * HIST_BUCKETS + 2U + (unsigned int)(k)])
+#define LAT_MAX(st, k)   ((st)[2U * HIST_BUCKETS + 4U + (unsigned int)(k)])
+#define LAT_WORDS        (2U * HIST_BUCKETS + 6U)
+
+static uint64_t lat_stats[LAT_WORDS];
+
+static inline unsigned int hist_index(uint64_t v)
+{
+    if (v < HIST_SUB) return (unsigned int)v;
+    unsigned int shift = 63U - (unsigned int)__builtin_clzll(v)
+                         - HIST_SUB_BITS;
+    return (shift + 1U) * HIST_SUB
+           + (unsigned int)((v >> shift) & (HIST_SUB - 1U));
+}
+
+/* Mayor valor que cae en la cubeta idx */
+static uint64_t hist_upper(unsigned int idx)
+{
+    if (idx < HIST_SUB) return idx;
+    unsigned int shift = idx / HIST_SUB - 1U;
+    return (((uint64_t)(HIST_SUB + idx % HIST_SUB) + 1U) << shift) - 1U;
+}
+
+/* Registra en st la duración de una traducción (ticks brutos entre
+   t0 y t1) */
+static inline void lat_record(uint64_t *st, int kind, uint64_t t0,
+                              uint64_t t1)
+{
+    uint64_t d = t1 - t0;
+    d = d > timer_overhead ? d - timer_overhead : 0U;
+    ++LAT_HIST(st, kind)[hist_index(d)];
+    ++LAT_COUNT(st, kind);
+    LAT_SUM(st, kind) += d;
+    if (d > LAT_MAX(st, kind)) LAT_MAX(st, kind) = d;
+}
+
+/* Acumula las estadísticas 'from' en 'into' */
+void lat_merge(uint64_t *into, const uint64_t *from)
+{
+    unsigned int i;
+    for (i = 0U; i < 2U * HIST_BUCKETS + 4U; ++i) into[i] += from[i];
+    for (i = 0U; i < 2U; ++i) {
+        if (LAT_MAX(from, i) > LAT_MAX(into, i)) {
+            LAT_MAX(into, i) = LAT_MAX(from, i);
+        }
+    }
+}
+
+/* Percentil q (0..1) en ns: límite superior de la cubeta que lo
+   contiene, como en HdrHistogram */
+static double hist_percentile(int kind, double q)
+{
+    uint64_t rank = (uint64_t)(q * (double)LAT_COUNT(lat_stats, kind) + 0.5);
+    uint64_t seen = 0U;
+    unsigned int i;
+    if (rank == 0U) rank = 1U;
+    for (i = 0U; i < HIST_BUCKETS; ++i) {
+        seen += LAT_HIST(lat_stats, kind)[i];
+        if (seen >= rank) break;
+    }
+    uint64_t v = hist_upper(i);
+    if (v > LAT_MAX(lat_stats, kind)) v = LAT_MAX(lat_stats, kind);
+    return (double)v * timer_ns_per_tick;
+}
+
+/* Imprime p50/p99/p99.9 de Hit y Miss (sólo con --timer mono|tsc) */
+void print_latency(void)
+{
+    static const char *const names[2] = { "Hit", "Miss" };
+    int k;
+
+    if (timer_kind == TIMER_GTOD) return;
+    printf("Latencia por traducción (%s, costo del reloj %.1f ns"
+           " descontado):\n",
+           timer_kind == TIMER_TSC ? "tsc" : "CLOCK_MONOTONIC_RAW",
+           (double)timer_overhead * timer_ns_per_tick);
+    for (k = HIST_HIT; k <= HIST_MISS; ++k) {
+        if (LAT_COUNT(lat_stats, k) == 0U) {
+            printf("  %-4s: sin muestras\n", names[k]);
+            continue;
+        }
+        printf("  %-4s: n=%" PRIu64 " media=%.1f ns p50=%.0f ns"
+               " p99=%.0f ns p99.9=%.0f ns max=%.0f ns\n",
+               names[k], LAT_COUNT(lat_stats, k),
+               (double)LAT_SUM(lat_stats, k) * timer_ns_per_tick
+               / (double)LAT_COUNT(lat_stats, k),
+               hist_percentile(k, 0.50), hist_percentile(k, 0.99),
+               hist_percentile(k, 0.999),
+               (double)LAT_MAX(lat_stats, k) * timer_ns_per_tick);
+    }
+}
+
+/* ---------- Modo por lotes (--trace) ---------- */
+
+/* Tamaño del buffer de salida del modo por lotes (y del interactivo):
+   las líneas se acumulan aquí y se escriben con write() cuando se
+   llena. */
+#define OUT_BUF_SIZE (1U << 20)
+#define OUT_LINE_MAX 64U   /* cota de una línea de salida por acceso */
+#define OUT_REPORT_MAX 512U /* cota del informe de un acceso interactivo */
+
+static char *out_buf = NULL;  /* buffer de salida (heap) */
+static size_t out_len = 0U;
+static int out_fd = STDOUT_FILENO; /* destino de out_flush */
+
+/* Contadores agregados del modo por lotes */
+static uint64_t stat_accesses = 0U;
+static uint64_t stat_hits = 0U;
+static uint64_t stat_misses = 0U;
+static uint64_t stat_evictions = 0U;
+static uint64_t stat_faults = 0U;
+
+/* Vacía el buffer de salida en out_fd (stdout salvo en --gen-out) con
+   write(). Lo que esté pendiente en stdio sale antes para conservar el
+   orden. */
+void out_flush(void)
+{
+    size_t done = 0U;
+    fflush(stdout);
+    while (done < out_len) {
+        ssize_t n = write(out_fd, out_buf + done, out_len - done);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("write");
+            break;
+        }
+        done += (size_t)n;
+    }
+    out_len = 0U;
+}
+
+/* Agrega una cadena terminada en '\0' al buffer de salida */
+static inline void out_str(const char *s)
+{
+    size_t n = strlen(s);
+    memcpy(out_buf + out_len, s, n);
+    out_len += n;
+}
+
+/* Agrega un entero sin signo en decimal al buffer de salida */
+void out_u64(uint64_t v)
+{
+    char tmp[20];
+    int n = 0;
+    do {
+        tmp[n++] = (char)('0' + (int)(v % 10U));
+        v /= 10U;
+    } while (v != 0U);
+    while (n > 0) out_buf[out_len++] = tmp[--n];
+}
+
+/* Agrega una dirección en hexadecimal con prefijo 0x (igual que %p) */
+void out_hex(uintptr_t v)
+{
+    static const char digits[] = "0123456789abcdef";
+    char tmp[2U * sizeof(uintptr_t)];
+    int n = 0;
+    out_buf[out_len++] = '0';
+    out_buf[out_len++] = 'x';
+    do {
+        tmp[n++] = digits[v & 0xFU];
+        v >>= 4;
+    } while (v != 0U);
+    while (n > 0) out_buf[out_len++] = tmp[--n];
+}
+
+/* Agrega 'units' (microsegundos con decimals = 6, nanosegundos con 9)
+   como segundos con ese número de decimales: el mismo texto que %.6f /
+   %.9f, sin pasar por la conversión de punto flotante de printf. */
+void out_fixed(uint64_t units, int decimals)
+{
+    char frac[9];
+    uint64_t scale = decimals == 9 ? 1000000000U : 1000000U;
+    int i;
+    out_u64(units / scale);
+    out_buf[out_len++] = '.';
+    units %= scale;
+    for (i = decimals - 1; i >= 0; --i) {
+        frac[i] = (char)('0' + (int)(units % 10U));
+        units /= 10U;
+    }
+    memcpy(out_buf + out_len, frac, (size_t)decimals);
+    out_len += (size_t)decimals;
+}
+
+/* Lee un archivo completo a un bloque en heap terminado en '\0'.
+   "-" indica la entrada estándar. Devuelve NULL si hay error. */
+char *read_whole_file(const char *path, size_t *len_out)
+{
+    FILE *f = (strcmp(path, "-") == 0) ? stdin : fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return NULL;
+    }
+    size_t cap = 1U << 16;
+    size_t len = 0U;
+    char *data = (char *)malloc(cap + 1U);
+    while (data) {
+        size_t n = fread(data + len, 1U, cap - len, f);
+        len += n;
+        if (len < cap) break;
+        char *grown = (char *)realloc(data, 2U * cap + 1U);
+        if (!grown) {
+            free(data);
+            data = NULL;
+            break;
+        }
+        data = grown;
+        cap *= 2U;
+    }
+    if (f != stdin) fclose(f);
+    if (!data) {
+        fprintf(stderr, "Error: sin memoria para leer %s\n", path);
+        return NULL;
+    }
+    data[len] = '\0';
+    *len_out = len;
+    return data;
+}
+
+/* ---------- Clasificación de fallos (obligatorio/capacidad/conflicto) */
+
+/* Un Miss es obligatorio si la página nunca se había referenciado
+   (bitmap de todas las etiquetas de página), de capacidad si también
+   falla en un TLB totalmente asociativo LRU de la misma capacidad
+   (tlb_shadow) y de conflicto si ese TLB sí la tenía. Con un único
+   conjunto el TLB ya es totalmente asociativo y no hace falta la
+   sombra. */
+static char *tlb_shadow = NULL;
+static unsigned char *seen_pages = NULL;
+static uint64_t stat_compulsory = 0U;
+static uint64_t stat_capacity = 0U;
+static uint64_t stat_conflict = 0U;
+
+void classify_init(void)
+{
+    seen_pages = (unsigned char *)calloc(((size_t)tag_space + 7U) / 8U, 1U);
+    if (!seen_pages) {
+        perror("malloc páginas vistas");
+        exit(EXIT_FAILURE);
+    }
+    if (tlb_sets > 1U) tlb_shadow = tlb_create(1U, tlb_entries, INDEX_LOW,
+                                            LAYOUT_AOS, POL_LRU);
+}
+
+void classify_free(void)
+{
+    free(seen_pages);
+    seen_pages = NULL;
+    if (tlb_shadow) {
+        tlb_destroy(tlb_shadow);
+        tlb_shadow = NULL;
+    }
+}
+
+/* Actualiza la sombra con el acceso y clasifica el Miss (si lo hubo).
+   Usa ≤3 punteros: slot. */
+void classify_access(uint32_t page_num, int hit)
+{
+    static const char zeros[PAGE_BIN_SIZE];
+    unsigned char bit = (unsigned char)(1U << (page_num & 7U));
+    int first = (seen_pages[page_num >> 3] & bit) == 0;
+    int shadow_hit = 0;
+
+    seen_pages[page_num >> 3] |= bit;
+    if (tlb_shadow) {
+        char *slot = tlb_find(tlb_shadow, page_num);
+        if (slot) {
+            tlb_update_lru(tlb_shadow, slot);
+            shadow_hit = 1;
+        } else {
+            tlb_insert(tlb_shadow, page_num, 0U, zeros, zeros, NULL);
+        }
+    }
+    if (hit) return;
+    if (first) {
+        ++stat_compulsory;
+    } else if (shadow_hit) {
+        ++stat_conflict;
+    } else {
+        ++stat_capacity;
+    }
+}
+
+/* ---------- Espacios de direcciones: ASID, invlpg y vaciados ---------- */
+
+/* Con --asids N la traza decimal admite, además de direcciones:
+     cN     cambio de contexto al ASID N (0 <= N < --asids)
+     iADDR  invlpg: invalida la página de ADDR del ASID actual
+     fN     vaciado selectivo de todas las entradas del ASID N
+   Con --asid-mode tagged (por defecto) las entradas de distintos ASID
+   conviven en el TLB; con flush cada cambio de contexto vacía todos
+   los niveles y la PWC, como un TLB sin etiquetas. Un L1 de
+   comparación con la misma geometría (tlb_asid_alt) se simula en el
+   otro modo para medir la diferencia en la misma pasada.
+   Modelo de costo (--flush-lat F,E,I, en ciclos): F por vaciado
+   completo, E por entrada recorrida en un vaciado selectivo (cada
+   slot de cada nivel compara su etiqueta) e I por invlpg. */
+#define ASID_TAGGED 0
+#define ASID_FLUSH  1
+
+static int asid_mode = ASID_TAGGED;
+static unsigned int cur_asid = 0U;
+static unsigned int lat_flush = 150U;
+static unsigned int lat_flush_entry = 1U;
+static unsigned int lat_invlpg = 120U;
+static char *tlb_asid_alt = NULL;       /* L1 en el otro modo */
+
+static uint64_t stat_switches = 0U;
+static uint64_t stat_invlpg = 0U;
+static uint64_t stat_sel_flush = 0U;
+static uint64_t stat_flush_inval = 0U;  /* entradas invalidadas */
+static uint64_t stat_alt_hits = 0U;
+static uint64_t stat_asid_cycles[2];    /* mantenimiento por modo */
+static uint64_t stat_asid_acc[ASID_MAX];
+static uint64_t stat_asid_hits[ASID_MAX];
+
+void asid_init(void)
+{
+    if (!asid_count) return;
+    tlb_asid_alt = tlb_create(tlb_sets, tlb_entries / tlb_sets,
+                              tlb_index_fn, tlb_layout,
+                              tlb_policy == POL_OPT ? POL_LRU : tlb_policy);
+    cur_asid = 0U;
+    asid_tag = 0U;
+}
+
+void asid_free(void)
+{
+    if (tlb_asid_alt) tlb_destroy(tlb_asid_alt);
+    tlb_asid_alt = NULL;
+    asid_tag = 0U;
+}
+
+/* Invalida las entradas válidas con (etiqueta & mask) == want y
+   devuelve cuántas; mask = 0 vacía el TLB.
+   Usa ≤3 punteros: tlb, slot. */
+uint32_t tlb_flush_match(char *tlb, uint32_t mask, uint32_t want)
+{
+    uint32_t n = 0U;
+    uint32_t i;
+    char *slot;
+    if (!tlb) return 0U;
+    for (i = 0U; i < FIELD32(tlb, H_ENTRIES); ++i) {
+        slot = TLB_ENTRY_AT(tlb, i);
+        uint32_t tag = tlb_tag_at(tlb, i);
+        if (tag != UINT32_MAX && (tag & mask) == want) {
+            tlb_invalidate(tlb, slot);
+            ++n;
+        }
+    }
+    return n;
+}
+
+/* Aplica tlb_flush_match a todos los TLB del modo simulado (niveles,
+   comparación de 4 KiB y sombra de la clasificación). */
+static uint32_t asid_flush_levels(uint32_t mask, uint32_t want)
+{
+    uint32_t n = tlb_flush_match(tlb_heap, mask, want)
+                 + tlb_flush_match(tlb_huge[0], mask, want)
+                 + tlb_flush_match(tlb_huge[1], mask, want)
+                 + tlb_flush_match(tlb_l2, mask, want);
+    tlb_flush_match(tlb_pf, mask, want);
+    tlb_flush_match(tlb_pf_base, mask, want);
+    tlb_flush_match(tlb_base4k, mask, want);
+    tlb_flush_match(tlb_shadow, mask, want);
+    if (mask == 0U && pwc) pwc_flush();
+    return n;
+}
+
+/* Slots que recorre un vaciado selectivo en todos los niveles */
+static uint32_t asid_levels_entries(void)
+{
+    uint32_t n = FIELD32(tlb_heap, H_ENTRIES);
+    if (tlb_huge[0]) n += FIELD32(tlb_huge[0], H_ENTRIES);
+    if (tlb_huge[1]) n += FIELD32(tlb_huge[1], H_ENTRIES);
+    if (tlb_l2) n += FIELD32(tlb_l2, H_ENTRIES);
+    return n;
+}
+
+/* Registro "cN". Cambiar al ASID que ya está activo no hace nada. */
+void asid_switch(unsigned int asid)
+{
+    if (asid == cur_asid) return;
+    ++stat_switches;
+    stat_asid_cycles[ASID_FLUSH] += lat_flush;
+    if (asid_mode == ASID_FLUSH) {
+        stat_flush_inval += asid_flush_levels(0U, 0U);
+    } else {
+        tlb_flush_match(tlb_asid_alt, 0U, 0U);
+    }
+    cur_asid = asid;
+    asid_tag = (uint32_t)asid << ASID_SHIFT;
+}
+
+/* Invalida la entrada de la etiqueta si está; devuelve 1 si estaba */
+static uint32_t tlb_drop(char *tlb, uint32_t tag)
+{
+    char *slot = tlb ? tlb_find(tlb, tag) : NULL;
+    if (!slot) return 0U;
+    tlb_invalidate(tlb, slot);
+    return 1U;
+}
+
+/* Registro "iADDR": la página sale de todos los niveles en ambos modos */
+void asid_invlpg(uint64_t vaddr)
+{
+    uint32_t tag = page_tag(vaddr);
+    ++stat_invlpg;
+    stat_asid_cycles[ASID_TAGGED] += lat_invlpg;
+    stat_asid_cycles[ASID_FLUSH] += lat_invlpg;
+    stat_flush_inval += tlb_drop(l1_of(tag), tag) + tlb_drop(tlb_l2, tag);
+    tlb_drop(tlb_pf, tag);
+    tlb_drop(tlb_pf_base, tag);
+    tlb_drop(tlb_base4k, (uint32_t)(vaddr >> 12) | asid_tag);
+    tlb_drop(tlb_shadow, tag);
+    tlb_drop(tlb_asid_alt, tag);
+}
+
+/* Registro "fN". Con etiquetas se recorren todos los slots; sin ellas
+   el TLB sólo guarda el ASID actual, así que vaciarlo es un vaciado
+   completo (y no hace nada para otro ASID). */
+void asid_selective_flush(unsigned int asid)
+{
+    uint32_t want = (uint32_t)asid << ASID_SHIFT;
+    uint32_t mask = ~TAG_PAGE_MASK;
+    ++stat_sel_flush;
+    stat_asid_cycles[ASID_TAGGED] +=
+        (uint64_t)lat_flush_entry * asid_levels_entries();
+    if (asid == cur_asid) stat_asid_cycles[ASID_FLUSH] += lat_flush;
+    if (asid_mode == ASID_TAGGED) {
+        stat_flush_inval += asid_flush_levels(mask, want);
+        if (asid == cur_asid) tlb_flush_match(tlb_asid_alt, 0U, 0U);
+    } else {
+        if (asid == cur_asid) {
+            stat_flush_inval += asid_flush_levels(0U, 0U);
+        }
+        tlb_flush_match(tlb_asid_alt, mask, want);
+    }
+}
+
+/* Cuenta el acceso para su ASID y lo repite en el L1 de comparación.
+   Usa ≤3 punteros: slot. */
+void asid_account(uint32_t tag, int hit)
+{
+    static const char zeros[PAGE_BIN_SIZE];
+    char *slot = tlb_find(tlb_asid_alt, tag);
+
+    ++stat_asid_acc[cur_asid];
+    if (hit) ++stat_asid_hits[cur_asid];
+    if (slot) {
+        tlb_update_lru(tlb_asid_alt, slot);
+        ++stat_alt_hits;
+    } else {
+        tlb_insert(tlb_asid_alt, tag, 0U, zeros, zeros, NULL);
+    }
+}
+
+/* Resumen de ASID: Hit por espacio de direcciones y comparación de
+   etiquetado contra vaciado en cada cambio con un modelo de sólo L1
+   (Hit = lat_l1, Miss = lat_l1 + lat_walk, más el mantenimiento). */
+void print_asid_summary(uint64_t translated, uint64_t hits)
+{
+    uint64_t mode_hits[2];
+    uint64_t cycles[2];
+    unsigned int a;
+    int m;
+    if (!asid_count) return;
+    mode_hits[asid_mode] = hits;
+    mode_hits[!asid_mode] = stat_alt_hits;
+    printf("ASID (%s; comparación: %s):\n",
+           asid_mode == ASID_TAGGED ? "etiquetado" : "vaciado en cada cambio",
+           asid_mode == ASID_TAGGED ? "vaciado en cada cambio" : "etiquetado");
+    for (a = 0U; a < asid_count; ++a) {
+        if (stat_asid_acc[a] == 0U) continue;
+        printf("  ASID %u: %" PRIu64 " accesos, Hit %.2f%%\n", a,
+               stat_asid_acc[a],
+               100.0 * (double)stat_asid_hits[a] / (double)stat_asid_acc[a]);
+    }
+    printf("  Cambios de contexto: %" PRIu64 ", invlpg: %" PRIu64
+           ", vaciados selectivos: %" PRIu64 " (entradas invalidadas: %"
+           PRIu64 ")\n", stat_switches, stat_invlpg, stat_sel_flush,
+           stat_flush_inval);
+    for (m = ASID_TAGGED; m <= ASID_FLUSH; ++m) {
+        cycles[m] = translated * lat_l1
+                    + (translated - mode_hits[m]) * lat_walk
+                    + stat_asid_cycles[m];
+        printf("  %s: Hit L1 %" PRIu64 " (%.2f%%), mantenimiento %" PRIu64
+               " ciclos, total %" PRIu64 " ciclos\n",
+               m == ASID_TAGGED ? "Etiquetado" : "Vaciado   ", mode_hits[m],
+               translated ? 100.0 * (double)mode_hits[m] / (double)translated
+                          : 0.0, stat_asid_cycles[m], cycles[m]);
+    }
+    printf("  Ganancia del etiquetado: %.3fx (vaciado=%u, por entrada=%u,"
+           " invlpg=%u)\n",
+           cycles[ASID_TAGGED] ? (double)cycles[ASID_FLUSH]
+                                 / (double)cycles[ASID_TAGGED] : 0.0,
+           lat_flush, lat_flush_entry, lat_invlpg);
+}
+
+/* ---------- Formato binario de trazas ---------- */
+
+/* Cabecera de 16 bytes, todos los campos en little-endian:
+ *   [0..3]   "TLBT"   número mágico
+ *   [4..5]   uint16   versión (TRACE_VERSION)
+ *   [6..7]   uint16   flags (TRACE_F_DELTA)
+ *   [8..15]  uint64   número de direcciones
+ * seguida de 'count' uint32 little-endian empaquetados (uint64 con
+ * TRACE_F_WIDE, para --va-bits 48/57). Con TRACE_F_DELTA cada registro
+ * es en cambio la diferencia con signo respecto a la dirección anterior
+ * (empezando desde 0) en zigzag + LEB128: 7 bits por byte, el bit alto
+ * indica que sigue otro byte. Un paso de una página ocupa 2 bytes en
+ * lugar de 4 u 8. La versión 1 (delta de ancho fijo) ya no se acepta
+ * con TRACE_F_DELTA; las trazas absolutas no cambiaron. */
+#define TRACE_MAGIC    "TLBT"
+#define TRACE_VERSION  2U
+#define TRACE_F_DELTA  0x1U
+#define TRACE_F_WIDE   0x2U
+#define TRACE_HDR_SIZE 16U
+#define TRACE_REC_SIZE(flags) (((flags) & TRACE_F_WIDE) ? 8U : 4U)
+#define TRACE_VARINT_MAX 10U /* bytes de un varint de 64 bits */
+
+/* Los datos del archivo se usan directamente desde el mapeo: en un host
+   little-endian no hay conversión alguna. */
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define TRACE_LE32(x) __builtin_bswap32(x)
+#define TRACE_LE64(x) __builtin_bswap64(x)
+#else
+#define TRACE_LE32(x) (x)
+#define TRACE_LE64(x) (x)
+#endif
+
+/* Lectura portable de enteros little-endian de la cabecera */
+uint64_t rd_le(const unsigned char *p, int bytes)
+{
+    uint64_t v = 0U;
+    int i;
+    for (i = bytes - 1; i >= 0; --i) v = (v << 8) | p[i];
+    return v;
+}
+
+void wr_le(unsigned char *p, uint64_t v, int bytes)
+{
+    int i;
+    for (i = 0; i < bytes; ++i) {
+        p[i] = (unsigned char)(v & 0xFFU);
+        v >>= 8;
+    }
+}
+
+/* Codifica d (diferencia con signo) en zigzag + LEB128. Devuelve los
+   bytes escritos en out (como mucho TRACE_VARINT_MAX). */
+int wr_varint(unsigned char *out, int64_t d)
+{
+    uint64_t v = ((uint64_t)d << 1) ^ (uint64_t)(d >> 63);
+    int n = 0;
+    while (v >= 0x80U) {
+        out[n++] = (unsigned char)(v | 0x80U);
+        v >>= 7;
+    }
+    out[n++] = (unsigned char)v;
+    return n;
+}
+
+/* Decodifica el varint que empieza en *p y avanza *p. trace_bin_header
+   ya comprobó que el último byte cierra un varint, así que la lectura
+   no pasa de end. */
+static inline int64_t rd_varint(const unsigned char **p,
+                                const unsigned char *end)
+{
+    const unsigned char *q = *p;
+    uint64_t v = 0U;
+    unsigned int shift = 0U;
+    while (q < end) {
+        unsigned char b = *q++;
+        if (shift < 64U) v |= (uint64_t)(b & 0x7FU) << shift;
+        shift += 7U;
+        if (!(b & 0x80U)) break;
+    }
+    *p = q;
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1U);
+}
+
+/* Proyecta un archivo en memoria con mmap (sólo lectura). Para "-" o
+   archivos que no se pueden proyectar (tuberías) se lee a heap.
+   *mapped indica cuál de los dos casos ocurrió para liberar bien. */
+char *map_file(const char *path, size_t *len_out, int *mapped)
+{
+    *mapped = 0;
+    if (strcmp(path, "-") != 0) {
+        int fd = open(path, O_RDONLY);
+        if (fd < 0) {
+            perror(path);
+            return NULL;
+        }
+        struct stat st;
+        if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+            void *m = mmap(NULL, (size_t)st.st_size, PROT_READ,
+                           MAP_PRIVATE, fd, 0);
+            close(fd);
+            if (m == MAP_FAILED) {
+                perror("mmap");
+                return NULL;
+            }
+            madvise(m, (size_t)st.st_size, MADV_SEQUENTIAL);
+            *mapped = 1;
+            *len_out = (size_t)st.st_size;
+            return (char *)m;
+        }
+        close(fd);
+    }
+    return read_whole_file(path, len_out);
+}
+
+void unmap_file(char *data, size_t len, int mapped)
+{
+    if (mapped) {
+        munmap(data, len);
+    } else {
+        free(data);
+    }
+}
+
+/* Indica si el bloque empieza con una cabecera binaria válida */
+int is_binary_trace(const char *data, size_t len)
+{
+    return len >= TRACE_HDR_SIZE && memcmp(data, TRACE_MAGIC, 4U) == 0;
+}
+
+/* Lee la cabecera de una traza binaria. Devuelve 1 si el bloque es una
+   traza binaria válida (con *count y *flags), 0 si es texto y -1 si la
+   cabecera es inválida o la traza es de 64 bits sin --va-bits 48/57
+   (ya informado en stderr). */
+int trace_bin_header(const char *data, size_t len, const char *path,
+                     uint64_t *count, unsigned int *flags)
+{
+    if (!is_binary_trace(data, len)) return 0;
+    const unsigned char *hdr = (const unsigned char *)data;
+    *count = rd_le(hdr + 8, 8);
+    *flags = (unsigned int)rd_le(hdr + 6, 2);
+    uint64_t bytes = len - TRACE_HDR_SIZE;
+    int bad;
+    if (*flags & TRACE_F_DELTA) {
+        /* entre 1 y TRACE_VARINT_MAX bytes por registro */
+        bad = rd_le(hdr + 4, 2) != TRACE_VERSION || *count > bytes
+              || bytes > *count * TRACE_VARINT_MAX
+              || (bytes && (unsigned char)data[len - 1U] >= 0x80U);
+    } else {
+        bad = rd_le(hdr + 4, 2) == 0U || rd_le(hdr + 4, 2) > TRACE_VERSION
+              || *count > bytes / TRACE_REC_SIZE(*flags);
+    }
+    if (bad) {
+        fprintf(stderr, "Error: traza binaria inválida: %s\n", path);
+        return -1;
+    }
+    if ((*flags & TRACE_F_WIDE) && va_bits == 32U) {
+        fprintf(stderr, "Error: %s tiene direcciones de 64 bits"
+                " (use --va-bits 48 o 57)\n", path);
+        return -1;
+    }
+    return 1;
+}
+
+/* ---------- Métricas en vivo (--metrics) ---------- */
+/* Con --metrics, un recorrido largo publica cada --metrics-interval
+   segundos una muestra con:
+   - los contadores acumulados (accesos, Hit, Miss, reemplazos y Page
+     Fault);
+   - los reemplazos de cada slot del L1;
+   - el conjunto de trabajo, es decir, las páginas distintas de los
+     últimos --metrics-window accesos;
+   - las traducciones/s del último intervalo.
+   La muestra sale en texto de Prometheus o en JSON (un objeto por
+   línea). El destino es un archivo o "unix:RUTA". El archivo se
+   reescribe entero con rename(), así que el lector nunca ve una
+   muestra a medias. El socket debe estar escuchando y recibe las
+   muestras una tras otra.
+
+   En la búsqueda sólo se anotan la etiqueta y el índice del slot
+   reemplazado en un bloque del hilo (el modo por lotes de la API los
+   toma de tlb_translate_slots). Al vaciar el bloque, cada
+   METRICS_BATCH accesos, las etiquetas pasan al anillo de la ventana,
+   se cuentan los reemplazos por slot y se lee el reloj. Las páginas
+   distintas del anillo se cuentan al armar cada muestra, con marcas
+   por generación, y no en cada acceso. Con --parallel, cada hilo
+   publica sus contadores al terminar un trozo y el hilo principal
+   arma las muestras. En ese modo no hay slots ni conjunto de trabajo,
+   porque los trozos se simulan fuera de orden y cada uno con su TLB. */
+
+#define METRICS_PROM  0
+#define METRICS_JSON  1
+#define METRICS_BATCH 4096U
+#define METRICS_WINDOW_MAX (1U << 24)
+
+static const char *metrics_dest = NULL;     /* --metrics */
+static int metrics_format = METRICS_PROM;   /* --metrics-format */
+static double metrics_interval = 1.0;       /* --metrics-interval (s) */
+static uint32_t metrics_window = 65536U;    /* --metrics-window (accesos) */
+static int metrics_fd = -1;                 /* socket de "unix:RUTA" */
+static char *metrics_tmp = NULL;            /* "RUTA.tmp" del archivo */
+static char *metrics_buf = NULL;            /* texto de la muestra */
+static size_t metrics_len = 0U;
+static size_t metrics_cap = 0U;
+static uint64_t metrics_t0 = 0U;            /* ns al abrir */
+static uint64_t metrics_next = 0U;          /* ns de la próxima muestra */
+static uint64_t metrics_last_ns = 0U;
+static uint64_t metrics_last_done = 0U;     /* traducciones de la anterior */
+static uint64_t metrics_samples = 0U;
+static uint64_t *metrics_slot_evict = NULL; /* slot del L1 -> reemplazos */
+static uint32_t *ws_ring = NULL;    /* últimas metrics_window etiquetas */
+static uint32_t ws_pos = 0U;
+static uint32_t *ws_mark = NULL;    /* etiqueta -> generación que la contó */
+static uint32_t ws_gen = 0U;
+
+/* bloque de anotaciones del hilo que recorre la traza */
+static _Thread_local uint32_t *metrics_tags = NULL;
+static _Thread_local uint32_t *metrics_slots = NULL; /* o TLB_NO_SLOT */
+static _Thread_local unsigned int metrics_pending = 0U;
+
+/* Agrega texto con formato a metrics_buf (crece si hace falta) */
+__attribute__((format(printf, 1, 2)))
+static void metrics_add(const char *fmt, ...)
+{
+    va_list ap;
+    for (;;) {
+        va_start(ap, fmt);
+        int n = vsnprintf(metrics_buf + metrics_len,
+                          metrics_cap - metrics_len, fmt, ap);
+        va_end(ap);
+        if (n < 0) return;
+        if ((size_t)n < metrics_cap - metrics_len) {
+            metrics_len += (size_t)n;
+            return;
+        }
+        char *grown = (char *)realloc(metrics_buf, metrics_cap * 2U);
+        if (!grown) {
+            perror("malloc métricas");
+            exit(EXIT_FAILURE);
+        }
+        metrics_buf = grown;
+        metrics_cap *= 2U;
+    }
+}
+
+/* Abre el destino (archivo o "unix:RUTA") y reserva las tablas.
+   per_slot = 0 omite los reemplazos por slot y el conjunto de trabajo
+   (--parallel). Devuelve 0 si el destino no se puede abrir. */
+int metrics_open(const char *dest, int per_slot)
+{
+    size_t n = strlen(dest);
+    metrics_dest = dest;
+    if (strncmp(dest, "unix:", 5U) == 0) {
+        struct sockaddr_un sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sun_family = AF_UNIX;
+        if (n - 5U >= sizeof(sa.sun_path)) {
+            fprintf(stderr, "Error: ruta de socket demasiado larga: %s\n",
+                    dest + 5);
+            return 0;
+        }
+        memcpy(sa.sun_path, dest + 5, n - 5U);
+        metrics_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (metrics_fd < 0
+            || connect(metrics_fd, (struct sockaddr *)&sa, sizeof(sa)) != 0) {
+            perror(dest);
+            if (metrics_fd >= 0) close(metrics_fd);
+            metrics_fd = -1;
+            return 0;
+        }
+    } else {
+        metrics_tmp = (char *)malloc(n + 5U);
+        if (!metrics_tmp) {
+            perror("malloc métricas");
+            exit(EXIT_FAILURE);
+        }
+        memcpy(metrics_tmp, dest, n);
+        memcpy(metrics_tmp + n, ".tmp", 5U);
+    }
+    metrics_cap = 4096U;
+    metrics_buf = (char *)malloc(metrics_cap);
+    if (!metrics_buf) {
+        perror("malloc métricas");
+        exit(EXIT_FAILURE);
+    }
+    if (per_slot) {
+        metrics_slot_evict = (uint64_t *)calloc(tlb_entries,
+                                                sizeof(uint64_t));
+        ws_mark = (uint32_t *)calloc(tag_space, sizeof(uint32_t));
+        ws_ring = (uint32_t *)malloc((size_t)metrics_window
+                                     * sizeof(uint32_t));
+        metrics_tags = (uint32_t *)malloc(METRICS_BATCH * sizeof(uint32_t));
+        metrics_slots = (uint32_t *)malloc(METRICS_BATCH
+                                           * sizeof(uint32_t));
+        if (!metrics_slot_evict || !ws_mark || !ws_ring || !metrics_tags
+            || !metrics_slots) {
+            perror("malloc métricas");
+            exit(EXIT_FAILURE);
+        }
+        memset(ws_ring, 0xFF, (size_t)metrics_window * sizeof(uint32_t));
+    }
+    metrics_t0 = metrics_last_ns = mono_ns();
+    metrics_next = metrics_t0 + (uint64_t)(metrics_interval * 1e9);
+    return 1;
+}
+
+/* Escribe la muestra armada en el destino. Un error deja de publicar
+   (se avisa una vez) sin detener la simulación. */
+static void metrics_emit(void)
+{
+    size_t off = 0U;
+    ssize_t w;
+    int fd = metrics_fd;
+
+    if (fd < 0 && metrics_tmp) {
+        fd = open(metrics_tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                  0644);
+        if (fd < 0) {
+            perror(metrics_tmp);
+            free(metrics_tmp);
+            metrics_tmp = NULL;
+            return;
+        }
+    }
+    if (fd < 0) return;
+    while (off < metrics_len) {
+        w = metrics_fd >= 0
+            ? send(fd, metrics_buf + off, metrics_len - off, MSG_NOSIGNAL)
+            : write(fd, metrics_buf + off, metrics_len - off);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) break;
+        off += (size_t)w;
+    }
+    if (metrics_fd >= 0) {
+        if (off < metrics_len) {
+            perror(metrics_dest);
+            close(metrics_fd);
+            metrics_fd = -1;
+        }
+        return;
+    }
+    if (close(fd) != 0 || off < metrics_len
+        || rename(metrics_tmp, metrics_dest) != 0) {
+        perror(metrics_dest);
+        unlink(metrics_tmp);
+        free(metrics_tmp);
+        metrics_tmp = NULL;
+    }
+}
+
+/* Una línea "# HELP/# TYPE" y el valor de una métrica sin etiquetas */
+static void metrics_prom(const char *name, const char *type,
+                         const char *help, uint64_t v)
+{
+    metrics_add("# HELP traducir_%s %s\n# TYPE traducir_%s %s\n"
+                "traducir_%s %" PRIu64 "\n", name, help, name, type, name, v);
+}
+
+/* Páginas distintas en el anillo de la ventana */
+static uint64_t metrics_working_set(void)
+{
+    uint64_t pages = 0U;
+    uint32_t i;
+    if (++ws_gen == 0U) {
+        memset(ws_mark, 0, (size_t)tag_space * sizeof(uint32_t));
+        ws_gen = 1U;
+    }
+    for (i = 0U; i < metrics_window; ++i) {
+        uint32_t tag = ws_ring[i];
+        if (tag != UINT32_MAX && ws_mark[tag] != ws_gen) {
+            ws_mark[tag] = ws_gen;
+            ++pages;
+        }
+    }
+    return pages;
+}
+
+/* Arma y publica una muestra con los contadores dados */
+static void metrics_sample(uint64_t now, uint64_t hits, uint64_t misses,
+                           uint64_t evictions, uint64_t faults)
+{
+    uint64_t done = hits + misses;
+    double secs = (double)(now - metrics_last_ns) / 1e9;
+    double tps = secs > 0.0 ? (double)(done - metrics_last_done) / secs
+                            : 0.0;
+    double elapsed = (double)(now - metrics_t0) / 1e9;
+    uint32_t i;
+
+    metrics_len = 0U;
+    if (metrics_format == METRICS_JSON) {
+        metrics_add("{\"muestra\": %" PRIu64 ", \"tiempo_s\": %.6f, "
+                    "\"accesos\": %" PRIu64 ", \"aciertos\": %" PRIu64 ", "
+                    "\"miss\": %" PRIu64 ", \"reemplazos\": %" PRIu64 ", "
+                    "\"page_faults\": %" PRIu64 ", \"traducciones_s\": %.0f",
+                    metrics_samples, elapsed, done + faults, hits, misses,
+                    evictions, faults, tps);
+        if (ws_ring) {
+            metrics_add(", \"ventana\": %" PRIu32 ", \"conjunto_trabajo\": %"
+                        PRIu64, metrics_window, metrics_working_set());
+        }
+        if (metrics_slot_evict) {
+            metrics_add(", \"reemplazos_slot\": [");
+            for (i = 0U; i < tlb_entries; ++i) {
+                metrics_add(i ? ", %" PRIu64 : "%" PRIu64,
+                            metrics_slot_evict[i]);
+            }
+            metrics_add("]");
+        }
+        metrics_add("}\n");
+    } else {
+        metrics_prom("accesos_total", "counter",
+                     "Accesos de la traza (incluye Page Fault).",
+                     done + faults);
+        metrics_prom("aciertos_total", "counter", "TLB Hit en el L1.", hits);
+        metrics_prom("miss_total", "counter", "TLB Miss en el L1.", misses);
+        metrics_prom("reemplazos_total", "counter",
+                     "Entradas válidas reemplazadas.", evictions);
+        metrics_prom("page_faults_total", "counter",
+                     "Direcciones no traducibles.", faults);
+        metrics_add("# HELP traducir_traducciones_por_segundo Traducciones/s"
+                    " del último intervalo.\n"
+                    "# TYPE traducir_traducciones_por_segundo gauge\n"
+                    "traducir_traducciones_por_segundo %.0f\n"
+                    "# HELP traducir_tiempo_segundos Segundos desde el"
+                    " inicio.\n"
+                    "# TYPE traducir_tiempo_segundos gauge\n"
+                    "traducir_tiempo_segundos %.6f\n", tps, elapsed);
+        if (ws_ring) {
+            metrics_add("# HELP traducir_conjunto_trabajo_paginas Páginas"
+                        " distintas en la ventana de accesos.\n"
+                        "# TYPE traducir_conjunto_trabajo_paginas gauge\n"
+                        "traducir_conjunto_trabajo_paginas{ventana=\"%"
+                        PRIu32 "\"} %" PRIu64 "\n", metrics_window,
+                        metrics_working_set());
+        }
+        if (metrics_slot_evict) {
+            metrics_add("# HELP traducir_reemplazos_slot_total Reemplazos"
+                        " de cada slot del L1.\n"
+                        "# TYPE traducir_reemplazos_slot_total counter\n");
+            for (i = 0U; i < tlb_entries; ++i) {
+                metrics_add("traducir_reemplazos_slot_total{slot=\"%" PRIu32
+                            "\"} %" PRIu64 "\n", i, metrics_slot_evict[i]);
+            }
+        }
+        /* separa las muestras en el socket; en el archivo es un
+           comentario más */
+        metrics_add("# EOF\n");
+    }
+    metrics_emit();
+    metrics_last_ns = now;
+    metrics_last_done = done;
+    ++metrics_samples;
+    metrics_next = now + (uint64_t)(metrics_interval * 1e9);
+}
+
+/* Vacía el bloque de anotaciones: las etiquetas pasan al anillo de la
+   ventana y se cuentan los reemplazos por slot.
+   Usa ≤3 punteros: metrics_tags, metrics_slots. */
+void metrics_drain(void)
+{
+    unsigned int i;
+    for (i = 0U; i < metrics_pending; ++i) {
+        ws_ring[ws_pos] = metrics_tags[i];
+        if (++ws_pos == metrics_window) ws_pos = 0U;
+        if (metrics_slots[i] != TLB_NO_SLOT) {
+            ++metrics_slot_evict[metrics_slots[i]];
+        }
+    }
+    metrics_pending = 0U;
+}
+
+/* Índice del slot reemplazado en el L1 de 4 KiB, o TLB_NO_SLOT si no
+   hubo reemplazo o fue en otro nivel (L2, páginas grandes).
+   Usa ≤3 punteros: tlb_heap. */
+static inline uint32_t metrics_slot_of(uintptr_t replaced)
+{
+    size_t stride = tlb_layout == LAYOUT_COMPACT ? CSLOT_SIZE : SLOT_SIZE;
+    uintptr_t base = (uintptr_t)TLB_SLOTS(tlb_heap);
+    if (replaced < base || replaced >= base + (size_t)tlb_entries * stride) {
+        return TLB_NO_SLOT;
+    }
+    return (uint32_t)((replaced - base) / stride);
+}
+
+/* Publica una muestra del recorrido secuencial si ya toca */
+static inline void metrics_tick(void)
+{
+    uint64_t now = mono_ns();
+    if (now >= metrics_next) {
+        metrics_sample(now, stat_hits, stat_misses, stat_evictions,
+                       stat_faults);
+    }
+}
+
+/* Anota un acceso traducido (slot = índice del slot reemplazado en el
+   L1 o TLB_NO_SLOT) */
+static inline void metrics_note(uint32_t tag, uint32_t slot)
+{
+    metrics_tags[metrics_pending] = tag;
+    metrics_slots[metrics_pending] = slot;
+    if (++metrics_pending == METRICS_BATCH) {
+        metrics_drain();
+        metrics_tick();
+    }
+}
+
+/* Publica la muestra final con los contadores dados y libera todo */
+void metrics_close(uint64_t hits, uint64_t misses, uint64_t evictions,
+                   uint64_t faults)
+{
+    if (!metrics_buf) return;
+    if (metrics_tags) metrics_drain();
+    metrics_sample(mono_ns(), hits, misses, evictions, faults);
+    if (metrics_fd >= 0) close(metrics_fd);
+    metrics_fd = -1;
+    free(metrics_tmp);
+    free(metrics_buf);
+    free(metrics_slot_evict);
+    free(ws_mark);
+    free(ws_ring);
+    free(metrics_tags);
+    free(metrics_slots);
+    metrics_tmp = metrics_buf = NULL;
+    metrics_slot_evict = NULL;
+    ws_mark = ws_ring = metrics_tags = NULL;
+    metrics_slots = NULL;
+}
+
+/* ---------- Checkpoint y restauración (--checkpoint, --restore) ----- */
+/* Un checkpoint guarda el estado de una réplica con --trace, para
+   seguirla más tarde o para partir varias veces del mismo TLB caliente.
+   Contiene:
+   - los bloques del L1, del L2 y de la sombra de clasificación tal como
+     están en memoria (entradas, listas, contadores de recencia y estado
+     de la política);
+   - el mapa de páginas vistas;
+   - los contadores;
+   - la posición siguiente de la traza: el byte en una traza decimal o
+     el registro en una binaria.
+
+   El archivo es una cabecera de CKPT_HDR_SIZE bytes seguida de las
+   secciones, alineadas a CKPT_ALIGN. Escribirlo son unos pocos write().
+   --restore mapea el archivo con mmap y copia cada sección sobre el
+   bloque recién creado. Sólo hay que corregir OFF_BASE, que guarda la
+   dirección del propio slot.
+
+   Si el nivel actual tiene otra organización, política o disposición,
+   la restauración es una bifurcación. Las entradas válidas guardadas se
+   reinsertan de la menos a la más reciente, los contadores empiezan en
+   cero y la traza sigue desde la misma posición. */
+
+#define CKPT_MAGIC     "TLBC"
+#define CKPT_VERSION   2U
+#define CKPT_ALIGN     4096U
+#define CKPT_HASH_MAX  65536U  /* bytes de la traza que entran en el hash */
+
+/* Offsets dentro de la cabecera del checkpoint */
+#define CK_VERSION     4U
+#define CK_LRU_MODE    8U   /* lru_mode al guardar */
+#define CK_TRACE_LEN   16U  /* bytes de la traza */
+#define CK_TRACE_HASH  24U  /* FNV-1a de sus primeros CKPT_HASH_MAX bytes */
+#define CK_TRACE_POS   32U  /* byte (texto, delta) o registro siguiente */
+#define CK_TRACE_VADDR 40U  /* dirección acumulada (trazas delta) */
+#define CK_SECTIONS    56U  /* CKPT_SECTIONS x (offset, bytes) de 32 bits */
+#define CK_STATS       96U  /* CKPT_STATS contadores de 64 bits */
+#define CKPT_HDR_SIZE  256U
+
+#define CKPT_L1       0U
+#define CKPT_L2       1U
+#define CKPT_SHADOW   2U
+#define CKPT_SEEN     3U
+#define CKPT_SECTIONS 4U
+
+#define CKPT_RESUMED 1  /* misma configuración: se reanuda */
+#define CKPT_FORKED  2  /* otra configuración: TLB caliente, contadores en 0 */
+
+static uint64_t *const ckpt_stats[] = {
+    &stat_accesses, &stat_hits, &stat_misses, &stat_evictions,
+    &stat_faults, &stat_l2_hits, &stat_l2_evictions, &stat_back_inval,
+    &stat_cycles, &stat_compulsory, &stat_capacity, &stat_conflict
+};
+#define CKPT_STATS (sizeof(ckpt_stats) / sizeof(ckpt_stats[0]))
+
+static const char *ckpt_path = NULL;     /* --checkpoint */
+static uint64_t ckpt_every = 0U;         /* --checkpoint-every (accesos) */
+static uint64_t ckpt_at = 0U;            /* --checkpoint-at (accesos) */
+static const char *restore_path = NULL;  /* --restore */
+static uint64_t ckpt_next = UINT64_MAX;  /* accesos del próximo checkpoint */
+static uint64_t ckpt_trace_len = 0U;
+static uint64_t ckpt_trace_hash = 0U;
+static uint64_t ckpt_written = 0U;
+static uint64_t ckpt_last = 0U;          /* accesos del último escrito */
+static int ckpt_stopped = 0;             /* se detuvo en --checkpoint-at */
+static int ckpt_restored = 0;            /* CKPT_RESUMED / CKPT_FORKED */
+static uint64_t ckpt_restored_at = 0U;   /* accesos del restaurado */
+static uint64_t trace_resume = 0U;       /* byte o registro inicial */
+static uint64_t trace_resume_vaddr = 0U; /* dirección acumulada inicial */
+
+/* FNV-1a del comienzo de la traza (identifica la traza del checkpoint) */
+static uint64_t ckpt_hash(const char *data, size_t len)
+{
+    uint64_t h = 0xCBF29CE484222325ULL;
+    size_t n = len < CKPT_HASH_MAX ? len : CKPT_HASH_MAX;
+    size_t i;
+    for (i = 0U; i < n; ++i) {
+        h ^= (unsigned char)data[i];
+        h *= 0x100000001B3ULL;
+    }
+    return h;
+}
+
+static int ckpt_write(int fd, const char *p, size_t n)
+{
+    while (n > 0U) {
+        ssize_t w = write(fd, p, n);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) return 0;
+        p += w;
+        n -= (size_t)w;
+    }
+    return 1;
+}
+
+/* Escribe el checkpoint con la posición pos de la traza (y la dirección
+   acumulada vaddr de una traza delta). Se escribe en ARCHIVO.tmp y se
+   renombra, así que un corte a mitad conserva el checkpoint anterior.
+   Devuelve 0 si falla (ya informado en stderr). */
+int ckpt_save(uint64_t pos, uint64_t vaddr)
+{
+    static const char pad[CKPT_ALIGN];
+    uint64_t words[CKPT_HDR_SIZE / 8U];
+    char *hdr = (char *)words;
+    const char *sec[CKPT_SECTIONS];
+    uint32_t bytes[CKPT_SECTIONS];
+    uint32_t off = CKPT_ALIGN;
+    size_t n;
+    unsigned int s;
+    int ok;
+
+    if (!ckpt_path) return 0;
+    n = strlen(ckpt_path);
+    sec[CKPT_L1] = tlb_heap;
+    sec[CKPT_L2] = tlb_l2;
+    sec[CKPT_SHADOW] = tlb_shadow;
+    sec[CKPT_SEEN] = (const char *)seen_pages;
+    memset(words, 0, sizeof(words));
+    memcpy(hdr, CKPT_MAGIC, 4U);
+    FIELD32(hdr, CK_VERSION) = CKPT_VERSION;
+    FIELD32(hdr, CK_LRU_MODE) = (uint32_t)lru_mode;
+    FIELD64(hdr, CK_TRACE_LEN) = ckpt_trace_len;
+    FIELD64(hdr, CK_TRACE_HASH) = ckpt_trace_hash;
+    FIELD64(hdr, CK_TRACE_POS) = pos;
+    FIELD64(hdr, CK_TRACE_VADDR) = vaddr;
+    for (s = 0U; s < CKPT_STATS; ++s) {
+        FIELD64(hdr, CK_STATS + s * 8U) = *ckpt_stats[s];
+    }
+    for (s = 0U; s < CKPT_SECTIONS; ++s) {
+        if (!sec[s]) {
+            bytes[s] = 0U;
+        } else if (s == CKPT_SEEN) {
+            bytes[s] = (tag_space + 7U) / 8U;
+        } else {
+            bytes[s] = FIELD32(sec[s], H_TOTAL);
+        }
+        FIELD32(hdr, CK_SECTIONS + s * 8U) = bytes[s] ? off : 0U;
+        FIELD32(hdr, CK_SECTIONS + s * 8U + 4U) = bytes[s];
+        off += (bytes[s] + CKPT_ALIGN - 1U) & ~(CKPT_ALIGN - 1U);
+    }
+
+    char *tmp = (char *)malloc(n + 5U);
+    if (!tmp) {
+        perror("malloc checkpoint");
+        return 0;
+    }
+    memcpy(tmp, ckpt_path, n);
+    memcpy(tmp + n, ".tmp", 5U);
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        perror(tmp);
+        free(tmp);
+        return 0;
+    }
+    ok = ckpt_write(fd, hdr, CKPT_HDR_SIZE)
+         && ckpt_write(fd, pad, CKPT_ALIGN - CKPT_HDR_SIZE);
+    for (s = 0U; s < CKPT_SECTIONS && ok; ++s) {
+        if (!bytes[s]) continue;
+        ok = ckpt_write(fd, sec[s], bytes[s])
+             && ckpt_write(fd, pad, (CKPT_ALIGN - bytes[s] % CKPT_ALIGN)
+                                    % CKPT_ALIGN);
+    }
+    if (close(fd) != 0) ok = 0;
+    if (!ok || rename(tmp, ckpt_path) != 0) {
+        perror(ckpt_path);
+        unlink(tmp);
+        free(tmp);
+        return 0;
+    }
+    free(tmp);
+    ++ckpt_written;
+    ckpt_last = stat_accesses;
+    return 1;
+}
+
+/* Fija ckpt_next: el próximo múltiplo de --checkpoint-every o
+   --checkpoint-at, lo que llegue antes */
+void ckpt_schedule(void)
+{
+    uint64_t next = UINT64_MAX;
+    if (ckpt_every) next = (stat_accesses / ckpt_every + 1U) * ckpt_every;
+    if (ckpt_at > stat_accesses && ckpt_at < next) next = ckpt_at;
+    ckpt_next = next;
+}
+
+/* El recorrido llegó a ckpt_next accesos; pos y vaddr son los de
+   ckpt_save. Devuelve 0 si debe detenerse (--checkpoint-at). */
+static int ckpt_due(uint64_t pos, uint64_t vaddr)
+{
+    if (!ckpt_save(pos, vaddr)) {
+        ckpt_next = UINT64_MAX; /* sin más intentos; la réplica sigue */
+        return 1;
+    }
+    if (ckpt_at && stat_accesses >= ckpt_at) {
+        ckpt_stopped = 1;
+        return 0;
+    }
+    ckpt_schedule();
+    return 1;
+}
+
+/* Tras copiar un bloque a otra dirección, OFF_BASE de cada slot válido
+   vuelve a apuntar al propio slot.
+   Usa ≤3 punteros: tlb, cur. */
+static void ckpt_rebase(char *tlb)
+{
+    uint32_t n = FIELD32(tlb, H_ENTRIES);
+    uint32_t i;
+    if (FIELD32(tlb, H_LAYOUT) == LAYOUT_COMPACT) return;
+    for (i = 0U; i < n; ++i) {
+        char *cur = SLOT_AT(tlb, i);
+        if (FIELD32(cur, OFF_PAGE) != UINT32_MAX) {
+            *((uintptr_t *)(cur + OFF_BASE)) = (uintptr_t)cur;
+        }
+    }
+}
+
+/* Indica si el bloque guardado src (de bytes bytes) tiene la misma
+   forma que el bloque nuevo dst */
+static int ckpt_same_shape(const char *dst, const char *src, uint32_t bytes)
+{
+    static const unsigned int fields[] = {
+        H_ENTRIES, H_SETS, H_WAYS, H_INDEX, H_LAYOUT, H_POLICY, H_TOTAL
+    };
+    unsigned int i;
+    if (bytes != FIELD32(dst, H_TOTAL)) return 0;
+    for (i = 0U; i < sizeof(fields) / sizeof(fields[0]); ++i) {
+        if (FIELD32(dst, fields[i]) != FIELD32(src, fields[i])) return 0;
+    }
+    return 1;
+}
+
+static int ckpt_key_cmp(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/* Reinserta en dst las entradas válidas del bloque guardado src, de la
+   menos a la más reciente. La recencia sale de las marcas de la
+   disposición compacta o del modo scan (src_scan), de la posición en
+   la lista del conjunto con LRU/FIFO o, en las demás políticas, de la
+   vía. Clave: recencia << 16 | slot.
+   Usa ≤3 punteros: dst, src, keys. */
+static void ckpt_refill(char *dst, char *src, int src_scan)
+{
+    uint32_t n = FIELD32(src, H_ENTRIES);
+    uint32_t ways = FIELD32(src, H_WAYS);
+    int compact = FIELD32(src, H_LAYOUT) == LAYOUT_COMPACT;
+    int policy = (int)FIELD32(src, H_POLICY);
+    uint64_t *keys = (uint64_t *)malloc(((size_t)n + 1U) * sizeof(uint64_t));
+    uint32_t count = 0U;
+    uint32_t i;
+
+    if (!keys) {
+        perror("malloc checkpoint");
+        exit(EXIT_FAILURE);
+    }
+    if (!compact && !src_scan && (policy == POL_LRU || policy == POL_FIFO)) {
+        /* la cola de cada lista es la menos reciente */
+        for (i = 0U; i < FIELD32(src, H_SETS); ++i) {
+            uint16_t idx = FIELD16(SET_AT(src, i), SET_TAIL);
+            uint64_t rank = 0U;
+            while (idx != SLOT_NONE) {
+                if (tlb_tag_at(src, idx) != UINT32_MAX) {
+                    keys[count++] = (rank++ << 16) | idx;
+                }
+                idx = FIELD16(SLOT_AT(src, idx), OFF_PREV);
+            }
+        }
+    } else {
+        for (i = 0U; i < n; ++i) {
+            uint64_t rank = i % ways;
+            if (tlb_tag_at(src, i) == UINT32_MAX) continue;
+            if (compact) rank = CSLOT_AGE(FIELD64(CSLOT_AT(src, i), 0));
+            else if (src_scan) rank = FIELD32(SLOT_AT(src, i), OFF_LRU);
+            keys[count++] = (rank << 16) | i;
+        }
+    }
+    qsort(keys, count, sizeof(uint64_t), ckpt_key_cmp);
+    for (i = 0U; i < count; ++i) {
+        uint16_t idx = (uint16_t)(keys[i] & 0xFFFFU);
+        uint32_t tag = tlb_tag_at(src, idx);
+        uint32_t offs = compact ? 0U : FIELD32(SLOT_AT(src, idx), OFF_OFFS);
+        char pb[PAGE_BIN_SIZE];
+        char ob[OFF_BIN_SIZE];
+        dec_to_bin(tag, 20, pb);
+        dec_to_bin(offs, 12, ob);
+        tlb_insert(dst, tag, offs, pb, ob, NULL);
+    }
+    free(keys);
+}
+
+/* Restaura --restore sobre los niveles recién creados. trace/len es la
+   traza de --trace, que debe ser la del checkpoint. Devuelve 0 si el
+   archivo no sirve (ya informado en stderr). */
+int ckpt_restore(const char *trace, size_t len)
+{
+    size_t ck_len = 0U;
+    int mapped = 0;
+    char *ck = restore_path ? map_file(restore_path, &ck_len, &mapped)
+                            : NULL;
+    char *dst[CKPT_SECTIONS];
+    int forked = 0;
+    unsigned int s;
+
+    if (!ck) return 0;
+    dst[CKPT_L1] = tlb_heap;
+    dst[CKPT_L2] = tlb_l2;
+    dst[CKPT_SHADOW] = tlb_shadow;
+    dst[CKPT_SEEN] = (char *)seen_pages;
+    if (ck_len < CKPT_HDR_SIZE || memcmp(ck, CKPT_MAGIC, 4U) != 0
+        || FIELD32(ck, CK_VERSION) != CKPT_VERSION) {
+        fprintf(stderr, "Error: %s no es un checkpoint válido\n",
+                restore_path);
+        unmap_file(ck, ck_len, mapped);
+        return 0;
+    }
+    for (s = 0U; s < CKPT_SECTIONS; ++s) {
+        uint64_t off = FIELD32(ck, CK_SECTIONS + s * 8U);
+        uint64_t bytes = FIELD32(ck, CK_SECTIONS + s * 8U + 4U);
+        if (bytes && (off % CKPT_ALIGN != 0U || off + bytes > ck_len
+                      || (s != CKPT_SEEN && bytes < TLB_HDR_SIZE))) {
+            fprintf(stderr, "Error: %s está truncado o dañado\n",
+                    restore_path);
+            unmap_file(ck, ck_len, mapped);
+            return 0;
+        }
+    }
+    if (FIELD32(ck, CK_SECTIONS + CKPT_SEEN * 8U + 4U)
+        != (tag_space + 7U) / 8U
+        || FIELD32(ck, CK_SECTIONS + CKPT_L1 * 8U + 4U) == 0U) {
+        fprintf(stderr, "Error: %s está truncado o dañado\n", restore_path);
+        unmap_file(ck, ck_len, mapped);
+        return 0;
+    }
+    if (FIELD64(ck, CK_TRACE_LEN) != len
+        || FIELD64(ck, CK_TRACE_HASH) != ckpt_hash(trace, len)) {
+        fprintf(stderr, "Error: %s es de otra traza\n", restore_path);
+        unmap_file(ck, ck_len, mapped);
+        return 0;
+    }
+
+    for (s = 0U; s < CKPT_SEEN; ++s) {
+        uint32_t bytes = FIELD32(ck, CK_SECTIONS + s * 8U + 4U);
+        char *src = ck + FIELD32(ck, CK_SECTIONS + s * 8U);
+        if (!dst[s] || !bytes) {
+            /* nivel que sólo existe de un lado: empieza vacío */
+            if (dst[s] || bytes) forked = 1;
+            continue;
+        }
+        if ((int)FIELD32(ck, CK_LRU_MODE) == lru_mode
+            && ckpt_same_shape(dst[s], src, bytes)) {
+            memcpy(dst[s], src, bytes);
+            ckpt_rebase(dst[s]);
+        } else {
+            ckpt_refill(dst[s], src, FIELD32(ck, CK_LRU_MODE) == LRU_SCAN);
+            forked = 1;
+        }
+    }
+    memcpy(seen_pages, ck + FIELD32(ck, CK_SECTIONS + CKPT_SEEN * 8U),
+           (tag_space + 7U) / 8U);
+    if (!forked) {
+        for (s = 0U; s < CKPT_STATS; ++s) {
+            *ckpt_stats[s] = FIELD64(ck, CK_STATS + s * 8U);
+        }
+    }
+    trace_resume = FIELD64(ck, CK_TRACE_POS);
+    trace_resume_vaddr = FIELD64(ck, CK_TRACE_VADDR);
+    ckpt_restored = forked ? CKPT_FORKED : CKPT_RESUMED;
+    ckpt_restored_at = FIELD64(ck, CK_STATS);
+    unmap_file(ck, ck_len, mapped);
+    return 1;
+}
+
+/* Informe de --checkpoint / --restore tras el resumen */
+void print_ckpt_summary(void)
+{
+    if (ckpt_restored && restore_path) {
+        printf("Restaurado: %s (acceso %" PRIu64 ", %s)\n", restore_path,
+               ckpt_restored_at, ckpt_restored == CKPT_RESUMED
+               ? "reanudado" : "bifurcado: TLB caliente, contadores desde"
+                 " cero");
+    }
+    if (ckpt_path) {
+        printf("Checkpoints: %" PRIu64 " en %s (último en el acceso %"
+               PRIu64 "%s)\n", ckpt_written, ckpt_path, ckpt_last,
+               ckpt_stopped ? ", réplica detenida" : "");
+    }
+}
+
+/* ---------- Recorrido de trazas ---------- */
+
+/* Estados devueltos por trace_next_line */
+#define LINE_ADDR   1   /* dirección válida en *val */
+#define LINE_FAULT  0   /* línea no traducible (Page Fault) */
+#define LINE_SKIP   2   /* línea vacía */
+#define LINE_END   -1   /* fin de la traza ("s" o fin del bloque) */
+#define LINE_SWITCH 3   /* "cN": cambio al ASID N (con --asids) */
+#define LINE_INVLPG 4   /* "iADDR": invlpg de la página de ADDR */
+#define LINE_FLUSH  5   /* "fN": vaciado selectivo del ASID N */
+
+/* Analiza la siguiente línea de una traza decimal a partir de *pp sin
+   copiarla. Devuelve uno de los estados LINE_* y deja en *line y
+   *line_len el texto de la línea (sin '\r' ni '\n'). Los registros
+   "c", "i" y "f" sólo se reconocen con --asids; sin él son líneas
+   inválidas, como antes. */
+int trace_next_line(char **pp, const char *end, uint64_t *val,
+                    const char **line, size_t *line_len)
+{
+    char *p = *pp;
+    uint64_t v = 0U;
+    int ok = 1;
+    int kind = LINE_ADDR;
+
+    if (p >= end) return LINE_END;
+    *line = p;
+    if (asid_count && (*p == 'c' || *p == 'i' || *p == 'f')) {
+        kind = *p == 'c' ? LINE_SWITCH
+                         : (*p == 'i' ? LINE_INVLPG : LINE_FLUSH);
+        ++p;
+    }
+    while (p < end && *p != '\n') {
+        unsigned int d = (unsigned int)(*p - '0');
+        if (d < 10U && v <= va_parse_max) {
+            v = v * 10U + d;
+        } else if (d < 10U && v == UINT64_MAX / 10U
+                   && d <= UINT64_MAX % 10U) {
+            v = v * 10U + d; /* últimas direcciones de 64 bits */
+        } else if (*p != '\r') {
+            ok = 0;
+        }
+        ++p;
+    }
+    size_t n = (size_t)(p - *line);
+    *pp = p + 1; /* saltar '\n' */
+
+    if (n > 0U && (*line)[n - 1U] == '\r') --n;
+    *line_len = n;
+    if (n == 0U) return LINE_SKIP;
+    if (n == 1U && (*line)[0] == 's') return LINE_END;
+    if (!ok || (va_bits == 32U ? v > UINT32_MAX : !va_canonical(v))) {
+        return LINE_FAULT;
+    }
+    if (kind != LINE_ADDR) {
+        if (n == 1U || (kind != LINE_INVLPG && v >= asid_count)) {
+            return LINE_FAULT;
+        }
+    }
+    *val = v;
+    return kind;
+}
+
+/* Con un solo L1 (sin L2, ASID, --pages, --walk, --prefetch, opt ni
+   48/57 bits) la línea de órdenes es un cliente más de la API de
+   traducir.h. En el modo por lotes con --summary (y sin --timer ni
+   checkpoints) las direcciones se juntan en bloques de TRACE_BATCH, se
+   traducen con tlb_translate y los resultados alimentan la
+   clasificación y los contadores; el modo interactivo traduce de a
+   una con la misma instancia. */
+#define TRACE_BATCH 4096U
+
+static tlb_engine *trace_engine = NULL;
+static uint64_t trace_batch[TRACE_BATCH];
+static uint8_t trace_results[TRACE_BATCH];
+static uint64_t trace_evicted[TRACE_BATCH];
+static uint32_t trace_slots[TRACE_BATCH];
+static unsigned int trace_batched = 0U;
+
+/* Con --metrics cada acceso traducido se anota con el slot que
+   devuelve tlb_translate_slots. */
+static void trace_flush_batch(void)
+{
+    unsigned int i;
+    tlb_translate_slots(trace_engine, trace_batch, trace_batched,
+                        trace_results, trace_evicted,
+                        metrics_tags ? trace_slots : NULL);
+    for (i = 0U; i < trace_batched; ++i) {
+        if (trace_results[i] == TLB_RES_FAULT) {
+            ++stat_faults;
+            continue;
+        }
+        int hit = trace_results[i] == TLB_RES_HIT;
+        classify_access((uint32_t)(trace_batch[i] >> 12), hit);
+        stat_cycles += lat_l1;
+        if (hit) {
+            ++stat_hits;
+        } else {
+            ++stat_misses;
+            stat_cycles += lat_walk;
+            if (trace_evicted[i] != TLB_NO_EVICT) ++stat_evictions;
+        }
+        if (metrics_tags) {
+            metrics_note((uint32_t)(trace_batch[i] >> 12), trace_slots[i]);
+        }
+    }
+    trace_batched = 0U;
+}
+
+/* Abre trace_engine con la configuración de la línea de órdenes si es
+   la de un solo L1 (si no, o sin memoria, queda en NULL) */
+static void engine_open_l1(void)
+{
+    static const char *const layouts[] = { "aos", "soa", "compact" };
+    if (l2_entries || asid_count || page_map || walk_enabled
+        || pf_kind != PF_NONE || tlb_policy == POL_OPT || va_bits != 32U) {
+        return;
+    }
+    trace_engine = tlb_engine_open(tlb_sets, tlb_entries / tlb_sets,
+                                   tlb_index_fn == INDEX_XOR ? "xor" : "low",
+                                   lru_mode == LRU_SCAN ? "lru-scan"
+                                   : tlb_policy_names[tlb_policy],
+                                   layouts[tlb_layout]);
+    if (trace_engine) tlb_engine_seed(trace_engine, policy_seed);
+}
+
+/* Abre trace_engine para el modo por lotes */
+static void trace_engine_open(int verbose)
+{
+    if (verbose || timer_kind != TIMER_GTOD || ckpt_path || restore_path) {
+        return;
+    }
+    engine_open_l1();
+}
+
+/* Traduce lo que quede en el bloque y cierra trace_engine */
+static void trace_engine_close(void)
+{
+    if (!trace_engine) return;
+    if (trace_batched) trace_flush_batch();
+    tlb_engine_close(trace_engine);
+    trace_engine = NULL;
+}
+
+/* Abre trace_engine para el modo interactivo: tlb_heap pasa a ser su
+   TLB, así que los límites del informe y el slot reemplazado se leen
+   igual que con tlb_access */
+static void tty_engine_open(void)
+{
+    engine_open_l1();
+    if (!trace_engine) return;
+    free_tlb();
+    tlb_heap = tlb_engine_tlb(trace_engine);
+}
+
+static void tty_engine_close(void)
+{
+    if (!trace_engine) return;
+    tlb_heap = NULL; /* lo libera tlb_engine_close */
+    tlb_engine_close(trace_engine);
+    trace_engine = NULL;
+}
+
+/* tlb_access del modo interactivo con trace_engine: una dirección
+   válida de 32 bits por tlb_translate_slots. En un Miss las cadenas
+   binarias se copian en el slot nuevo (la API las deja en cero).
+   Usa ≤3 punteros: slot, page_bin, off_bin. */
+static int tty_engine_access(uint64_t vaddr, const char *page_bin,
+                             const char *off_bin, uintptr_t *replaced)
+{
+    uint8_t res;
+    uint32_t idx;
+    char *slot;
+
+    tlb_translate_slots(trace_engine, &vaddr, 1U, &res, NULL, &idx);
+    stat_cycles += lat_l1;
+    *replaced = (uintptr_t)0;
+    if (res == TLB_RES_HIT) return LEVEL_L1;
+    stat_cycles += lat_walk;
+    if (idx != TLB_NO_SLOT) {
+        *replaced = (uintptr_t)TLB_ENTRY_AT(tlb_heap, idx);
+    }
+    if (tlb_layout != LAYOUT_COMPACT) {
+        slot = tlb_find(tlb_heap, (uint32_t)(vaddr >> 12));
+        memcpy(slot + OFF_PAGE_BIN, page_bin, PAGE_BIN_SIZE);
+        memcpy(slot + OFF_OFF_BIN, off_bin, OFF_BIN_SIZE);
+    }
+    return LEVEL_MISS;
+}
+
+/* Traduce una dirección válida de la traza y acumula estadísticas.
+   Si verbose != 0 escribe "<dir> <H|S|M> <reemplazo>" en el buffer
+   (S = Miss en L1 resuelto por el L2). */
+static inline void trace_step(uint64_t vaddr, int verbose)
+{
+    uintptr_t replaced;
+    int level;
+    if (trace_engine) {
+        ++stat_accesses;
+        trace_batch[trace_batched++] = vaddr;
+        if (trace_batched == TRACE_BATCH) trace_flush_batch();
+        return;
+    }
+    if (opt_next) tlb_policy_hint = opt_next[opt_pos++];
+    if (timer_kind != TIMER_GTOD) {
+        uint64_t t0 = timer_now();
+        level = tlb_access(vaddr, NULL, NULL, &replaced);
+        lat_record(lat_stats, level == LEVEL_L1 ? HIST_HIT : HIST_MISS, t0,
+                   timer_now());
+    } else {
+        level = tlb_access(vaddr, NULL, NULL, &replaced);
+    }
+    classify_access(page_tag(vaddr), level == LEVEL_L1);
+    if (tlb_base4k) huge_account(vaddr, level == LEVEL_L1);
+    if (tlb_asid_alt) asid_account(page_tag(vaddr), level == LEVEL_L1);
+    ++stat_accesses;
+    if (level == LEVEL_L1) {
+        ++stat_hits;
+    } else {
+        ++stat_misses;
+        if (level == LEVEL_L2) ++stat_l2_hits;
+        if (replaced != (uintptr_t)0) ++stat_evictions;
+    }
+    if (metrics_tags) {
+        metrics_note(page_tag(vaddr), replaced != (uintptr_t)0
+                                      ? metrics_slot_of(replaced)
+                                      : TLB_NO_SLOT);
+    }
+    if (verbose) {
+        if (out_len + OUT_LINE_MAX > OUT_BUF_SIZE) out_flush();
+        out_u64(vaddr);
+        out_buf[out_len++] = ' ';
+        out_buf[out_len++] = level == LEVEL_L1 ? 'H'
+                             : (level == LEVEL_L2 ? 'S' : 'M');
+        out_buf[out_len++] = ' ';
+        out_hex(replaced);
+        out_buf[out_len++] = '\n';
+    }
+}
+
+/* Recorre una traza de direcciones en decimal (una por línea) sin
+   pasar por stdio por cada acceso. Las líneas vacías se ignoran, una
+   línea "s" termina la traza y cualquier otra línea inválida cuenta
+   como Page Fault ("<línea> F" en la salida), igual que en el modo
+   interactivo. Los registros de ASID no producen salida. Empieza en el
+   byte trace_resume (--restore). */
+void run_trace(char *text, size_t len, int verbose)
+{
+    char *p = text + trace_resume;
+    const char *end = text + len;
+    const char *line;
+    size_t line_len;
+    uint64_t vaddr = 0U;
+    int st;
+
+    while ((st = trace_next_line(&p, end, &vaddr, &line, &line_len))
+           != LINE_END) {
+        if (st == LINE_ADDR) {
+            trace_step(vaddr, verbose);
+        } else if (st == LINE_SWITCH) {
+            asid_switch((unsigned int)vaddr);
+        } else if (st == LINE_INVLPG) {
+            asid_invlpg(vaddr);
+        } else if (st == LINE_FLUSH) {
+            asid_selective_flush((unsigned int)vaddr);
+        } else if (st == LINE_FAULT) {
+            ++stat_accesses;
+            ++stat_faults;
+            if (verbose) {
+                if (line_len > OUT_LINE_MAX - 3U) {
+                    line_len = OUT_LINE_MAX - 3U;
+                }
+                if (out_len + OUT_LINE_MAX > OUT_BUF_SIZE) out_flush();
+                memcpy(out_buf + out_len, line, line_len);
+                out_len += line_len;
+                memcpy(out_buf + out_len, " F\n", 3U);
+                out_len += 3U;
+            }
+        }
+        if (stat_accesses >= ckpt_next
+            && !ckpt_due((uint64_t)(p - text), 0U)) {
+            break;
+        }
+    }
+}
+
+/* Recorre una traza binaria directamente desde el mapeo del archivo
+   (sin copiar las direcciones a otro buffer), desde el registro
+   trace_resume. */
+void run_trace_bin(const uint32_t *addrs, uint64_t count, int verbose)
+{
+    uint64_t i;
+    for (i = trace_resume; i < count; ++i) {
+        trace_step(TRACE_LE32(addrs[i]), verbose);
+        if (stat_accesses >= ckpt_next && !ckpt_due(i + 1U, 0U)) break;
+    }
+}
+
+/* Igual que run_trace_bin para trazas TRACE_F_WIDE (--va-bits 48/57).
+   Las direcciones no canónicas cuentan como Page Fault. */
+void run_trace_bin64(const uint64_t *addrs, uint64_t count, int verbose)
+{
+    uint64_t i;
+    for (i = 0U; i < count; ++i) {
+        uint64_t vaddr = TRACE_LE64(addrs[i]);
+        if (va_canonical(vaddr)) {
+            trace_step(vaddr, verbose);
+        } else {
+            ++stat_accesses;
+            ++stat_faults;
+        }
+    }
+}
+
+/* Recorre una traza TRACE_F_DELTA (varints de recs a end) desde el
+   byte trace_resume con la dirección acumulada trace_resume_vaddr.
+   Sin wide las sumas son módulo 2^32, como las direcciones de 32 bits. */
+void run_trace_delta(const unsigned char *recs, const unsigned char *end,
+                     int wide, int verbose)
+{
+    const unsigned char *p = recs + trace_resume;
+    uint64_t vaddr = trace_resume_vaddr;
+    while (p < end) {
+        vaddr += (uint64_t)rd_varint(&p, end);
+        if (!wide) {
+            vaddr = (uint32_t)vaddr;
+        } else if (!va_canonical(vaddr)) {
+            ++stat_accesses;
+            ++stat_faults;
+            continue;
+        }
+        trace_step(vaddr, verbose);
+        if (stat_accesses >= ckpt_next
+            && !ckpt_due((uint64_t)(p - recs), vaddr)) {
+            break;
+        }
+    }
+}
+
+/* Convierte una traza decimal al formato binario. Las líneas que no
+   son direcciones válidas no se pueden representar y se descartan
+   (se informa cuántas). */
+int convert_main(const char *in_path, const char *out_path, int delta)
+{
+    size_t len = 0U;
+    int mapped = 0;
+    char *text = map_file(in_path, &len, &mapped);
+    if (!text) return EXIT_FAILURE;
+
+    FILE *out = fopen(out_path, "wb");
+    if (!out) {
+        perror(out_path);
+        unmap_file(text, len, mapped);
+        return EXIT_FAILURE;
+    }
+
+    unsigned char hdr[TRACE_HDR_SIZE];
+    memset(hdr, 0, sizeof(hdr));
+    fwrite(hdr, 1U, sizeof(hdr), out); /* se reescribe al final */
+
+    char *p = text;
+    const char *line;
+    size_t line_len;
+    uint64_t vaddr = 0U;
+    uint64_t prev = 0U;
+    uint64_t count = 0U;
+    uint64_t dropped = 0U;
+    unsigned char rec[TRACE_VARINT_MAX];
+    int rec_size = va_bits == 32U ? 4 : 8;
+    int st;
+
+    while ((st = trace_next_line(&p, text + len, &vaddr, &line, &line_len))
+           != LINE_END) {
+        if (st == LINE_FAULT || st >= LINE_SWITCH) ++dropped;
+        if (st != LINE_ADDR) continue;
+        if (delta) {
+            int n = wr_varint(rec, (int64_t)(vaddr - prev));
+            fwrite(rec, 1U, (size_t)n, out);
+        } else {
+            wr_le(rec, vaddr, rec_size);
+            fwrite(rec, 1U, (size_t)rec_size, out);
+        }
+        prev = vaddr;
+        ++count;
+    }
+
+    memcpy(hdr, TRACE_MAGIC, 4U);
+    wr_le(hdr + 4, TRACE_VERSION, 2);
+    wr_le(hdr + 6, (delta ? TRACE_F_DELTA : 0U)
+                   | (va_bits == 32U ? 0U : TRACE_F_WIDE), 2);
+    wr_le(hdr + 8, count, 8);
+    int rc = 0;
+    if (fseek(out, 0L, SEEK_SET) != 0 ||
+        fwrite(hdr, 1U, sizeof(hdr), out) != sizeof(hdr)) {
+        perror(out_path);
+        rc = EXIT_FAILURE;
+    }
+    if (fclose(out) != 0) {
+        perror(out_path);
+        rc = EXIT_FAILURE;
+    }
+    unmap_file(text, len, mapped);
+
+    fprintf(stderr, "Convertidas: %" PRIu64 " direcciones", count);
+    if (dropped) fprintf(stderr, " (%" PRIu64 " descartadas)", dropped);
+    fprintf(stderr, "\n");
+    return rc;
+}
+
+/* Llama a fn con cada dirección válida de una traza (texto o binaria)
+   ya proyectada en memoria. Las líneas inválidas se saltan. Lo usan
+   los análisis que no pasan por el TLB (curva de fallos, etc.). Los
+   cambios de contexto actualizan asid_tag para que page_tag etiquete
+   cada dirección con su ASID; al terminar vuelve al ASID 0. */
+void trace_for_each(char *data, size_t len, int binary,
+                    void (*fn)(uint64_t))
+{
+    if (binary) {
+        const unsigned char *hdr = (const unsigned char *)data;
+        const unsigned char *recs = hdr + TRACE_HDR_SIZE;
+        const uint32_t *addrs = (const uint32_t *)recs;
+        const uint64_t *addrs64 = (const uint64_t *)recs;
+        uint64_t count = rd_le(hdr + 8, 8);
+        unsigned int flags = (unsigned int)rd_le(hdr + 6, 2);
+        uint64_t vaddr = 0U;
+        uint64_t i;
+        if (flags & TRACE_F_DELTA) {
+            const unsigned char *end = hdr + len;
+            while (recs < end) {
+                vaddr += (uint64_t)rd_varint(&recs, end);
+                if (!(flags & TRACE_F_WIDE)) {
+                    vaddr = (uint32_t)vaddr;
+                    fn(vaddr);
+                } else if (va_canonical(vaddr)) {
+                    fn(vaddr);
+                }
+            }
+            return;
+        }
+        for (i = 0U; i < count; ++i) {
+            if (flags & TRACE_F_WIDE) {
+                vaddr = TRACE_LE64(addrs64[i]);
+                if (va_canonical(vaddr)) fn(vaddr);
+            } else {
+                fn(TRACE_LE32(addrs[i]));
+            }
+        }
+        return;
+    }
+    char *p = data;
+    const char *line;
+    size_t line_len;
+    uint64_t vaddr = 0U;
+    int st;
+    while ((st = trace_next_line(&p, data + len, &vaddr, &line, &line_len))
+           != LINE_END) {
+        if (st == LINE_ADDR) fn(vaddr);
+        else if (st == LINE_SWITCH) asid_tag = (uint32_t)vaddr << ASID_SHIFT;
+    }
+    asid_tag = 0U;
+}
+
+/* ---------- Política OPT (Belady, fuera de línea) ---------- */
+
+/* Primera pasada sobre la traza: opt_next[i] queda con el número del
+   siguiente acceso a la página del acceso i (UINT32_MAX si no vuelve).
+   trace_step lo pasa a la política en tlb_policy_hint antes de cada
+   traducción. */
+static uint64_t opt_count = 0U;
+static uint64_t opt_cap = 0U;
+
+static void opt_collect(uint64_t vaddr)
+{
+    if (opt_count == opt_cap) {
+        uint64_t cap = opt_cap ? opt_cap * 2U : 1U << 20;
+        uint32_t *grown;
+        if (cap >= UINT32_MAX) {
+            fprintf(stderr, "Error: traza demasiado larga para OPT\n");
+            exit(EXIT_FAILURE);
+        }
+        grown = (uint32_t *)realloc(opt_next, (size_t)cap * sizeof(uint32_t));
+        if (!grown) {
+            perror("malloc OPT");
+            exit(EXIT_FAILURE);
+        }
+        opt_next = grown;
+        opt_cap = cap;
+    }
+    opt_next[opt_count++] = page_tag(vaddr);
+}
+
+/* Calcula opt_next recorriendo la traza hacia atrás */
+int opt_prepare(char *data, size_t len, int binary)
+{
+    uint32_t *last = (uint32_t *)malloc((size_t)tag_space * sizeof(uint32_t));
+    uint64_t i;
+
+    if (!last) {
+        perror("malloc OPT");
+        return 0;
+    }
+    opt_count = 0U;
+    opt_pos = 0U;
+    trace_for_each(data, len, binary, opt_collect);
+    memset(last, 0xFF, (size_t)tag_space * sizeof(uint32_t));
+    for (i = opt_count; i-- > 0U; ) {
+        uint32_t page = opt_next[i];
+        opt_next[i] = last[page];
+        last[page] = (uint32_t)i;
+    }
+    free(last);
+    return 1;
+}
+
+void opt_free(void)
+{
+    free(opt_next);
+    opt_next = NULL;
+    opt_count = opt_cap = opt_pos = 0U;
+}
+
+/* Nombre de la disposición para los resúmenes (en SoA, el sondeo) */
+static const char *layout_name(void)
+{
+    if (tlb_layout == LAYOUT_COMPACT) return "compact";
+    return tlb_layout == LAYOUT_SOA ? tlb_tags_probe_name : "aos";
+}
+
+/* Imprime el resumen de una ejecución por lotes */
+void print_summary(double elapsed)
+{
+    uint64_t translated = stat_hits + stat_misses;
+    printf("TLB: %u entradas, %u conjuntos x %u vías (índice %s, %s, %s)\n",
+           tlb_entries, tlb_sets, tlb_entries / tlb_sets,
+           tlb_index_fn == INDEX_XOR ? "xor" : "bajo",
+           layout_name(),
+           lru_mode == LRU_SCAN ? "lru-scan" : tlb_policy_names[tlb_policy]);
+    printf("Accesos: %" PRIu64 "\n", stat_accesses);
+    printf("TLB Hit: %" PRIu64 " (%.2f%%)\n", stat_hits,
+           translated ? 100.0 * (double)stat_hits / (double)translated
+                      : 0.0);
+    printf("TLB Miss: %" PRIu64 "\n", stat_misses);
+    printf("  Obligatorios: %" PRIu64 "\n", stat_compulsory);
+    printf("  Capacidad: %" PRIu64 "\n", stat_capacity);
+    printf("  Conflicto: %" PRIu64 "\n", stat_conflict);
+    printf("Reemplazos: %" PRIu64 "\n", stat_evictions);
+    if (tlb_l2) {
+        uint64_t l2_lookups = stat_misses;
+        printf("L2: %u entradas, %u conjuntos x %u vías (%s)\n",
+               l2_entries, l2_sets, l2_entries / l2_sets,
+               l2_exclusive ? "exclusivo" : "inclusivo");
+        printf("  L2 Hit: %" PRIu64 " de %" PRIu64 " (%.2f%%)\n",
+               stat_l2_hits, l2_lookups,
+               l2_lookups ? 100.0 * (double)stat_l2_hits
+                            / (double)l2_lookups : 0.0);
+        printf("  L2 Reemplazos: %" PRIu64 "\n", stat_l2_evictions);
+        if (!l2_exclusive) {
+            printf("  Invalidaciones en L1: %" PRIu64 "\n",
+                   stat_back_inval);
+        }
+        printf("  Miss en todos los niveles: %" PRIu64 "\n",
+               stat_misses - stat_l2_hits);
+    }
+    if (pf_kind != PF_NONE) {
+        uint64_t base_misses = stat_pf_base_misses;
+        if (tlb_pf) {
+            printf("Prefetch: %s, grado %u, buffer de %u entradas\n",
+                   pf_names[pf_kind], pf_degree, pf_buf_entries);
+        } else {
+            printf("Prefetch: %s, grado %u, en el L1\n", pf_names[pf_kind],
+                   pf_degree);
+        }
+        printf("  Emitidos: %" PRIu64 " (redundantes: %" PRIu64 ")\n",
+               stat_pf_issued, stat_pf_redundant);
+        printf("  Útiles: %" PRIu64 " (precisión %.2f%%)\n", stat_pf_useful,
+               stat_pf_issued ? 100.0 * (double)stat_pf_useful
+                                / (double)stat_pf_issued : 0.0);
+        printf("  Cobertura: %.2f%% de %" PRIu64 " Miss sin prefetch\n",
+               base_misses ? 100.0 * (double)stat_pf_useful
+                             / (double)base_misses : 0.0, base_misses);
+        if (!tlb_pf) {
+            printf("  Expulsiones por prefetch: %" PRIu64 "\n",
+                   stat_pf_evictions);
+        }
+        printf("  Miss por contaminación: %" PRIu64 "\n", stat_pf_pollution);
+        if (walk_enabled) {
+            printf("  Walks de prefetch: %" PRIu64 " (accesos a memoria: %"
+                   PRIu64 ", descartados sin PTE: %" PRIu64 ")\n",
+                   stat_pf_walks, stat_pf_walk_mem, stat_pf_dropped);
+        }
+    }
+    if (walk_enabled) {
+        printf("Page walks: %" PRIu64 " (accesos a memoria: %" PRIu64
+               ", %.3f por walk)\n", stat_walks, stat_walk_mem,
+               stat_walks ? (double)stat_walk_mem / (double)stat_walks
+                          : 0.0);
+        printf("  PWC Hit: %" PRIu64 " (%.2f%%, %u entradas)\n",
+               stat_pwc_hits,
+               stat_walks ? 100.0 * (double)stat_pwc_hits
+                            / (double)stat_walks : 0.0, pwc_entries);
+        printf("  Fallos de página: %" PRIu64
+               " (tablas de páginas creadas: %" PRIu64 ")\n",
+               stat_pt_faults, stat_pt_tables);
+        printf("Ciclos simulados: %" PRIu64
+               " (L1=%u, L2=%u, memoria=%u, fallo=%u)\n",
+               stat_cycles, lat_l1, lat_l2, lat_mem, lat_fault);
+    } else {
+        printf("Ciclos simulados: %" PRIu64 " (L1=%u, L2=%u, walk=%u)\n",
+               stat_cycles, lat_l1, lat_l2, lat_walk);
+    }
+    printf("Costo medio por traducción: %.3f ciclos\n",
+           translated ? (double)stat_cycles / (double)translated : 0.0);
+    print_huge_summary(translated);
+    print_asid_summary(translated, stat_hits);
+    printf("Page Fault: %" PRIu64 "\n", stat_faults);
+    printf("Tiempo: %.6f segundos\n", elapsed);
+    printf("Traducciones/s: %.0f\n",
+           elapsed > 0.0 ? (double)translated / elapsed : 0.0);
+    print_latency();
+}
+
+/* Punto de entrada del modo por lotes. El formato (decimal o binario)
+   se detecta por el número mágico de la cabecera. */
+int trace_main(const char *path, int verbose)
+{
+    size_t len = 0U;
+    int mapped = 0;
+    char *data = map_file(path, &len, &mapped);
+    if (!data) return EXIT_FAILURE;
+
+    uint64_t count = 0U;
+    unsigned int flags = 0U;
+    int binary = trace_bin_header(data, len, path, &count, &flags);
+    if (binary < 0) {
+        unmap_file(data, len, mapped);
+        return EXIT_FAILURE;
+    }
+
+    if (verbose) {
+        out_buf = (char *)malloc(OUT_BUF_SIZE);
+        if (!out_buf) {
+            perror("malloc salida");
+            unmap_file(data, len, mapped);
+            return EXIT_FAILURE;
+        }
+    }
+    if (tlb_policy == POL_OPT && !opt_prepare(data, len, binary)) {
+        free(out_buf);
+        unmap_file(data, len, mapped);
+        return EXIT_FAILURE;
+    }
+    init_levels();
+    classify_init();
+    asid_init();
+    ckpt_trace_len = len;
+    ckpt_trace_hash = ckpt_hash(data, len);
+    if (restore_path && !ckpt_restore(data, len)) {
+        asid_free();
+        classify_free();
+        free_levels();
+        opt_free();
+        free(out_buf);
+        out_buf = NULL;
+        unmap_file(data, len, mapped);
+        return EXIT_FAILURE;
+    }
+    if (ckpt_path) ckpt_schedule();
+    trace_engine_open(verbose);
+
+    struct timeval t0, t1;
+    gettimeofday(&t0, NULL);
+    if (binary && (flags & TRACE_F_DELTA)) {
+        run_trace_delta((const unsigned char *)data + TRACE_HDR_SIZE,
+                        (const unsigned char *)data + len,
+                        (flags & TRACE_F_WIDE) != 0U, verbose);
+    } else if (binary && (flags & TRACE_F_WIDE)) {
+        run_trace_bin64((const uint64_t *)(data + TRACE_HDR_SIZE), count,
+                        verbose);
+    } else if (binary) {
+        run_trace_bin((const uint32_t *)(data + TRACE_HDR_SIZE), count,
+                      verbose);
+    } else {
+        run_trace(data, len, verbose);
+    }
+    trace_engine_close();
+    /* estado final: la traza terminó (posición = su largo) */
+    if (ckpt_path && !ckpt_stopped) {
+        ckpt_save(binary ? count : (uint64_t)len, 0U);
+    }
+    gettimeofday(&t1, NULL);
+    double elapsed = (t1.tv_sec - t0.tv_sec) +
+        (t1.tv_usec - t0.tv_usec) / 1e6;
+    metrics_close(stat_hits, stat_misses, stat_evictions, stat_faults);
+
+    if (verbose) out_flush();
+    print_summary(elapsed);
+    print_ckpt_summary();
+
+    asid_free();
+    classify_free();
+    free_levels();
+    opt_free();
+    free(out_buf);
+    out_buf = NULL;
+    unmap_file(data, len, mapped);
+    return 0;
+}
+
+/* ---------- Generador sintético de accesos (--gen) ---------- */
+
+/* Produce las direcciones en memoria y las pasa directamente a
+   trace_step, sin texto de por medio, así que se pueden simular miles
+   de millones de accesos sin archivo. La especificación es una lista
+   separada por comas de patrones "NOMBRE[:PARÁMETRO][@PESO]"; cada
+   acceso elige uno según los pesos (por defecto 1) y cada patrón
+   conserva su propio estado entre accesos:
+     seq[:B]     recorrido secuencial de B bytes por acceso (64)
+     stride[:K]  salto de K páginas por acceso (16)
+     uniform     página uniforme
+     zipf[:S]    Zipf de exponente S (0.99): la página k es la k-ésima
+                 más popular
+     chase       persecución de punteros por un ciclo aleatorio que
+                 visita todas las páginas (algoritmo de Sattolo)
+   Las páginas están en [0, --gen-pages) y, salvo en seq, el
+   desplazamiento dentro de la página es aleatorio. Todo sale de un
+   xorshift64 sembrado con --seed: la misma semilla da la misma traza.
+   Con --gen-out la secuencia se guarda en el formato decimal de
+   entrada (una dirección por línea y "s" al final) en vez de simularse,
+   para repetirla con mt.c o con --trace. */
+#define GEN_SEQ     0
+#define GEN_STRIDE  1
+#define GEN_UNIFORM 2
+#define GEN_ZIPF    3
+#define GEN_CHASE   4
+#define GEN_KINDS   5
+#define GEN_MAX_PARTS 8U
+#define GEN_PAGES_MAX (1U << 20)
+
+static const char *const gen_names[GEN_KINDS] = {
+    "seq", "stride", "uniform", "zipf", "chase"
+};
+static const double gen_defaults[GEN_KINDS] = { 64.0, 16.0, 0.0, 0.99, 0.0 };
+
+static const char *gen_spec = NULL;      /* --gen */
+static uint64_t gen_count = 1000000U;    /* --gen-count */
+static uint32_t gen_pages = 65536U;      /* --gen-pages */
+static unsigned int gen_parts = 0U;
+static int gen_kind[GEN_MAX_PARTS];
+static double gen_param[GEN_MAX_PARTS];
+static uint32_t gen_cut[GEN_MAX_PARTS];  /* peso acumulado sobre 2^32 */
+static uint64_t gen_pos[GEN_MAX_PARTS];  /* byte (seq) o página actual */
+static void *gen_table[GEN_MAX_PARTS];   /* CDF (zipf) o sucesores (chase) */
+static uint64_t gen_rng = 1U;
+
+static inline uint64_t gen_rand(void)
+{
+    gen_rng ^= gen_rng << 13;
+    gen_rng ^= gen_rng >> 7;
+    gen_rng ^= gen_rng << 17;
+    return gen_rng;
+}
+
+/* Analiza la especificación de --gen. Devuelve 0 (con mensaje) si es
+   inválida. */
+int gen_parse(const char *spec)
+{
+    char buf[256];
+    double weight[GEN_MAX_PARTS];
+    double total = 0.0, acc = 0.0;
+    char *save = NULL;
+    char *tok;
+    unsigned int k;
+
+    if (strlen(spec) >= sizeof(buf)) {
+        fprintf(stderr, "Error: --gen demasiado largo\n");
+        return 0;
+    }
+    strcpy(buf, spec);
+    gen_parts = 0U;
+    for (tok = strtok_r(buf, ",", &save); tok;
+         tok = strtok_r(NULL, ",", &save)) {
+        char *at = strchr(tok, '@');
+        char *colon = strchr(tok, ':');
+        char *end = NULL;
+        int kind;
+
+        if (gen_parts == GEN_MAX_PARTS) {
+            fprintf(stderr, "Error: --gen admite hasta %u patrones\n",
+                    GEN_MAX_PARTS);
+            return 0;
+        }
+        weight[gen_parts] = 1.0;
+        if (at) {
+            *at = '\0';
+            weight[gen_parts] = strtod(at + 1, &end);
+            if (end == at + 1 || *end != '\0' || !(weight[gen_parts] > 0.0)) {
+                fprintf(stderr, "Error: peso inválido en --gen: %s\n", at + 1);
+                return 0;
+            }
+        }
+        if (colon) *colon = '\0';
+        for (kind = 0; kind < GEN_KINDS; ++kind) {
+            if (strcmp(tok, gen_names[kind]) == 0) break;
+        }
+        if (kind == GEN_KINDS) {
+            fprintf(stderr, "Error: patrón desconocido en --gen: %s\n", tok);
+            return 0;
+        }
+        gen_kind[gen_parts] = kind;
+        gen_param[gen_parts] = gen_defaults[kind];
+        if (colon) {
+            double v = strtod(colon + 1, &end);
+            int bad = end == colon + 1 || *end != '\0';
+            if (kind == GEN_SEQ || kind == GEN_STRIDE) {
+                bad = bad || v < 1.0 || v != (double)(uint32_t)v;
+            } else if (kind == GEN_ZIPF) {
+                bad = bad || !(v >= 0.0);
+            } else {
+                bad = 1; /* uniform y chase no llevan parámetro */
+            }
+            if (bad) {
+                fprintf(stderr, "Error: parámetro inválido para %s: %s\n",
+                        gen_names[kind], colon + 1);
+                return 0;
+            }
+            gen_param[gen_parts] = v;
+        }
+        total += weight[gen_parts++];
+    }
+    if (gen_parts == 0U) {
+        fprintf(stderr, "Error: --gen vacío\n");
+        return 0;
+    }
+    for (k = 0U; k < gen_parts; ++k) {
+        acc += weight[k];
+        gen_cut[k] = k + 1U == gen_parts ? UINT32_MAX
+                     : (uint32_t)(acc / total * 4294967295.0);
+    }
+    return 1;
+}
+
+/* Prepara el estado de cada patrón: la CDF de Zipf y el ciclo de
+   chase se arman una vez con la semilla, antes del primer acceso. */
+int gen_init(void)
+{
+    unsigned int k;
+    uint32_t i;
+
+    gen_rng = policy_seed;
+    for (k = 0U; k < gen_parts; ++k) {
+        gen_pos[k] = 0U;
+        gen_table[k] = NULL;
+        if (gen_kind[k] == GEN_ZIPF) {
+            double *cdf = (double *)malloc(gen_pages * sizeof(double));
+            double sum = 0.0;
+            if (!cdf) {
+                perror("malloc zipf");
+                return 0;
+            }
+            for (i = 0U; i < gen_pages; ++i) {
+                sum += 1.0 / pow((double)(i + 1U), gen_param[k]);
+                cdf[i] = sum;
+            }
+            for (i = 0U; i < gen_pages; ++i) cdf[i] /= sum;
+            gen_table[k] = cdf;
+        } else if (gen_kind[k] == GEN_CHASE) {
+            uint32_t *next = (uint32_t *)malloc(gen_pages * sizeof(uint32_t));
+            if (!next) {
+                perror("malloc chase");
+                return 0;
+            }
+            for (i = 0U; i < gen_pages; ++i) next[i] = i;
+            /* Sattolo: j < i deja una sola órbita de largo gen_pages */
+            for (i = gen_pages - 1U; i > 0U; --i) {
+                uint32_t j = (uint32_t)(((gen_rand() >> 32) * i) >> 32);
+                uint32_t t = next[i];
+                next[i] = next[j];
+                next[j] = t;
+            }
+            gen_table[k] = next;
+        }
+    }
+    return 1;
+}
+
+void gen_free(void)
+{
+    unsigned int k;
+    for (k = 0U; k < gen_parts; ++k) {
+        free(gen_table[k]);
+        gen_table[k] = NULL;
+    }
+}
+
+/* Próxima dirección generada */
+static inline uint64_t gen_next(void)
+{
+    uint64_t r = gen_rand();
+    unsigned int k = 0U;
+    uint64_t page;
+
+    if (gen_parts > 1U) {
+        uint32_t w = (uint32_t)r;
+        while (w > gen_cut[k]) ++k;
+        r = gen_rand();
+    }
+    switch (gen_kind[k]) {
+    case GEN_SEQ: {
+        uint64_t addr = gen_pos[k];
+        gen_pos[k] += (uint64_t)gen_param[k];
+        if (gen_pos[k] >= (uint64_t)gen_pages << 12) {
+            gen_pos[k] %= (uint64_t)gen_pages << 12;
+        }
+        return addr;
+    }
+    case GEN_STRIDE:
+        page = gen_pos[k];
+        gen_pos[k] = (page + (uint64_t)gen_param[k]) % gen_pages;
+        break;
+    case GEN_UNIFORM:
+        page = ((r >> 32) * gen_pages) >> 32;
+        break;
+    case GEN_ZIPF: {
+        /* primera página con CDF >= u (búsqueda binaria) */
+        const double *cdf = (const double *)gen_table[k];
+        double u = (double)(r >> 11) * (1.0 / 9007199254740992.0);
+        uint32_t lo = 0U, hi = gen_pages - 1U;
+        while (lo < hi) {
+            uint32_t mid = lo + (hi - lo) / 2U;
+            if (cdf[mid] < u) lo = mid + 1U;
+            else hi = mid;
+        }
+        page = lo;
+        break;
+    }
+    default: /* GEN_CHASE */
+        page = gen_pos[k];
+        gen_pos[k] = ((const uint32_t *)gen_table[k])[page];
+        break;
+    }
+    return (page << 12) | (r & 0xFFFU);
+}
+
+/* Guarda gen_count direcciones en el formato decimal de entrada; si
+   report (la especificación de --gen) no es NULL informa en stderr
+   cuántas. */
+int gen_save(const char *path, const char *report)
+{
+    uint64_t i;
+    int rc = 0;
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        perror(path);
+        return EXIT_FAILURE;
+    }
+    out_buf = (char *)malloc(OUT_BUF_SIZE);
+    if (!out_buf || !gen_init()) {
+        if (!out_buf) perror("malloc salida");
+        free(out_buf);
+        out_buf = NULL;
+        gen_free();
+        close(fd);
+        return EXIT_FAILURE;
+    }
+    out_fd = fd;
+    for (i = 0U; i < gen_count; ++i) {
+        if (out_len + OUT_LINE_MAX > OUT_BUF_SIZE) out_flush();
+        out_u64(gen_next());
+        out_buf[out_len++] = '\n';
+    }
+    out_str("s\n");
+    out_flush();
+    out_fd = STDOUT_FILENO;
+    if (close(fd) != 0) {
+        perror(path);
+        rc = EXIT_FAILURE;
+    }
+    free(out_buf);
+    out_buf = NULL;
+    gen_free();
+    if (!report) return rc;
+    fprintf(stderr, "Generadas: %" PRIu64 " direcciones (%s, %u páginas,"
+            " semilla %" PRIu64 ")\n", gen_count, report, gen_pages,
+            policy_seed);
+    return rc;
+}
+
+/* Punto de entrada de --gen: simula gen_count accesos generados según
+   spec (o los guarda con --gen-out). */
+int gen_main(const char *spec, const char *out_path, int verbose)
+{
+    uint64_t i;
+
+    if (out_path) return gen_save(out_path, spec);
+    if (verbose) {
+        out_buf = (char *)malloc(OUT_BUF_SIZE);
+        if (!out_buf) {
+            perror("malloc salida");
+            return EXIT_FAILURE;
+        }
+    }
+    if (!gen_init()) {
+        gen_free();
+        free(out_buf);
+        out_buf = NULL;
+        return EXIT_FAILURE;
+    }
+    init_levels();
+    classify_init();
+    asid_init();
+    trace_engine_open(verbose);
+
+    struct timeval t0, t1;
+    gettimeofday(&t0, NULL);
+    for (i = 0U; i < gen_count; ++i) trace_step(gen_next(), verbose);
+    trace_engine_close();
+    gettimeofday(&t1, NULL);
+    double elapsed = (t1.tv_sec - t0.tv_sec) +
+        (t1.tv_usec - t0.tv_usec) / 1e6;
+    metrics_close(stat_hits, stat_misses, stat_evictions, stat_faults);
+
+    if (verbose) out_flush();
+    printf("Generador: %s (%u páginas, semilla %" PRIu64 ")\n", spec,
+           gen_pages, policy_seed);
+    print_summary(elapsed);
+
+    asid_free();
+    classify_free();
+    free_levels();
+    gen_free();
+    free(out_buf);
+    out_buf = NULL;
+    return 0;
+}
+
+/* ---------- Comparación de motores (--bench-engines) ---------- */
+
+/* Corre cada motor como proceso hijo sobre la misma traza (generada
+   con el generador de --gen) y escribe una fila CSV o JSON por
+   corrida con traducciones/s, ns por búsqueda, tasa de Hit y RSS
+   máximo (ru_maxrss del hijo), para detectar regresiones entre builds.
+   Motores:
+     traducir        este programa en modo interactivo (el mismo
+                     protocolo e informe por acceso que mt.c)
+     traducir-lotes  este programa con --trace --summary; su tiempo es
+                     el del bucle de traducción, sin cargar la traza
+     externos        --bench-engine NOMBRE=RUTA, programas con el
+                     protocolo interactivo de mt.c (dirección por línea,
+                     "s" al final, "TLB Hit"/"TLB Miss" por acceso). Su
+                     TLB es fijo, así que corren una vez por carga.
+     mt              la referencia mt.c (5 entradas, LRU, clave =
+                     dirección completa) en --mt RUTA o, sin --mt ni
+                     --bench-engine, en ./mt. Se compila aparte con
+                     gcc -std=c11 -O2 -o mt mt.c. Si --mt no es
+                     ejecutable es un error; si falta ./mt se avisa en
+                     stderr y su fila sale con reloj = ausente.
+   Los motores propios se corren para cada tamaño de --bench-sizes y
+   política de --bench-policies (opt sólo en lotes). En los motores
+   interactivos el tiempo es el del proceso completo (columna reloj =
+   proceso), E/S incluida. */
+#define BENCH_MAX_ENGINES 8U
+#define BENCH_ABSENT 2  /* engine_clock de la fila de un motor que falta */
+
+static const char *const bench_default_loads[] = {
+    "seq", "stride:16", "uniform", "zipf:0.99", "chase",
+    "zipf:0.99@3,seq@1,chase@1"
+};
+static const char *bench_engine_name[BENCH_MAX_ENGINES];
+static const char *bench_engine_path[BENCH_MAX_ENGINES];
+static unsigned int bench_engines = 0U;
+static const char *bench_mt_path = NULL;         /* --mt */
+static const char *bench_sizes = "5,64,512";     /* --bench-sizes */
+static const char *bench_policies = "lru,random,arc"; /* --bench-policies */
+static int bench_json = 0;                       /* --bench-format json */
+static unsigned int bench_rows = 0U;
+
+/* Registra un motor externo "NOMBRE=RUTA". Devuelve 0 si es inválido. */
+int bench_add_engine(char *spec)
+{
+    char *eq = strchr(spec, '=');
+    if (!eq || eq == spec || eq[1] == '\0'
+        || bench_engines == BENCH_MAX_ENGINES) {
+        return 0;
+    }
+    *eq = '\0';
+    bench_engine_name[bench_engines] = spec;
+    bench_engine_path[bench_engines++] = eq + 1;
+    return 1;
+}
+
+/* Corre args con stdin desde 'input' y cuenta en su salida los Hit y
+   Miss: por acceso en el protocolo interactivo o del resumen con
+   batch != 0 (que además deja en *engine_s el tiempo que informa).
+   Devuelve 0 si el hijo no terminó bien. */
+static int bench_spawn(char *const *args, const char *input, int batch,
+                       uint64_t *hits, uint64_t *misses, double *engine_s,
+                       double *wall_s, long *rss_kib)
+{
+    int pipefd[2];
+    int status = 0;
+    struct rusage ru;
+    char *line = NULL;
+    size_t cap = 0U;
+    ssize_t n;
+    FILE *f;
+    uint64_t t0 = mono_ns();
+    pid_t pid;
+
+    *hits = *misses = 0U;
+    *engine_s = 0.0;
+    fflush(stdout);
+    if (pipe(pipefd) != 0) {
+        perror("pipe");
+        return 0;
+    }
+    pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        close(pipefd[0]);
+        close(pipefd[1]);
+        return 0;
+    }
+    if (pid == 0) {
+        int in = open(input, O_RDONLY);
+        if (in < 0 || dup2(in, STDIN_FILENO) < 0
+            || dup2(pipefd[1], STDOUT_FILENO) < 0) {
+            _exit(127);
+        }
+        close(in);
+        close(pipefd[0]);
+        close(pipefd[1]);
+        execv(args[0], args);
+        _exit(127);
+    }
+    close(pipefd[1]);
+    f = fdopen(pipefd[0], "r");
+    if (!f) {
+        perror("fdopen");
+        close(pipefd[0]);
+        waitpid(pid, NULL, 0);
+        return 0;
+    }
+    while ((n = getline(&line, &cap, f)) > 0) {
+        const char *r;
+        if (batch) {
+            if (strncmp(line, "TLB Hit: ", 9U) == 0) {
+                *hits = strtoull(line + 9, NULL, 10);
+            } else if (strncmp(line, "TLB Miss: ", 10U) == 0) {
+                *misses = strtoull(line + 10, NULL, 10);
+            } else if (strncmp(line, "Tiempo: ", 8U) == 0) {
+                *engine_s = strtod(line + 8, NULL);
+            }
+            continue;
+        }
+        /* la pregunta no termina en '\n': el resultado del acceso
+           puede venir en la misma línea, detrás de ella */
+        r = strstr(line, "TLB ");
+        if (!r) continue;
+        if (strncmp(r, "TLB Hit", 7U) == 0) {
+            ++*hits;
+        } else if (strncmp(r, "TLB Miss", 8U) == 0) {
+            ++*misses;
+        }
+    }
+    free(line);
+    fclose(f);
+    if (wait4(pid, &status, 0, &ru) < 0) {
+        perror("wait4");
+        return 0;
+    }
+    *wall_s = (double)(mono_ns() - t0) / 1e9;
+    *rss_kib = ru.ru_maxrss;
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+/* Imprime una fila del resultado (y la cabecera antes de la primera).
+   engine_clock indica si secs es el tiempo que informa el motor o el
+   del proceso completo (BENCH_ABSENT: el motor no existe). */
+static void bench_row(const char *engine, const char *load,
+                      const char *entries, const char *policy,
+                      uint64_t hits, uint64_t misses, double secs,
+                      long rss_kib, int engine_clock)
+{
+    uint64_t n = hits + misses;
+    double rate = n ? (double)hits * 100.0 / (double)n : 0.0;
+    double tps = secs > 0.0 ? (double)n / secs : 0.0;
+    double ns = n ? secs * 1e9 / (double)n : 0.0;
+    const char *clock = engine_clock == BENCH_ABSENT ? "ausente"
+                        : engine_clock ? "motor" : "proceso";
+
+    if (bench_json) {
+        printf("%s  {\"motor\": \"%s\", \"carga\": \"%s\", \"entradas\": "
+               "\"%s\", \"politica\": \"%s\", \"accesos\": %" PRIu64 ", "
+               "\"aciertos\": %" PRIu64 ", \"tasa_acierto\": %.4f, "
+               "\"tiempo_s\": %.6f, \"traducciones_s\": %.0f, "
+               "\"ns_por_busqueda\": %.1f, \"rss_max_kib\": %ld, "
+               "\"reloj\": \"%s\"}", bench_rows ? ",\n" : "[\n", engine,
+               load, entries, policy, n, hits, rate, secs, tps, ns, rss_kib,
+               clock);
+    } else {
+        if (bench_rows == 0U) {
+            printf("motor,carga,entradas,politica,accesos,aciertos,"
+                   "tasa_acierto,tiempo_s,traducciones_s,ns_por_busqueda,"
+                   "rss_max_kib,reloj\n");
+        }
+        /* la carga puede llevar comas: va siempre entre comillas */
+        printf("%s,\"%s\",%s,%s,%" PRIu64 ",%" PRIu64 ",%.4f,%.6f,%.0f,"
+               "%.1f,%ld,%s\n", engine, load, entries, policy, n, hits,
+               rate, secs, tps, ns, rss_kib, clock);
+    }
+    fflush(stdout);
+    ++bench_rows;
+}
+
+/* Corre un motor y agrega su fila; devuelve 0 si falló. */
+static int bench_run(const char *engine, char *const *args,
+                     const char *input, const char *load,
+                     const char *entries, const char *policy, int batch)
+{
+    uint64_t hits, misses;
+    double engine_s, wall_s;
+    long rss_kib = 0L;
+
+    if (!bench_spawn(args, input, batch, &hits, &misses, &engine_s,
+                     &wall_s, &rss_kib)) {
+        fprintf(stderr, "Error: el motor %s falló (carga %s)\n", engine,
+                load);
+        return 0;
+    }
+    bench_row(engine, load, entries, policy, hits, misses,
+              batch ? engine_s : wall_s, rss_kib, batch);
+    return 1;
+}
+
+/* Punto de entrada de --bench-engines: la matriz motores x cargas x
+   tamaños x políticas sobre trazas de gen_count accesos. */
+int bench_engines_main(void)
+{
+    char self[PATH_MAX];
+    char trace[] = "/tmp/traducir-bench-XXXXXX";
+    char sizes[256], policies[256], seed[24];
+    const char *loads[GEN_MAX_PARTS];
+    char *save = NULL, *ps = NULL;
+    char *tok, *pol;
+    unsigned int nloads = 0U, l, e;
+    ssize_t len;
+    int mt_absent = 0;
+    int rc = 0;
+    int fd;
+
+    len = readlink("/proc/self/exe", self, sizeof(self) - 1U);
+    if (len <= 0) {
+        perror("/proc/self/exe");
+        return EXIT_FAILURE;
+    }
+    self[len] = '\0';
+    if (strlen(bench_sizes) >= sizeof(sizes)
+        || strlen(bench_policies) >= sizeof(policies)) {
+        fprintf(stderr, "Error: --bench-sizes o --bench-policies demasiado"
+                " largo\n");
+        return EXIT_FAILURE;
+    }
+    /* valida las listas antes de gastar tiempo en la matriz */
+    strcpy(sizes, bench_sizes);
+    for (tok = strtok_r(sizes, ",", &save); tok;
+         tok = strtok_r(NULL, ",", &save)) {
+        char *end = NULL;
+        unsigned long n = strtoul(tok, &end, 10);
+        if (end == tok || *end != '\0' || n == 0UL
+            || n > TLB_ENTRIES_LIMIT) {
+            fprintf(stderr, "Error: tamaño inválido en --bench-sizes: %s\n",
+                    tok);
+            return EXIT_FAILURE;
+        }
+    }
+    strcpy(policies, bench_policies);
+    for (tok = strtok_r(policies, ",", &save); tok;
+         tok = strtok_r(NULL, ",", &save)) {
+        int p;
+        for (p = 0; p < POL_COUNT; ++p) {
+            if (strcmp(tok, tlb_policy_names[p]) == 0) break;
+        }
+        if (p == POL_COUNT) {
+            fprintf(stderr, "Error: política desconocida en"
+                    " --bench-policies: %s\n", tok);
+            return EXIT_FAILURE;
+        }
+    }
+    if (bench_mt_path && access(bench_mt_path, X_OK) != 0) {
+        fprintf(stderr, "Error: --mt %s no es ejecutable (compile con"
+                " gcc -std=c11 -O2 -o mt mt.c)\n", bench_mt_path);
+        return EXIT_FAILURE;
+    }
+    if (bench_mt_path || (bench_engines == 0U && access("./mt", X_OK) == 0)) {
+        if (bench_engines == BENCH_MAX_ENGINES) {
+            fprintf(stderr, "Error: demasiados motores (hasta %u)\n",
+                    BENCH_MAX_ENGINES);
+            return EXIT_FAILURE;
+        }
+        bench_engine_name[bench_engines] = "mt";
+        bench_engine_path[bench_engines++] =
+            bench_mt_path ? bench_mt_path : "./mt";
+    } else if (bench_engines == 0U) {
+        mt_absent = 1;
+        fprintf(stderr, "Aviso: no existe ./mt; compile la referencia con"
+                " gcc -std=c11 -O2 -o mt mt.c o indique --mt RUTA\n");
+    }
+    if (gen_spec) {
+        loads[nloads++] = gen_spec;
+    } else {
+        for (l = 0U; l < sizeof(bench_default_loads)
+                         / sizeof(bench_default_loads[0]); ++l) {
+            loads[nloads++] = bench_default_loads[l];
+        }
+    }
+    snprintf(seed, sizeof(seed), "%" PRIu64, policy_seed);
+
+    fd = mkstemp(trace);
+    if (fd < 0) {
+        perror("mkstemp");
+        return EXIT_FAILURE;
+    }
+    close(fd);
+    for (l = 0U; l < nloads; ++l) {
+        if (!gen_parse(loads[l]) || gen_save(trace, NULL) != 0) {
+            rc = EXIT_FAILURE;
+            break;
+        }
+        if (mt_absent) bench_row("mt", loads[l], "", "", 0U, 0U, 0.0, 0L,
+                                 BENCH_ABSENT);
+        for (e = 0U; e < bench_engines; ++e) {
+            char *args[] = { (char *)bench_engine_path[e], NULL };
+            if (!bench_run(bench_engine_name[e], args, trace, loads[l],
+                           "", "", 0)) {
+                rc = EXIT_FAILURE;
+            }
+        }
+        strcpy(sizes, bench_sizes);
+        for (tok = strtok_r(sizes, ",", &save); tok;
+             tok = strtok_r(NULL, ",", &save)) {
+            strcpy(policies, bench_policies);
+            for (pol = strtok_r(policies, ",", &ps); pol;
+                 pol = strtok_r(NULL, ",", &ps)) {
+                char *inter[] = { self, "--entries", tok, "--policy", pol,
+                                  "--seed", seed, NULL };
+                char *batch[] = { self, "--trace", trace, "--summary",
+                                  "--entries", tok, "--policy", pol,
+                                  "--seed", seed, NULL };
+                /* opt necesita la traza completa: sólo en lotes */
+                if (strcmp(pol, "opt") != 0
+                    && !bench_run("traducir", inter, trace, loads[l], tok,
+                                  pol, 0)) {
+                    rc = EXIT_FAILURE;
+                }
+                if (!bench_run("traducir-lotes", batch, trace, loads[l],
+                               tok, pol, 1)) {
+                    rc = EXIT_FAILURE;
+                }
+            }
+        }
+    }
+    unlink(trace);
+    if (bench_json && bench_rows) printf("\n]\n");
+    else if (bench_json) printf("[]\n");
+    return rc;
+}
+
+/* ---------- Simulación multinúcleo con shootdowns (--cores) ---------- */
+
+/* Cada núcleo simulado corre en su propio hilo con un TLB L1 privado
+   (su propio bloque de tlb_create) y un bloque de control alineado a
+   la línea de caché. Un evento de unmap invalida la página en el
+   núcleo que lo emite y la difunde (shootdown) a los demás por colas
+   de invalidación sin candados: un anillo de Vyukov por núcleo en el
+   que encolan todos y desencola sólo el dueño. El emisor espera las
+   confirmaciones como en un shootdown real.
+
+   El resultado no depende del entrelazado de los hilos: cada unmap
+   tiene un turno (su orden entre los unmaps de la traza) y se difunde
+   sólo cuando se difundieron todos los anteriores, así que cada anillo
+   recibe las invalidaciones en el orden de la traza. Antes de cada
+   acceso un núcleo atiende exactamente las invalidaciones de los unmaps
+   que lo preceden en la traza (esperándolas si aún no llegaron) y
+   ninguna posterior, como si la traza se ejecutara en serie.
+
+   Formato de la traza decimal: "ADDR" (acceso), "uADDR" (unmap de la
+   página de ADDR) y, opcionalmente, el prefijo "C:" con el núcleo que
+   la ejecuta. Sin prefijo (y en trazas binarias) las líneas se
+   reparten entre los núcleos por turnos. El núcleo C se simula en
+   C mod N. */
+#define MC_MAX_CORES 256U
+
+/* Bloque de control de cada núcleo; cada grupo de campos en su línea
+   de caché para que los productores no invaliden los contadores del
+   dueño. */
+#define CORE_TLB        0U    /* char* del TLB privado */
+#define CORE_HITS       8U
+#define CORE_MISSES     16U
+#define CORE_EVICTIONS  24U
+#define CORE_SD_SENT    32U   /* shootdowns iniciados */
+#define CORE_SD_RECV    40U   /* invalidaciones remotas atendidas */
+#define CORE_SD_INVAL   48U   /* ... que encontraron la página */
+#define CORE_CYCLES     56U   /* ciclos simulados del núcleo */
+#define CORE_SD_CYCLES  64U   /* parte de ellos en shootdowns */
+#define CORE_WAIT_NS    72U   /* tiempo real esperando confirmaciones */
+#define CORE_Q_HEAD     80U   /* sólo lo mueve el dueño */
+#define CORE_Q_TAIL     128U  /* línea de los productores */
+#define CORE_PENDING    192U  /* confirmaciones que le faltan al emisor */
+#define CORE_Q_CELLS    256U  /* anillo de celdas */
+
+/* Celda del anillo: secuencia (protocolo de Vyukov), página y emisor */
+#define CELL_SEQ   0U
+#define CELL_PAGE  8U
+#define CELL_FROM  12U
+#define CELL_SIZE  16U
+
+#define CELL_AT(c, pos) \
+    ((c) + CORE_Q_CELLS + (size_t)((pos) & mc_qmask) * CELL_SIZE)
+
+static unsigned int mc_cores = 0U;
+static char *mc_core[MC_MAX_CORES];
+static uint64_t mc_qmask = 0U;         /* capacidad del anillo - 1 */
+static uint64_t mc_ticket = 0U;        /* unmaps ya difundidos (atómico) */
+static unsigned int lat_sd_init = 4000U;   /* ciclos del emisor */
+static unsigned int lat_sd_target = 1000U; /* ciclos de cada receptor */
+
+/* Flujo de cada núcleo: direcciones y, aparte, sus unmaps como pares
+   (posición << 32 | dirección, turno) en orden. mc_sync guarda
+   (posición << 32 | unmaps de la traza anteriores al acceso) cada vez
+   que ese número cambia entre dos accesos del núcleo. */
+static uint32_t *mc_addrs[MC_MAX_CORES];
+static uint64_t mc_len[MC_MAX_CORES];
+static uint64_t mc_cap[MC_MAX_CORES];
+static uint64_t *mc_unmaps[MC_MAX_CORES];
+static uint64_t mc_nunmaps[MC_MAX_CORES];
+static uint64_t mc_unmap_cap[MC_MAX_CORES];
+static uint64_t *mc_sync[MC_MAX_CORES];
+static uint64_t mc_nsync[MC_MAX_CORES];
+static uint64_t mc_sync_cap[MC_MAX_CORES];
+static uint64_t mc_sync_last[MC_MAX_CORES];
+static uint64_t mc_unmap_total = 0U;   /* unmaps de toda la traza */
+static uint64_t mc_rr = 0U;            /* turno de las líneas sin prefijo */
+static uint64_t mc_faults = 0U;
+
+static void mc_push(uint64_t **arr, uint64_t *len, uint64_t *cap,
+                    uint64_t v)
+{
+    if (*len == *cap) {
+        uint64_t n = *cap ? *cap * 2U : 1024U;
+        uint64_t *grown = (uint64_t *)realloc(*arr, (size_t)n * 8U);
+        if (!grown) {
+            perror("malloc núcleos");
+            exit(EXIT_FAILURE);
+        }
+        *arr = grown;
+        *cap = n;
+    }
+    (*arr)[(*len)++] = v;
+}
+
+/* Agrega un evento al flujo del núcleo 'core' */
+static void mc_add(unsigned int core, uint32_t vaddr, int unmap)
+{
+    if (unmap) {
+        if (mc_unmap_total == UINT32_MAX) {
+            fprintf(stderr, "Error: demasiados unmaps en la traza\n");
+            exit(EXIT_FAILURE);
+        }
+        mc_push(&mc_unmaps[core], &mc_nunmaps[core], &mc_unmap_cap[core],
+                (mc_len[core] << 32) | vaddr);
+        mc_push(&mc_unmaps[core], &mc_nunmaps[core], &mc_unmap_cap[core],
+                mc_unmap_total++);
+        return;
+    }
+    if (mc_sync_last[core] != mc_unmap_total) {
+        mc_push(&mc_sync[core], &mc_nsync[core], &mc_sync_cap[core],
+                (mc_len[core] << 32) | mc_unmap_total);
+        mc_sync_last[core] = mc_unmap_total;
+    }
+    if (mc_len[core] == mc_cap[core]) {
+        uint64_t n = mc_cap[core] ? mc_cap[core] * 2U : 4096U;
+        uint32_t *grown;
+        if (n > UINT32_MAX) {
+            fprintf(stderr, "Error: demasiados accesos por núcleo\n");
+            exit(EXIT_FAILURE);
+        }
+        grown = (uint32_t *)realloc(mc_addrs[core], (size_t)n * 4U);
+        if (!grown) {
+            perror("malloc núcleos");
+            exit(EXIT_FAILURE);
+        }
+        mc_addrs[core] = grown;
+        mc_cap[core] = n;
+    }
+    mc_addrs[core][mc_len[core]++] = vaddr;
+}
+
+static void mc_add_rr(uint64_t vaddr)
+{
+    mc_add((unsigned int)(mc_rr++ % mc_cores), (uint32_t)vaddr, 0);
+}
+
+/* Reparte la traza entre los flujos de los núcleos (fuera del tiempo
+   medido). */
+void mc_load(char *data, size_t len, int binary)
+{
+    unsigned int c;
+    for (c = 0U; c < mc_cores; ++c) {
+        mc_len[c] = mc_nunmaps[c] = mc_nsync[c] = mc_sync_last[c] = 0U;
+    }
+    mc_unmap_total = 0U;
+    mc_rr = 0U;
+    mc_faults = 0U;
+    if (binary) {
+        trace_for_each(data, len, binary, mc_add_rr);
+        return;
+    }
+    char *p = data;
+    const char *end = data + len;
+    while (p < end) {
+        const char *line = p;
+        while (p < end && *p != '\n') ++p;
+        const char *stop = p > line && p[-1] == '\r' ? p - 1 : p;
+        const char *q = line;
+        uint64_t v = 0U;
+        uint64_t core = UINT64_MAX;
+        int unmap = 0;
+        int digits = 0;
+        ++p;
+        if (stop == line) continue;
+        if (stop - line == 1 && *line == 's') break;
+        for (; q < stop && *q >= '0' && *q <= '9'; ++q) {
+            v = v * 10U + (uint64_t)(*q - '0');
+            if (v > UINT32_MAX) break;
+            ++digits;
+        }
+        if (q < stop && *q == ':' && digits > 0) {
+            core = v;
+            v = 0U;
+            digits = 0;
+            ++q;
+        }
+        if (q < stop && *q == 'u') {
+            unmap = 1;
+            ++q;
+        }
+        for (; q < stop && *q >= '0' && *q <= '9' && v <= UINT32_MAX; ++q) {
+            v = v * 10U + (uint64_t)(*q - '0');
+            ++digits;
+        }
+        if (q != stop || digits == 0 || v > UINT32_MAX) {
+            ++mc_faults;
+            continue;
+        }
+        if (core == UINT64_MAX) core = mc_rr++;
+        mc_add((unsigned int)(core % mc_cores), (uint32_t)v, unmap);
+    }
+}
+
+/* Encola la invalidación de 'page' en la cola del núcleo 'to'. La
+   capacidad del anillo es >= núcleos y cada emisor tiene a lo sumo un
+   shootdown pendiente, así que nunca está lleno. Los unmaps se difunden
+   por turnos, por lo que las celdas quedan en el orden de la traza.
+   Usa ≤3 punteros: core, cell. */
+static void mc_enqueue(unsigned int to, uint32_t page, unsigned int from)
+{
+    char *core = mc_core[to];
+    char *cell;
+    uint64_t pos = __atomic_load_n((uint64_t *)(core + CORE_Q_TAIL),
+                                   __ATOMIC_RELAXED);
+    for (;;) {
+        cell = CELL_AT(core, pos);
+        uint64_t seq = __atomic_load_n((uint64_t *)(cell + CELL_SEQ),
+                                       __ATOMIC_ACQUIRE);
+        if (seq == pos) {
+            if (__atomic_compare_exchange_n((uint64_t *)(core + CORE_Q_TAIL),
+                                            &pos, pos + 1U, 1,
+                                            __ATOMIC_RELAXED,
+                                            __ATOMIC_RELAXED)) break;
+        } else {
+            pos = __atomic_load_n((uint64_t *)(core + CORE_Q_TAIL),
+                                  __ATOMIC_RELAXED);
+        }
+    }
+    FIELD32(cell, CELL_PAGE) = page;
+    FIELD32(cell, CELL_FROM) = from;
+    __atomic_store_n((uint64_t *)(cell + CELL_SEQ), pos + 1U,
+                     __ATOMIC_RELEASE);
+}
+
+/* Atiende la invalidación más antigua de la cola del núcleo, si ya
+   llegó: la invalida en su TLB y confirma al emisor. Devuelve 1 si
+   atendió una.
+   Usa ≤3 punteros: core, tlb, cell. */
+static int mc_drain_one(char *core)
+{
+    char *tlb = *((char **)(core + CORE_TLB));
+    char *cell;
+    uint64_t pos = FIELD64(core, CORE_Q_HEAD);
+
+    cell = CELL_AT(core, pos);
+    if (__atomic_load_n((uint64_t *)(cell + CELL_SEQ), __ATOMIC_ACQUIRE)
+        != pos + 1U) return 0;
+    uint32_t page = FIELD32(cell, CELL_PAGE);
+    unsigned int from = FIELD32(cell, CELL_FROM);
+    __atomic_store_n((uint64_t *)(cell + CELL_SEQ), pos + mc_qmask + 1U,
+                     __ATOMIC_RELEASE);
+    FIELD64(core, CORE_Q_HEAD) = pos + 1U;
+    cell = tlb_find(tlb, page);
+    if (cell) {
+        tlb_invalidate(tlb, cell);
+        ++FIELD64(core, CORE_SD_INVAL);
+    }
+    ++FIELD64(core, CORE_SD_RECV);
+    FIELD64(core, CORE_CYCLES) += lat_sd_target;
+    FIELD64(core, CORE_SD_CYCLES) += lat_sd_target;
+    __atomic_fetch_sub((uint32_t *)(mc_core[from] + CORE_PENDING), 1U,
+                       __ATOMIC_RELEASE);
+    return 1;
+}
+
+/* Lleva al núcleo hasta el turno 'target': atiende, en orden, las
+   invalidaciones de los unmaps ajenos con turno < target, esperando
+   las que todavía no llegaron. *done cuenta los turnos ya atendidos
+   (propios o ajenos); los propios anteriores ya están contados porque
+   el flujo del núcleo está en el orden de la traza.
+   Usa ≤3 punteros: core, done. */
+static void mc_catch_up(char *core, uint64_t *done, uint64_t target)
+{
+    while (*done < target) {
+        if (mc_drain_one(core)) ++*done;
+        else sched_yield();
+    }
+}
+
+/* Unmap con turno 'ticket' emitido por el núcleo id: invalidación local
+   y, cuando todos los unmaps anteriores ya se difundieron, shootdown al
+   resto esperando las confirmaciones. El emisor no atiende su cola
+   mientras espera: lo que llegue es posterior en la traza a sus
+   próximos accesos. No hay bloqueo mutuo porque un receptor confirma
+   este turno antes de poder emitir uno posterior.
+   Usa ≤3 punteros: core, tlb, slot. */
+static void mc_unmap(unsigned int id, uint32_t page, uint64_t ticket)
+{
+    char *core = mc_core[id];
+    char *tlb = *((char **)(core + CORE_TLB));
+    char *slot = tlb_find(tlb, page);
+    unsigned int c;
+
+    if (slot) tlb_invalidate(tlb, slot);
+    ++FIELD64(core, CORE_SD_SENT);
+    FIELD64(core, CORE_CYCLES) += lat_sd_init;
+    FIELD64(core, CORE_SD_CYCLES) += lat_sd_init;
+    if (mc_cores == 1U) return;
+
+    while (__atomic_load_n(&mc_ticket, __ATOMIC_ACQUIRE) != ticket) {
+        sched_yield();
+    }
+    __atomic_store_n((uint32_t *)(core + CORE_PENDING), mc_cores - 1U,
+                     __ATOMIC_RELAXED);
+    for (c = 0U; c < mc_cores; ++c) {
+        if (c != id) mc_enqueue(c, page, id);
+    }
+    __atomic_store_n(&mc_ticket, ticket + 1U, __ATOMIC_RELEASE);
+    uint64_t t0 = mono_ns();
+    while (__atomic_load_n((uint32_t *)(core + CORE_PENDING),
+                           __ATOMIC_ACQUIRE) != 0U) {
+        sched_yield();
+    }
+    FIELD64(core, CORE_WAIT_NS) += mono_ns() - t0;
+}
+
+/* Hilo de un núcleo: recorre su flujo y, antes de cada unmap propio o
+   de cada acceso tras el que cambia el número de unmaps previos de la
+   traza, se pone al día con su cola de invalidaciones. Al terminar
+   atiende las que faltan hasta el último turno, porque otro núcleo
+   puede estar esperando su confirmación.
+   Usa ≤3 punteros: core, tlb, slot. */
+static void *mc_core_main(void *arg)
+{
+    unsigned int id = (unsigned int)(uintptr_t)arg;
+    char *core = mc_core[id];
+    char *tlb = *((char **)(core + CORE_TLB));
+    char *slot;
+    const uint32_t *addrs = mc_addrs[id];
+    uint64_t n = mc_len[id];
+    uint64_t next_unmap = 0U;
+    uint64_t next_sync = 0U;
+    uint64_t done = 0U;
+    uint64_t u = 0U;
+    uint64_t y = 0U;
+    uint64_t i;
+    char zeros[PAGE_BIN_SIZE] = {0};
+
+    next_unmap = mc_nunmaps[id] ? mc_unmaps[id][0] >> 32 : UINT64_MAX;
+    next_sync = mc_nsync[id] ? mc_sync[id][0] >> 32 : UINT64_MAX;
+    for (i = 0U; i <= n; ++i) {
+        while (i == next_unmap) {
+            uint64_t ticket = mc_unmaps[id][u + 1U];
+            mc_catch_up(core, &done, ticket);
+            mc_unmap(id, page_tag((uint32_t)mc_unmaps[id][u]), ticket);
+            done = ticket + 1U;
+            u += 2U;
+            next_unmap = u < mc_nunmaps[id] ? mc_unmaps[id][u] >> 32
+                                            : UINT64_MAX;
+        }
+        if (i == n) break;
+        if (i == next_sync) {
+            mc_catch_up(core, &done, mc_sync[id][y] & UINT32_MAX);
+            ++y;
+            next_sync = y < mc_nsync[id] ? mc_sync[id][y] >> 32
+                                         : UINT64_MAX;
+        }
+        uint32_t page = page_tag(addrs[i]);
+        slot = tlb_find(tlb, page);
+        if (slot) {
+            tlb_update_lru(tlb, slot);
+            ++FIELD64(core, CORE_HITS);
+            FIELD64(core, CORE_CYCLES) += lat_l1;
+        } else {
+            if (tlb_insert(tlb, page, addrs[i] & 0xFFFU, zeros, zeros, NULL)
+                != (uintptr_t)0) {
+                ++FIELD64(core, CORE_EVICTIONS);
+            }
+            ++FIELD64(core, CORE_MISSES);
+            FIELD64(core, CORE_CYCLES) += lat_l1 + lat_walk;
+        }
+    }
+    if (mc_cores > 1U) mc_catch_up(core, &done, mc_unmap_total);
+    return NULL;
+}
+
+/* Crea los núcleos, corre un hilo por núcleo y devuelve el tiempo real
+   de la simulación. */
+double mc_run(void)
+{
+    pthread_t threads[MC_MAX_CORES];
+    unsigned int qcap = 2U;
+    unsigned int c;
+    struct timeval t0, t1;
+
+    while (qcap < mc_cores) qcap <<= 1;
+    mc_qmask = qcap - 1U;
+    for (c = 0U; c < mc_cores; ++c) {
+        size_t bytes = CORE_Q_CELLS + (size_t)qcap * CELL_SIZE;
+        uint64_t k;
+        mc_core[c] = (char *)aligned_alloc(64U, (bytes + 63U) & ~(size_t)63U);
+        if (!mc_core[c]) {
+            perror("malloc núcleos");
+            exit(EXIT_FAILURE);
+        }
+        memset(mc_core[c], 0, CORE_Q_CELLS);
+        for (k = 0U; k < qcap; ++k) {
+            FIELD64(CELL_AT(mc_core[c], k), CELL_SEQ) = k;
+        }
+        *((char **)(mc_core[c] + CORE_TLB)) =
+            tlb_create(tlb_sets, tlb_entries / tlb_sets, tlb_index_fn,
+                       tlb_layout, tlb_policy);
+        /* secuencia aleatoria distinta (y reproducible) en cada núcleo */
+        tlb_seed(*((char **)(mc_core[c] + CORE_TLB)),
+                 policy_seed ^ ((uint64_t)(c + 1U) * 0xD1B54A32D192ED03ULL));
+    }
+    mc_ticket = 0U;
+
+    gettimeofday(&t0, NULL);
+    for (c = 0U; c < mc_cores; ++c) {
+        if (pthread_create(&threads[c], NULL, mc_core_main,
+                           (void *)(uintptr_t)c) != 0) {
+            perror("pthread_create");
+            exit(EXIT_FAILURE);
+        }
+    }
+    for (c = 0U; c < mc_cores; ++c) pthread_join(threads[c], NULL);
+    gettimeofday(&t1, NULL);
+    return (t1.tv_sec - t0.tv_sec) + (t1.tv_usec - t0.tv_usec) / 1e6;
+}
+
+void mc_free(void)
+{
+    unsigned int c;
+    for (c = 0U; c < mc_cores; ++c) {
+        tlb_destroy(*((char **)(mc_core[c] + CORE_TLB)));
+        free(mc_core[c]);
+        mc_core[c] = NULL;
+    }
+}
+
+/* Suma el campo 'off' de todos los núcleos */
+static uint64_t mc_sum(unsigned int off)
+{
+    uint64_t total = 0U;
+    unsigned int c;
+    for (c = 0U; c < mc_cores; ++c) total += FIELD64(mc_core[c], off);
+    return total;
+}
+
+/* Resumen de una ejecución multinúcleo */
+void mc_print_summary(double elapsed)
+{
+    uint64_t hits = mc_sum(CORE_HITS);
+    uint64_t translated = hits + mc_sum(CORE_MISSES);
+    uint64_t cycles = mc_sum(CORE_CYCLES);
+    uint64_t sd_cycles = mc_sum(CORE_SD_CYCLES);
+    unsigned int c;
+
+    printf("Núcleos: %u (TLB privado: %u entradas, %u conjuntos x %u vías,"
+           " %s)\n", mc_cores, tlb_entries, tlb_sets,
+           tlb_entries / tlb_sets,
+           lru_mode == LRU_SCAN ? "lru-scan" : tlb_policy_names[tlb_policy]);
+    printf("Accesos: %" PRIu64 "\n", translated + mc_faults);
+    printf("TLB Hit: %" PRIu64 " (%.2f%%)\n", hits,
+           translated ? 100.0 * (double)hits / (double)translated : 0.0);
+    printf("TLB Miss: %" PRIu64 "\n", translated - hits);
+    printf("Reemplazos: %" PRIu64 "\n", mc_sum(CORE_EVICTIONS));
+    printf("Shootdowns: %" PRIu64 " (IPIs: %" PRIu64
+           ", entradas invalidadas: %" PRIu64 ")\n",
+           mc_sum(CORE_SD_SENT), mc_sum(CORE_SD_RECV),
+           mc_sum(CORE_SD_INVAL));
+    printf("  Ciclos en shootdowns: %" PRIu64 " (%.2f%% del total;"
+           " emisor=%u, receptor=%u)\n", sd_cycles,
+           cycles ? 100.0 * (double)sd_cycles / (double)cycles : 0.0,
+           lat_sd_init, lat_sd_target);
+    printf("  Espera por confirmaciones: %.6f segundos\n",
+           (double)mc_sum(CORE_WAIT_NS) / 1e9);
+    printf("Ciclos simulados: %" PRIu64 " (L1=%u, walk=%u)\n",
+           cycles, lat_l1, lat_walk);
+    printf("Page Fault: %" PRIu64 "\n", mc_faults);
+    for (c = 0U; c < mc_cores; ++c) {
+        char *core = mc_core[c];
+        uint64_t n = FIELD64(core, CORE_HITS) + FIELD64(core, CORE_MISSES);
+        printf("  Núcleo %u: %" PRIu64 " traducciones, Hit %.2f%%,"
+               " shootdowns %" PRIu64 " enviados / %" PRIu64 " recibidos\n",
+               c, n, n ? 100.0 * (double)FIELD64(core, CORE_HITS)
+                         / (double)n : 0.0,
+               FIELD64(core, CORE_SD_SENT), FIELD64(core, CORE_SD_RECV));
+    }
+    printf("Tiempo: %.6f segundos\n", elapsed);
+    printf("Traducciones/s: %.0f\n",
+           elapsed > 0.0 ? (double)translated / elapsed : 0.0);
+}
+
+/* Punto de entrada de --cores. Con una lista ("1,2,4,8") corre la traza
+   con cada número de núcleos e imprime la escalabilidad en CSV. */
+int mc_main(const char *path, const char *cores_list)
+{
+    size_t len = 0U;
+    int mapped = 0;
+    char *data = map_file(path, &len, &mapped);
+    const char *p = cores_list;
+    double base = 0.0;
+    int sweep = strchr(cores_list, ',') != NULL;
+    unsigned int c;
+
+    if (!data) return EXIT_FAILURE;
+    uint64_t count = 0U;
+    unsigned int flags = 0U;
+    int binary = trace_bin_header(data, len, path, &count, &flags);
+    if (binary < 0) {
+        unmap_file(data, len, mapped);
+        return EXIT_FAILURE;
+    }
+    if (sweep) {
+        printf("nucleos,traducciones_s,aceleracion,hit_pct,shootdowns\n");
+    }
+    while (*p) {
+        char *endp;
+        unsigned long n = strtoul(p, &endp, 10);
+        if (endp == p || n == 0UL || n > MC_MAX_CORES) {
+            fprintf(stderr, "Error: --cores espera N o N1,N2,... en [1, %u]\n",
+                    MC_MAX_CORES);
+            unmap_file(data, len, mapped);
+            return EXIT_FAILURE;
+        }
+        p = *endp == ',' ? endp + 1 : endp;
+        mc_cores = (unsigned int)n;
+        mc_load(data, len, binary);
+        double elapsed = mc_run();
+        if (sweep) {
+            uint64_t hits = mc_sum(CORE_HITS);
+            uint64_t translated = hits + mc_sum(CORE_MISSES);
+            double rate = elapsed > 0.0 ? (double)translated / elapsed : 0.0;
+            if (base == 0.0) base = rate;
+            printf("%u,%.0f,%.2f,%.2f,%" PRIu64 "\n", mc_cores, rate,
+                   base > 0.0 ? rate / base : 0.0,
+                   translated ? 100.0 * (double)hits / (double)translated
+                              : 0.0,
+                   mc_sum(CORE_SD_SENT));
+        } else {
+            mc_print_summary(elapsed);
+        }
+        mc_free();
+    }
+    for (c = 0U; c < MC_MAX_CORES; ++c) {
+        free(mc_addrs[c]);
+        free(mc_unmaps[c]);
+        free(mc_sync[c]);
+        mc_addrs[c] = NULL;
+        mc_unmaps[c] = NULL;
+        mc_sync[c] = NULL;
+        mc_cap[c] = mc_unmap_cap[c] = mc_sync_cap[c] = 0U;
+    }
+    unmap_file(data, len, mapped);
+    return 0;
+}
+
+/* ---------- Réplica paralela por trozos (--parallel) ---------- */
+
+/* La traza se parte en trozos de shard_chunk accesos que se simulan
+   en paralelo, cada uno con un TLB propio. Con LRU el estado de un
+   conjunto sólo depende de las últimas 'vías' páginas distintas que lo
+   tocaron, así que antes de cada trozo se retrocede hasta que todos
+   los conjuntos vieron tantas páginas distintas como vías (o hasta el
+   inicio de la traza) y ese tramo se simula sin contar. A partir de
+   ahí cada Hit, Miss y reemplazo coincide con la ejecución secuencial
+   y los contadores se suman. Los trozos se reparten en rangos
+   contiguos entre los hilos; el que se queda sin trabajo roba el
+   último trozo del rango más largo (robo de trabajo sin candados). */
+#define SHARD_MAX_THREADS 256U
+
+/* Bloque de cada hilo (alineado a 64; el rango en su propia línea) */
+#define W_TLB     0U    /* char* TLB del trozo actual */
+#define W_HITS    8U
+#define W_MISSES  16U
+#define W_EVICT   24U
+#define W_WARM    32U   /* accesos de calentamiento simulados */
+#define W_CHUNKS  40U   /* trozos procesados */
+#define W_STEALS  48U   /* trozos robados */
+#define W_RANGE   64U   /* [lo, hi) de trozos: lo | hi << 32 (atómico) */
+#define W_SEEN    128U  /* uint32_t* tabla de páginas vistas */
+#define W_SETCNT  136U  /* uint16_t* páginas distintas por conjunto */
+#define W_LAT     192U  /* estadísticas de latencia (LAT_WORDS) */
+#define W_SIZE    (W_LAT + LAT_WORDS * 8U)
+
+static unsigned int shard_threads = 0U;    /* 0 = sin réplica paralela */
+static uint64_t shard_chunk = 1U << 20;   /* accesos por trozo */
+static char *shard_worker[SHARD_MAX_THREADS];
+static const uint32_t *shard_addrs = NULL;
+static uint64_t shard_len = 0U;
+static uint64_t shard_cap = 0U;
+static uint32_t *shard_owned = NULL;      /* copia decodificada (texto/delta) */
+static unsigned int shard_seen_bits = 0U;
+static unsigned int shard_done = 0U;      /* hilos que terminaron (atómico) */
+
+static void shard_collect(uint64_t vaddr)
+{
+    if (shard_len == shard_cap) {
+        uint64_t cap = shard_cap ? shard_cap * 2U : 1U << 20;
+        uint32_t *grown = (uint32_t *)realloc(shard_owned,
+                                              (size_t)cap * sizeof(uint32_t));
+        if (!grown) {
+            perror("malloc traza");
+            exit(EXIT_FAILURE);
+        }
+        shard_owned = grown;
+        shard_cap = cap;
+    }
+    shard_owned[shard_len++] = (uint32_t)vaddr;
+}
+
+/* Primer acceso del calentamiento del trozo que empieza en 'start'.
+   Usa ≤3 punteros: w, tlb. */
+static uint64_t shard_warm_start(char *w, char *tlb, uint64_t start)
+{
+    uint32_t *seen = *((uint32_t **)(w + W_SEEN));
+    uint16_t *setcnt = *((uint16_t **)(w + W_SETCNT));
+    unsigned int ways = FIELD32(tlb, H_WAYS);
+    unsigned int open = FIELD32(tlb, H_SETS); /* conjuntos sin llenar */
+    uint32_t mask = (1U << shard_seen_bits) - 1U;
+    uint64_t i = start;
+
+    memset(seen, 0xFF, ((size_t)1U << shard_seen_bits) * sizeof(uint32_t));
+    memset(setcnt, 0, (size_t)FIELD32(tlb, H_SETS) * sizeof(uint16_t));
+    while (i > 0U && open > 0U) {
+        uint32_t page = page_tag(TRACE_LE32(shard_addrs[--i]));
+        unsigned int set = tlb_set_of(tlb, page);
+        if (setcnt[set] >= ways) continue;
+        uint32_t h = (page * 0x9E3779B1U) >> (32U - shard_seen_bits);
+        while (seen[h] != UINT32_MAX && seen[h] != page) h = (h + 1U) & mask;
+        if (seen[h] == page) continue;
+        seen[h] = page;
+        if (++setcnt[set] == ways) --open;
+    }
+    return i;
+}
+
+/* Simula el trozo c con su calentamiento.
+   Usa ≤3 punteros: w, tlb, slot. */
+static void shard_run_chunk(char *w, uint64_t c)
+{
+    char *tlb = tlb_create(tlb_sets, tlb_entries / tlb_sets, tlb_index_fn,
+                           tlb_layout, POL_LRU);
+    char *slot;
+    uint64_t start = c * shard_chunk;
+    uint64_t end = start + shard_chunk < shard_len ? start + shard_chunk
+                                                   : shard_len;
+    uint64_t i = shard_warm_start(w, tlb, start);
+    uint64_t *lat = (uint64_t *)(w + W_LAT);
+    uint64_t hits = 0U, misses = 0U, evictions = 0U;
+    char zeros[PAGE_BIN_SIZE] = {0};
+
+    FIELD64(w, W_WARM) += start - i;
+    for (; i < end; ++i) {
+        uint32_t vaddr = TRACE_LE32(shard_addrs[i]);
+        uint32_t page = page_tag(vaddr);
+        int counted = i >= start;
+        uint64_t t0 = 0U;
+        if (counted && timer_kind != TIMER_GTOD) t0 = timer_now();
+        slot = tlb_find(tlb, page);
+        if (slot) {
+            tlb_update_lru(tlb, slot);
+            if (!counted) continue;
+            if (timer_kind != TIMER_GTOD) {
+                lat_record(lat, HIST_HIT, t0, timer_now());
+            }
+            ++hits;
+        } else {
+            uintptr_t replaced = tlb_insert(tlb, page, vaddr & 0xFFFU,
+                                            zeros, zeros, NULL);
+            if (!counted) continue;
+            if (timer_kind != TIMER_GTOD) {
+                lat_record(lat, HIST_MISS, t0, timer_now());
+            }
+            ++misses;
+            if (replaced != (uintptr_t)0) ++evictions;
+        }
+    }
+    /* se publican por trozo: --metrics los lee desde otro hilo */
+    __atomic_fetch_add((uint64_t *)(w + W_HITS), hits, __ATOMIC_RELAXED);
+    __atomic_fetch_add((uint64_t *)(w + W_MISSES), misses, __ATOMIC_RELAXED);
+    __atomic_fetch_add((uint64_t *)(w + W_EVICT), evictions,
+                       __ATOMIC_RELAXED);
+    ++FIELD64(w, W_CHUNKS);
+    tlb_destroy(tlb);
+}
+
+/* Toma el primer trozo del rango propio */
+static int shard_pop(char *w, uint64_t *c)
+{
+    uint64_t *range = (uint64_t *)(w + W_RANGE);
+    uint64_t r = __atomic_load_n(range, __ATOMIC_ACQUIRE);
+    for (;;) {
+        uint64_t lo = r & 0xFFFFFFFFU;
+        uint64_t hi = r >> 32;
+        if (lo >= hi) return 0;
+        if (__atomic_compare_exchange_n(range, &r, (hi << 32) | (lo + 1U), 0,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            *c = lo;
+            return 1;
+        }
+    }
+}
+
+/* Roba el último trozo del hilo con más trabajo pendiente */
+static int shard_steal(uint64_t *c)
+{
+    for (;;) {
+        unsigned int t;
+        unsigned int victim = SHARD_MAX_THREADS;
+        uint64_t best = 0U;
+        uint64_t r = 0U;
+        for (t = 0U; t < shard_threads; ++t) {
+            uint64_t v = __atomic_load_n((uint64_t *)(shard_worker[t]
+                                                      + W_RANGE),
+                                         __ATOMIC_ACQUIRE);
+            uint64_t lo = v & 0xFFFFFFFFU;
+            uint64_t hi = v >> 32;
+            if (hi > lo && hi - lo > best) {
+                best = hi - lo;
+                victim = t;
+                r = v;
+            }
+        }
+        if (victim == SHARD_MAX_THREADS) return 0;
+        uint64_t hi = r >> 32;
+        if (__atomic_compare_exchange_n((uint64_t *)(shard_worker[victim]
+                                                     + W_RANGE),
+                                        &r, ((hi - 1U) << 32)
+                                            | (r & 0xFFFFFFFFU), 0,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            *c = hi - 1U;
+            return 1;
+        }
+    }
+}
+
+static void *shard_worker_main(void *arg)
+{
+    char *w = shard_worker[(uintptr_t)arg];
+    uint64_t c;
+    for (;;) {
+        if (shard_pop(w, &c)) {
+            shard_run_chunk(w, c);
+        } else if (shard_steal(&c)) {
+            ++FIELD64(w, W_STEALS);
+            shard_run_chunk(w, c);
+        } else {
+            break;
+        }
+    }
+    __atomic_add_fetch(&shard_done, 1U, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+/* Suma el contador 'off' de todos los hilos */
+static uint64_t shard_sum(unsigned int off)
+{
+    uint64_t total = 0U;
+    unsigned int t;
+    for (t = 0U; t < shard_threads; ++t) {
+        total += __atomic_load_n((uint64_t *)(shard_worker[t] + off),
+                                 __ATOMIC_RELAXED);
+    }
+    return total;
+}
+
+/* Punto de entrada de --parallel: decodifica la traza si hace falta
+   (texto o deltas; una traza binaria absoluta se usa tal cual desde
+   mmap), simula los trozos y fusiona las estadísticas. */
+int shard_main(const char *path)
+{
+    size_t len = 0U;
+    int mapped = 0;
+    char *data = map_file(path, &len, &mapped);
+    uint64_t faults = 0U;
+    unsigned int t;
+
+    if (!data) return EXIT_FAILURE;
+    uint64_t count = 0U;
+    unsigned int flags = 0U;
+    int binary = trace_bin_header(data, len, path, &count, &flags);
+    if (binary < 0) {
+        unmap_file(data, len, mapped);
+        return EXIT_FAILURE;
+    }
+    if (binary && !(flags & TRACE_F_DELTA)) {
+        shard_addrs = (const uint32_t *)(data + TRACE_HDR_SIZE);
+        shard_len = count;
+    } else if (binary) {
+        trace_for_each(data, len, binary, shard_collect);
+    } else {
+        char *p = data;
+        const char *line;
+        size_t line_len;
+        uint64_t vaddr = 0U;
+        int st;
+        while ((st = trace_next_line(&p, data + len, &vaddr, &line,
+                                     &line_len)) != LINE_END) {
+            if (st == LINE_ADDR) shard_collect(vaddr);
+            else if (st == LINE_FAULT) ++faults;
+        }
+    }
+    if (shard_owned) {
+        /* la copia se guarda en little-endian, como la traza mapeada,
+           para leer ambas con TRACE_LE32 */
+        uint64_t i;
+        for (i = 0U; i < shard_len; ++i) {
+            shard_owned[i] = TRACE_LE32(shard_owned[i]);
+        }
+        shard_addrs = shard_owned;
+    }
+
+    uint64_t chunks = (shard_len + shard_chunk - 1U) / shard_chunk;
+    if (chunks > UINT32_MAX) {
+        fprintf(stderr, "Error: demasiados trozos; aumente --chunk\n");
+        free(shard_owned);
+        unmap_file(data, len, mapped);
+        return EXIT_FAILURE;
+    }
+    if (shard_threads > chunks && chunks > 0U) {
+        shard_threads = (unsigned int)chunks;
+    }
+    shard_seen_bits = 1U;
+    while ((1U << shard_seen_bits) < 2U * tlb_entries) ++shard_seen_bits;
+    for (t = 0U; t < shard_threads; ++t) {
+        char *w = (char *)aligned_alloc(64U, (W_SIZE + 63U) & ~(size_t)63U);
+        if (!w) {
+            perror("malloc hilos");
+            exit(EXIT_FAILURE);
+        }
+        memset(w, 0, W_SIZE);
+        *((uint32_t **)(w + W_SEEN)) = (uint32_t *)malloc(
+            ((size_t)1U << shard_seen_bits) * sizeof(uint32_t));
+        *((uint16_t **)(w + W_SETCNT)) = (uint16_t *)malloc(
+            (size_t)tlb_sets * sizeof(uint16_t));
+        if (!*((uint32_t **)(w + W_SEEN)) || !*((uint16_t **)(w + W_SETCNT))) {
+            perror("malloc hilos");
+            exit(EXIT_FAILURE);
+        }
+        /* rango contiguo inicial: chunks * t / T .. chunks * (t+1) / T */
+        FIELD64(w, W_RANGE) = (chunks * t / shard_threads)
+                              | ((chunks * (t + 1U) / shard_threads) << 32);
+        shard_worker[t] = w;
+    }
+
+    pthread_t threads[SHARD_MAX_THREADS];
+    struct timeval t0, t1;
+    shard_done = 0U;
+    gettimeofday(&t0, NULL);
+    for (t = 0U; t < shard_threads; ++t) {
+        if (pthread_create(&threads[t], NULL, shard_worker_main,
+                           (void *)(uintptr_t)t) != 0) {
+            perror("pthread_create");
+            exit(EXIT_FAILURE);
+        }
+    }
+    /* con --metrics el hilo principal arma las muestras con lo que
+       los hilos publican al terminar cada trozo */
+    while (metrics_buf
+           && __atomic_load_n(&shard_done, __ATOMIC_ACQUIRE) < shard_threads) {
+        struct timespec nap = { 0, 10000000L };
+        nanosleep(&nap, NULL);
+        uint64_t now = mono_ns();
+        if (now >= metrics_next) {
+            metrics_sample(now, shard_sum(W_HITS), shard_sum(W_MISSES),
+                           shard_sum(W_EVICT), faults);
+        }
+    }
+    for (t = 0U; t < shard_threads; ++t) pthread_join(threads[t], NULL);
+    gettimeofday(&t1, NULL);
+    double elapsed = (t1.tv_sec - t0.tv_sec) +
+        (t1.tv_usec - t0.tv_usec) / 1e6;
+    metrics_close(shard_sum(W_HITS), shard_sum(W_MISSES), shard_sum(W_EVICT),
+                  faults);
+
+    uint64_t hits = shard_sum(W_HITS);
+    uint64_t misses = shard_sum(W_MISSES);
+    uint64_t translated = hits + misses;
+    uint64_t cycles = hits * lat_l1 + misses * (uint64_t)(lat_l1 + lat_walk);
+    for (t = 0U; t < shard_threads; ++t) {
+        lat_merge(lat_stats, (const uint64_t *)(shard_worker[t] + W_LAT));
+    }
+
+    printf("TLB: %u entradas, %u conjuntos x %u vías (índice %s, %s, %s)\n",
+           tlb_entries, tlb_sets, tlb_entries / tlb_sets,
+           tlb_index_fn == INDEX_XOR ? "xor" : "bajo",
+           layout_name(),
+           lru_mode == LRU_SCAN ? "lru-scan" : tlb_policy_names[tlb_policy]);
+    printf("Réplica paralela: %u hilos, %" PRIu64 " trozos de %" PRIu64
+           " accesos (robados: %" PRIu64 ", calentamiento medio: %.1f"
+           " accesos)\n", shard_threads, chunks, shard_chunk,
+           shard_sum(W_STEALS),
+           chunks ? (double)shard_sum(W_WARM) / (double)chunks : 0.0);
+    printf("Accesos: %" PRIu64 "\n", translated + faults);
+    printf("TLB Hit: %" PRIu64 " (%.2f%%)\n", hits,
+           translated ? 100.0 * (double)hits / (double)translated : 0.0);
+    printf("TLB Miss: %" PRIu64 "\n", misses);
+    printf("Reemplazos: %" PRIu64 "\n", shard_sum(W_EVICT));
+    printf("Ciclos simulados: %" PRIu64 " (L1=%u, L2=%u, walk=%u)\n",
+           cycles, lat_l1, lat_l2, lat_walk);
+    printf("Costo medio por traducción: %.3f ciclos\n",
+           translated ? (double)cycles / (double)translated : 0.0);
+    printf("Page Fault: %" PRIu64 "\n", faults);
+    printf("Tiempo: %.6f segundos\n", elapsed);
+    printf("Traducciones/s: %.0f\n",
+           elapsed > 0.0 ? (double)translated / elapsed : 0.0);
+    print_latency();
+
+    for (t = 0U; t < shard_threads; ++t) {
+        free(*((uint32_t **)(shard_worker[t] + W_SEEN)));
+        free(*((uint16_t **)(shard_worker[t] + W_SETCNT)));
+        free(shard_worker[t]);
+        shard_worker[t] = NULL;
+    }
+    free(shard_owned);
+    shard_owned = NULL;
+    shard_addrs = NULL;
+    shard_len = shard_cap = 0U;
+    unmap_file(data, len, mapped);
+    return 0;
+}
+
+/* ---------- Curva de fallos en una pasada (--mrc) ---------- */
+
+/* Algoritmo de pila de Mattson: por la propiedad de inclusión de LRU,
+   un acceso acierta en un TLB totalmente asociativo de c entradas si y
+   sólo si su distancia de pila (páginas distintas referenciadas desde
+   el acceso anterior a la misma página, +1) es <= c. La distancia se
+   obtiene en O(log n) con un árbol de Fenwick sobre el tiempo: hay un
+   1 en la posición del último acceso de cada página, y la distancia es
+   la suma de los 1 posteriores a ese acceso.
+   Cuando el tiempo llega a la capacidad del árbol se compactan las
+   marcas vivas (a lo sumo una por página) al inicio. */
+#define MRC_PAGES    ((size_t)tag_space)
+#define MRC_TIME_CAP (1U << 22)
+#define MRC_NONE     UINT32_MAX
+
+static uint32_t *mrc_last = NULL;     /* página -> último tiempo */
+static uint32_t *mrc_page_at = NULL;  /* tiempo -> página */
+static uint32_t *mrc_tree = NULL;     /* árbol de Fenwick (base 1) */
+static uint64_t *mrc_hist = NULL;     /* distancia -> número de accesos */
+static uint32_t mrc_time = 0U;
+static unsigned int mrc_max = 4096U;  /* mayor tamaño de la curva */
+static uint64_t mrc_accesses = 0U;
+static uint64_t mrc_cold = 0U;
+
+static inline void fenwick_add(uint32_t pos, int32_t delta)
+{
+    for (++pos; pos <= MRC_TIME_CAP; pos += pos & (~pos + 1U)) {
+        mrc_tree[pos] += (uint32_t)delta;
+    }
+}
+
+/* Suma de las posiciones [0, pos) */
+static inline uint32_t fenwick_prefix(uint32_t pos)
+{
+    uint32_t sum = 0U;
+    for (; pos > 0U; pos -= pos & (~pos + 1U)) sum += mrc_tree[pos];
+    return sum;
+}
+
+/* Reubica las marcas vivas en los tiempos 0..L-1 conservando el orden
+   y reconstruye el árbol en O(capacidad). */
+void mrc_compact(void)
+{
+    uint32_t t;
+    uint32_t live = 0U;
+    for (t = 0U; t < mrc_time; ++t) {
+        uint32_t page = mrc_page_at[t];
+        if (page != MRC_NONE && mrc_last[page] == t) {
+            mrc_page_at[live] = page;
+            mrc_last[page] = live++;
+        }
+    }
+    memset(mrc_tree, 0, (MRC_TIME_CAP + 1U) * sizeof(uint32_t));
+    for (t = 1U; t <= MRC_TIME_CAP; ++t) {
+        uint32_t parent = t + (t & (~t + 1U));
+        if (t <= live) mrc_tree[t] += 1U;
+        if (parent <= MRC_TIME_CAP) mrc_tree[parent] += mrc_tree[t];
+    }
+    mrc_time = live;
+}
+
+void mrc_access(uint64_t vaddr)
+{
+    uint32_t page = page_tag(vaddr);
+    uint32_t prev = mrc_last[page];
+
+    if (mrc_time == MRC_TIME_CAP) {
+        mrc_compact();
+        prev = mrc_last[page];
+    }
+    ++mrc_accesses;
+    if (prev == MRC_NONE) {
+        ++mrc_cold;
+    } else {
+        uint32_t dist = fenwick_prefix(mrc_time) - fenwick_prefix(prev + 1U)
+                        + 1U;
+        ++mrc_hist[dist <= mrc_max ? dist : mrc_max + 1U];
+        fenwick_add(prev, -1);
+    }
+    fenwick_add(mrc_time, 1);
+    mrc_page_at[mrc_time] = page;
+    mrc_last[page] = mrc_time++;
+}
+
+/* Punto de entrada de --mrc: imprime en CSV la tasa de fallos de un
+   TLB totalmente asociativo LRU para cada tamaño 1..mrc_max. */
+int mrc_main(const char *path)
+{
+    size_t len = 0U;
+    int mapped = 0;
+    uint64_t count = 0U;
+    unsigned int flags = 0U;
+    char *data = map_file(path, &len, &mapped);
+    if (!data) return EXIT_FAILURE;
+    int binary = trace_bin_header(data, len, path, &count, &flags);
+    if (binary < 0) {
+        unmap_file(data, len, mapped);
+        return EXIT_FAILURE;
+    }
+
+    mrc_last = (uint32_t *)malloc(MRC_PAGES * sizeof(uint32_t));
+    mrc_page_at = (uint32_t *)malloc(MRC_TIME_CAP * sizeof(uint32_t));
+    mrc_tree = (uint32_t *)calloc(MRC_TIME_CAP + 1U, sizeof(uint32_t));
+    mrc_hist = (uint64_t *)calloc((size_t)mrc_max + 2U, sizeof(uint64_t));
+    if (!mrc_last || !mrc_page_at || !mrc_tree || !mrc_hist) {
+        perror("malloc curva de fallos");
+        exit(EXIT_FAILURE);
+    }
+    memset(mrc_last, 0xFF, MRC_PAGES * sizeof(uint32_t));
+
+    struct timeval t0, t1;
+    gettimeofday(&t0, NULL);
+    trace_for_each(data, len, binary, mrc_access);
+    gettimeofday(&t1, NULL);
+    double elapsed = (t1.tv_sec - t0.tv_sec) +
+        (t1.tv_usec - t0.tv_usec) / 1e6;
+
+    printf("entradas,hits,misses,tasa_miss\n");
+    uint64_t hits = 0U;
+    unsigned int c;
+    for (c = 1U; c <= mrc_max; ++c) {
+        hits += mrc_hist[c];
+        printf("%u,%" PRIu64 ",%" PRIu64 ",%.6f\n", c, hits,
+               mrc_accesses - hits,
+               mrc_accesses ? (double)(mrc_accesses - hits)
+                              / (double)mrc_accesses : 0.0);
+    }
+    fprintf(stderr, "Accesos: %" PRIu64 ", obligatorios: %" PRIu64
+            ", tiempo: %.6f segundos\n", mrc_accesses, mrc_cold, elapsed);
+
+    free(mrc_last);
+    free(mrc_page_at);
+    free(mrc_tree);
+    free(mrc_hist);
+    unmap_file(data, len, mapped);
+    return 0;
+}
+
+/* ---------- Benchmark de búsqueda (--bench-lookup) ---------- */
+
+/* Mide ns por llamada a tlb_find con las disposiciones AoS, SoA y
+   compacta para varios tamaños y organizaciones. El TLB se llena con N
+   páginas y las claves se toman al azar entre 2N páginas (≈50% de
+   aciertos). La fila de TLB_COMPACT_ENTRIES es lo que entra en el
+   presupuesto con entradas compactas frente a las 5 de la AoS. */
+#define BENCH_KEYS    4096U
+#define BENCH_LOOKUPS (1U << 22)
+
+int bench_lookup_main(void)
+{
+    static const unsigned int configs[][2] = {
+        /* entradas, conjuntos */
+        { 5U, 1U }, { TLB_COMPACT_ENTRIES, 1U }, { 64U, 1U }, { 64U, 16U },
+        { 1536U, 1U }, { 1536U, 128U }
+    };
+    static const char zeros[PAGE_BIN_SIZE];
+    uint32_t *keys = (uint32_t *)malloc(BENCH_KEYS * sizeof(uint32_t));
+    uint64_t found = 0U;
+    size_t c;
+
+    if (!keys) {
+        perror("malloc claves");
+        return EXIT_FAILURE;
+    }
+    printf("Entradas  Conjuntos  Vías  Disposición  Sondeo    ns/op\n");
+    for (c = 0U; c < sizeof(configs) / sizeof(configs[0]); ++c) {
+        unsigned int entries = configs[c][0];
+        unsigned int sets = configs[c][1];
+        uint32_t x = 2463534242U; /* xorshift32, semilla fija */
+        unsigned int i;
+
+        for (i = 0U; i < BENCH_KEYS; ++i) {
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+            keys[i] = (x % (2U * entries)) * 7U + 3U;
+        }
+        int layout;
+        for (layout = LAYOUT_AOS; layout <= LAYOUT_COMPACT; ++layout) {
+            char *tlb = tlb_create(sets, entries / sets, INDEX_LOW, layout,
+                                   POL_LRU);
+            for (i = 0U; i < 4U * entries; ++i) {
+                uint32_t page = (i % (2U * entries)) * 7U + 3U;
+                if (!tlb_find(tlb, page)) {
+                    tlb_insert(tlb, page, 0U, zeros, zeros, NULL);
+                }
+            }
+            struct timeval t0, t1;
+            gettimeofday(&t0, NULL);
+            for (i = 0U; i < BENCH_LOOKUPS; ++i) {
+                found += tlb_find(tlb, keys[i & (BENCH_KEYS - 1U)]) != NULL;
+            }
+            gettimeofday(&t1, NULL);
+            double elapsed = (t1.tv_sec - t0.tv_sec) +
+                (t1.tv_usec - t0.tv_usec) / 1e6;
+            static const char *const layout_names[] = {
+                "aos", "soa", "compact"
+            };
+            printf("%8u  %9u  %4u  %-11s  %-8s %6.2f\n",
+                   entries, sets, entries / sets, layout_names[layout],
+                   layout == LAYOUT_SOA ? tlb_tags_probe_name
+                   : layout == LAYOUT_COMPACT ? tlb_cslots_probe_name
+                   : (entries / sets > PROBE_WAYS_MAX ? "hash" : "escalar"),
+                   elapsed * 1e9 / (double)BENCH_LOOKUPS);
+            tlb_destroy(tlb);
+        }
+    }
+    printf("(aciertos: %" PRIu64 ")\n", found);
+    free(keys);
+    return 0;
+}
+
+/* ---------- Verificación diferencial (--fuzz) ---------- */
+
+/* Corre el motor (tlb_find, tlb_insert, tlb_update_lru y
+   tlb_invalidate con su disposición, sondeo, índice hash y listas) en
+   paralelo con un modelo de referencia de arreglos simples que recorre
+   las vías del conjunto, sobre trazas aleatorias y adversas (conflictos
+   en un conjunto, ciclos de entradas + 1 páginas, pocas páginas
+   calientes) con invlpg intercalados. En cada paso compara el Hit, la
+   vía del slot reemplazado (el valor de "Politica de reemplazo") y la
+   página que sale. Cada traza usa una organización al azar (1 a 64
+   vías, más de PROBE_WAYS_MAX para el índice hash); la primera traza
+   con una diferencia se reduce quitando trozos cada vez más chicos
+   mientras siga fallando y se imprime como reproductor.
+   El modelo sigue la semántica documentada: un Miss llena el slot
+   invalidado más recientemente del conjunto (al principio la vía 0,
+   luego la 1...) y, si no hay, la víctima LRU o FIFO de menor marca.
+   Sólo hay modelo para lru y fifo. */
+#define FUZZ_INVLPG   0x80000000U  /* bit de operación invlpg */
+#define FUZZ_PAGES    (1U << 20)   /* páginas de 4 KiB en 32 bits */
+#define FUZZ_MAX_WAYS 64U
+#define FUZZ_MAX_SETS 16U
+
+static uint64_t fuzz_traces = 0U;   /* --fuzz */
+static uint32_t fuzz_len = 2000U;   /* --fuzz-len */
+static unsigned int fuzz_sets, fuzz_ways;
+static int fuzz_index, fuzz_layout, fuzz_policy, fuzz_scan;
+
+/* Conjunto de una página en el modelo (misma función que tlb_set_of,
+   escrita aparte) */
+static unsigned int fuzz_set_of(uint32_t page)
+{
+    unsigned int bits = 0U;
+    uint32_t h = page;
+
+    while ((1U << bits) < fuzz_sets) ++bits;
+    if (fuzz_index == INDEX_XOR && bits > 0U) {
+        uint32_t p;
+        for (p = page >> bits; p != 0U; p >>= bits) h ^= p;
+    }
+    return h & (fuzz_sets - 1U);
+}
+
+/* Reproduce ops[0..n) en un TLB nuevo y en el modelo. Devuelve el paso
+   de la primera diferencia (descrita en why) o n si coinciden.
+   Usa ≤3 punteros: tlb, slot. */
+static uint32_t fuzz_replay(const uint32_t *ops, uint32_t n, char *why,
+                            size_t why_len)
+{
+    static const char zeros[PAGE_BIN_SIZE];
+    unsigned int entries = fuzz_sets * fuzz_ways;
+    uint32_t ref_page[FUZZ_MAX_WAYS * FUZZ_MAX_SETS];
+    /* marca de uso o de llegada; si está vacío, orden de liberación */
+    uint64_t ref_key[FUZZ_MAX_WAYS * FUZZ_MAX_SETS];
+    uint64_t clock = fuzz_ways;
+    char *tlb;
+    char *slot;
+    uint32_t step, i;
+
+    tlb = tlb_create(fuzz_sets, fuzz_ways, fuzz_index, fuzz_layout,
+                     fuzz_policy);
+    FIELD32(tlb, H_LRU_MODE) = fuzz_scan ? LRU_SCAN : LRU_LIST;
+    for (i = 0U; i < entries; ++i) {
+        ref_page[i] = UINT32_MAX;
+        ref_key[i] = fuzz_ways - i % fuzz_ways; /* vía 0 primero */
+    }
+    for (step = 0U; step < n; ++step) {
+        uint32_t page = ops[step] & ~FUZZ_INVLPG;
+        uint32_t base = fuzz_set_of(page) * fuzz_ways;
+        uint32_t way = UINT32_MAX; /* vía en el modelo */
+
+        for (i = 0U; i < fuzz_ways; ++i) {
+            if (ref_page[base + i] == page) way = i;
+        }
+        slot = tlb_find(tlb, page);
+        if ((slot != NULL) != (way != UINT32_MAX)) {
+            snprintf(why, why_len, "página %" PRIu32 ": el motor %s, el"
+                     " modelo %s", page, slot ? "la tiene" : "no la tiene",
+                     way != UINT32_MAX ? "la tiene" : "no la tiene");
+            break;
+        }
+        if (ops[step] & FUZZ_INVLPG) {
+            if (slot) {
+                tlb_invalidate(tlb, slot);
+                ref_page[base + way] = UINT32_MAX;
+                ref_key[base + way] = ++clock;
+            }
+            continue;
+        }
+        if (slot) {
+            tlb_update_lru(tlb, slot);
+            if (fuzz_policy == POL_LRU) ref_key[base + way] = ++clock;
+            continue;
+        }
+
+        /* Miss: slot vacío liberado más tarde o menor marca */
+        uint32_t empty = UINT32_MAX, victim = 0U;
+        for (i = 0U; i < fuzz_ways; ++i) {
+            uint32_t j = base + i;
+            if (ref_page[j] == UINT32_MAX) {
+                if (empty == UINT32_MAX || ref_key[j] > ref_key[base + empty])
+                    empty = i;
+            } else if (ref_key[j] < ref_key[base + victim]
+                       || ref_page[base + victim] == UINT32_MAX) {
+                victim = i;
+            }
+        }
+        uint32_t ref_way = empty != UINT32_MAX ? empty : victim;
+        uint32_t ref_evicted = ref_page[base + ref_way];
+        uint32_t evicted = UINT32_MAX;
+        uintptr_t replaced = tlb_insert(tlb, page, 0U, zeros, zeros,
+                                        &evicted);
+        uint32_t eng_way = UINT32_MAX;
+        if (replaced != (uintptr_t)0) {
+            eng_way = (uint32_t)(fuzz_layout == LAYOUT_COMPACT
+                                 ? CSLOT_INDEX(tlb, (char *)replaced)
+                                 : SLOT_INDEX(tlb, (char *)replaced))
+                % fuzz_ways;
+        }
+        ref_page[base + ref_way] = page;
+        ref_key[base + ref_way] = ++clock;
+        if (empty != UINT32_MAX) ref_way = UINT32_MAX; /* sin reemplazo */
+        if (eng_way != ref_way
+            || (ref_way != UINT32_MAX && evicted != ref_evicted)) {
+            snprintf(why, why_len, "Miss de la página %" PRIu32 ": el motor"
+                     " reemplaza la vía %d (página %" PRId64 "), el modelo"
+                     " la vía %d (página %" PRId64 ")", page,
+                     eng_way == UINT32_MAX ? -1 : (int)eng_way,
+                     eng_way == UINT32_MAX ? -1 : (int64_t)evicted,
+                     ref_way == UINT32_MAX ? -1 : (int)ref_way,
+                     ref_way == UINT32_MAX ? -1 : (int64_t)ref_evicted);
+            break;
+        }
+    }
+    tlb_destroy(tlb);
+    return step;
+}
+
+/* Llena ops[0..n) con una traza del tipo 'kind' para la organización
+   actual: 0 uniforme sobre 2x entradas páginas, 1 todas al mismo
+   conjunto, 2 ciclo de entradas + 1 páginas, 3 pocas páginas
+   calientes y alguna fría. Con invlpg_pct % de invlpg. */
+static void fuzz_fill(uint32_t *ops, uint32_t n, unsigned int kind,
+                      unsigned int invlpg_pct)
+{
+    unsigned int entries = fuzz_sets * fuzz_ways;
+    uint32_t base = (uint32_t)gen_rand() % FUZZ_PAGES;
+    uint32_t i;
+
+    for (i = 0U; i < n; ++i) {
+        uint64_t r = gen_rand();
+        uint32_t k;
+        switch (kind) {
+        case 0:
+            k = (uint32_t)(r % (2U * entries));
+            break;
+        case 1:
+            k = (uint32_t)(r % (2U * fuzz_ways + 1U)) * fuzz_sets;
+            break;
+        case 2:
+            k = i % (entries + 1U);
+            break;
+        default:
+            k = (r & 15U) ? (uint32_t)((r >> 4) % (fuzz_ways + 1U))
+                          : (uint32_t)((r >> 4) % (8U * entries));
+            break;
+        }
+        ops[i] = (base + k) % FUZZ_PAGES;
+        if ((r >> 40) % 100U < invlpg_pct) ops[i] |= FUZZ_INVLPG;
+    }
+}
+
+/* Quita trozos de la traza (de la mitad hacia abajo) mientras siga
+   fallando; devuelve la longitud final. */
+static uint32_t fuzz_shrink(uint32_t *ops, uint32_t n, uint32_t *tmp)
+{
+    char why[256];
+    uint32_t chunk, i;
+
+    n = fuzz_replay(ops, n, why, sizeof(why)) + 1U;
+    for (chunk = n / 2U; chunk >= 1U; chunk /= 2U) {
+        for (i = 0U; i + chunk <= n; ) {
+            uint32_t m = n - chunk, fail;
+            memcpy(tmp, ops, i * sizeof(uint32_t));
+            memcpy(tmp + i, ops + i + chunk,
+                   (n - i - chunk) * sizeof(uint32_t));
+            fail = m ? fuzz_replay(tmp, m, why, sizeof(why)) : 0U;
+            if (fail < m) {
+                n = fail + 1U;
+                memcpy(ops, tmp, n * sizeof(uint32_t));
+            } else {
+                i += chunk;
+            }
+        }
+    }
+    return n;
+}
+
+/* Punto de entrada de --fuzz: fuzz_traces trazas de fuzz_len pasos.
+   Devuelve EXIT_FAILURE (e imprime el reproductor mínimo como traza
+   decimal, invlpg con "iADDR" como en --asids) si hubo diferencias. */
+int fuzz_main(void)
+{
+    static const char *const layout_names[] = { "aos", "soa", "compact" };
+    uint32_t *ops = (uint32_t *)malloc(2U * fuzz_len * sizeof(uint32_t));
+    uint64_t t, steps = 0U;
+    char why[256];
+    uint32_t fail = 0U, i;
+
+    if (!ops) {
+        perror("malloc fuzz");
+        return EXIT_FAILURE;
+    }
+    gen_rng = policy_seed;
+    for (t = 0U; t < fuzz_traces; ++t) {
+        uint64_t r = gen_rand();
+        fuzz_sets = 1U << (r % 5U);           /* 1..FUZZ_MAX_SETS */
+        fuzz_ways = 1U + (uint32_t)((r >> 8) % FUZZ_MAX_WAYS);
+        fuzz_index = (r >> 16) & 1U ? INDEX_XOR : INDEX_LOW;
+        fuzz_layout = (int)((r >> 20) % 3U);
+        fuzz_policy = (r >> 24) & 1U ? POL_FIFO : POL_LRU;
+        fuzz_scan = fuzz_policy == POL_LRU && (r >> 28) % 4U == 0U;
+        if (fuzz_layout == LAYOUT_COMPACT) {
+            fuzz_policy = POL_LRU;
+            fuzz_scan = 0;
+        }
+        fuzz_fill(ops, fuzz_len, (unsigned int)((r >> 32) % 4U),
+                  (unsigned int)((r >> 36) % 4U) * 5U);
+        fail = fuzz_replay(ops, fuzz_len, why, sizeof(why));
+        steps += fail;
+        if (fail < fuzz_len) break;
+    }
+    if (t == fuzz_traces) {
+        printf("Fuzz: %" PRIu64 " trazas, %" PRIu64 " pasos, sin"
+               " diferencias con el modelo de referencia (sondeo soa %s,"
+               " compacto %s)\n", fuzz_traces, steps, tlb_tags_probe_name,
+               tlb_cslots_probe_name);
+        free(ops);
+        return 0;
+    }
+    printf("Diferencia en el paso %" PRIu32 " de la traza %" PRIu64
+           " (semilla %" PRIu64 "): %s\n", fail, t, policy_seed, why);
+    uint32_t n = fuzz_shrink(ops, fail + 1U, ops + fuzz_len);
+    fuzz_replay(ops, n, why, sizeof(why));
+    printf("Configuración: --sets %u --ways %u --index %s --layout %s"
+           " --policy %s --lru %s\n", fuzz_sets, fuzz_ways,
+           fuzz_index == INDEX_XOR ? "xor" : "low",
+           layout_names[fuzz_layout], tlb_policy_names[fuzz_policy],
+           fuzz_scan ? "scan" : "list");
+    printf("Reproductor mínimo (%" PRIu32 " pasos; falla el último: %s):\n",
+           n, why);
+    for (i = 0U; i < n; ++i) {
+        printf("%s%" PRIu32 "\n", ops[i] & FUZZ_INVLPG ? "i" : "",
+               (ops[i] & ~FUZZ_INVLPG) << 12);
+    }
+    free(ops);
+    return EXIT_FAILURE;
+}
+
+void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Uso: %s [OPCIONES]             (modo interactivo)\n"
+            "     %s --trace ARCHIVO [--summary] [OPCIONES]\n"
+            "     %s --gen PATRONES [--gen-count N] [--gen-out ARCHIVO]\n"
+            "     %s --convert ENTRADA SALIDA [--delta]\n"
+            "     %s --bench-lookup [--simd MODO]\n"
+            "     %s --bench-engines [--bench-engine NOMBRE=RUTA] ...\n"
+            "     %s --fuzz N [--fuzz-len L] [--seed S] [--simd MODO]\n"
+            "     %s --mrc ARCHIVO [--mrc-max N]\n"
+            "  --trace ARCHIVO  traduce una traza por lotes: una dirección\n"
+            "                   decimal por línea (\"-\" = stdin) o una\n"
+            "                   traza binaria TLBT (se detecta sola)\n"
+            "  --summary        sólo imprime el resumen final\n"
+            "  --gen P1[:X][@W],...  simula accesos sintéticos (sin archivo)\n"
+            "                   mezclando los patrones con pesos W:\n"
+            "                   seq[:BYTES], stride[:PÁGINAS], uniform,\n"
+            "                   zipf[:S] y chase (semilla: --seed)\n"
+            "  --gen-count N    accesos generados (1000000; admite 1e9)\n"
+            "  --gen-pages N    páginas distintas (65536, <= %u)\n"
+            "  --gen-out ARCHIVO  guarda la traza generada en decimal (con\n"
+            "                   \"s\" al final) en vez de simularla\n"
+            "  --convert        convierte una traza decimal a binaria\n"
+            "  --delta          codifica la traza binaria en deltas (varint)\n"
+            "  --bench-lookup   mide ns por búsqueda con AoS y SoA\n"
+            "  --bench-engines  compara motores sobre trazas de --gen (o\n"
+            "                   seis cargas típicas) de --gen-count\n"
+            "                   accesos (200000): este programa interactivo\n"
+            "                   y por lotes y los motores externos; una\n"
+            "                   fila por corrida con traducciones/s,\n"
+            "                   ns/búsqueda, tasa de Hit y RSS máximo\n"
+            "  --bench-engine NOMBRE=RUTA  motor externo con el protocolo\n"
+            "                   de mt.c (repetible)\n"
+            "  --mt RUTA        referencia mt.c para --bench-engines (./mt;\n"
+            "                   gcc -std=c11 -O2 -o mt mt.c)\n"
+            "  --bench-sizes N1,N2,...  entradas a probar (5,64,512)\n"
+            "  --bench-policies P1,P2,...  políticas (lru,random,arc)\n"
+            "  --bench-format csv|json  formato del resultado (csv)\n"
+            "  --fuzz N         compara el motor con un modelo de\n"
+            "                   referencia en N trazas al azar y adversas\n"
+            "                   (organización al azar, lru/fifo, invlpg);\n"
+            "                   reduce la primera que difiera e imprime el\n"
+            "                   reproductor mínimo\n"
+            "  --fuzz-len L     pasos por traza de --fuzz (2000)\n"
+            "  --mrc ARCHIVO    curva de fallos LRU para 1..N entradas en\n"
+            "                   una sola pasada (CSV; N = --mrc-max, 4096)\n"
+            "Opciones del TLB:\n"
+            "  --entries N      número de entradas (por defecto %u)\n"
+            "  --sets S         conjuntos (potencia de 2, por defecto 1 =\n"
+            "                   totalmente asociativo)\n"
+            "  --ways W         vías por conjunto (entradas = S x W)\n"
+            "  --index low|xor  índice de conjunto: bits bajos de la página\n"
+            "                   o XOR de sus campos\n"
+            "  --lru list|scan  víctima por lista de recencia O(1) (por\n"
+            "                   defecto) o recorrido de contadores del\n"
+            "                   conjunto\n"
+            "  --policy P       reemplazo del L1: lru (por defecto), fifo,\n"
+            "                   clock, plru, random, lfu, arc u opt\n"
+            "                   (Belady; sólo con --trace)\n"
+            "  --seed N         semilla de la política random y de --gen\n"
+            "  --pages ARCHIVO  tamaño de página por región (\"INICIO FIN\n"
+            "                   4K|2M|1G\" por línea); informa alcance y\n"
+            "                   Hit con y sin páginas grandes\n"
+            "  --split-tlb A,B  L1 propios de A entradas para 2 MiB y B\n"
+            "                   para 1 GiB (0 = comparten el L1 principal)\n"
+            "  --cores N|N1,N2,...  con --trace: N núcleos, cada uno en su\n"
+            "                   hilo con su TLB; líneas \"C:ADDR\" y\n"
+            "                   \"C:uADDR\" (unmap -> shootdown). Con una\n"
+            "                   lista imprime la escalabilidad en CSV\n"
+            "  --shootdown-lat E,R  ciclos del emisor y de cada receptor\n"
+            "                   de un shootdown (por defecto 4000,1000)\n"
+            "  --parallel T     con --trace: réplica en T hilos (0 = todos\n"
+            "                   los núcleos) por trozos con calentamiento;\n"
+            "                   mismos contadores que la secuencial (LRU)\n"
+            "  --chunk N        accesos por trozo de --parallel (1048576)\n"
+            "  --va-bits 32|48|57  ancho del espacio virtual (por defecto\n"
+            "                   32); con 48/57 las direcciones deben ser\n"
+            "                   canónicas y --walk recorre 4 o 5 niveles;\n"
+            "                   admite hasta 2^20 páginas distintas y\n"
+            "                   2^20/S con los mismos bits de índice (S =\n"
+            "                   conjuntos del mayor nivel); sin --index xor\n"
+            "  --asids N        con --trace: N espacios de direcciones\n"
+            "                   (<= %u); la traza admite \"cN\" (cambio de\n"
+            "                   contexto), \"iADDR\" (invlpg) y \"fN\"\n"
+            "                   (vaciado selectivo del ASID N)\n"
+            "  --asid-mode tagged|flush  entradas etiquetadas con ASID\n"
+            "                   (por defecto) o vaciado en cada cambio; se\n"
+            "                   compara con el otro modo y se da Hit por ASID\n"
+            "  --flush-lat F,E,I  ciclos de un vaciado completo, por entrada\n"
+            "                   de un vaciado selectivo y de invlpg\n"
+            "                   (por defecto 150,1,120)\n"
+            "  --timer gtod|mono|tsc  reloj de cada traducción: gettimeofday\n"
+            "                   (por defecto), CLOCK_MONOTONIC_RAW o rdtsc\n"
+            "                   calibrado; mono y tsc imprimen al final\n"
+            "                   p50/p99/p99.9 de Hit y Miss\n"
+            "  --l2-entries N   agrega un TLB L2 (STLB) de N entradas\n"
+            "  --l2-sets S, --l2-ways W  organización del L2\n"
+            "  --l2-policy inclusive|exclusive  (por defecto inclusive)\n"
+            "  --lat L1,L2,WALK latencias en ciclos (por defecto 1,7,30)\n"
+            "  --walk           recorre una tabla de páginas 10/10/12 en\n"
+            "                   cada Miss (reemplaza la latencia WALK)\n"
+            "  --pwc N          entradas de la caché de recorridos (4)\n"
+            "  --mem-lat C      ciclos por acceso a memoria del walk (15)\n"
+            "  --fault-lat C    ciclos por fallo de página (1000)\n"
+            "  --prefetch seq|stride  tras cada Miss del L1 predice la\n"
+            "                   página siguiente o, si se repite la\n"
+            "                   distancia entre Miss, la del mismo paso;\n"
+            "                   informa precisión, cobertura y\n"
+            "                   contaminación\n"
+            "  --prefetch-buf N buffer de prefetch de N entradas (16;\n"
+            "                   0 = instalar en el L1)\n"
+            "  --prefetch-degree D  páginas predichas por Miss (1)\n"
+            "  --layout aos|soa|compact  etiquetas sólo en los slots (por\n"
+            "                   defecto), además contiguas para sondeo\n"
+            "                   SIMD, o entradas LRU de 8 bytes (%u en el\n"
+            "                   presupuesto de %u bytes si no se da\n"
+            "                   --entries)\n"
+            "  --simd auto|avx2|sse2|scalar  sondeo del layout soa\n"
+            "Métricas en vivo:\n"
+            "  --metrics DESTINO  publica contadores, reemplazos por slot,\n"
+            "                   conjunto de trabajo y traducciones/s en\n"
+            "                   un archivo (reescrito en cada muestra) o\n"
+            "                   en unix:RUTA (socket que ya escucha)\n"
+            "  --metrics-format prom|json  texto de Prometheus (por\n"
+            "                   defecto) o un objeto JSON por línea\n"
+            "  --metrics-interval S  segundos entre muestras (1)\n"
+            "  --metrics-window N  accesos de la ventana del conjunto de\n"
+            "                   trabajo (65536)\n"
+            "Checkpoints (con --trace):\n"
+            "  --checkpoint ARCHIVO  guarda TLB, recencia, contadores y\n"
+            "                   posición en la traza al terminar\n"
+            "  --checkpoint-every N  además cada N accesos\n"
+            "  --checkpoint-at N  se detiene tras N accesos y lo guarda\n"
+            "  --restore ARCHIVO  sigue la misma traza desde el\n"
+            "                   checkpoint; con otra política u\n"
+            "                   organización parte del TLB caliente con\n"
+            "                   los contadores en cero\n",
+            prog, prog, prog, prog, prog, prog, prog, prog, GEN_PAGES_MAX,
+            TLB_MAX_ENTRIES, ASID_MAX,
+            TLB_COMPACT_ENTRIES, TLB_MAX_BYTES);
+}
+
+/* ---------- Programa principal ---------- */
+
+int main(int argc, char **argv)
+{
+    const char *trace_path = NULL;
+    const char *conv_in = NULL;
+    const char *conv_out = NULL;
+    int verbose = 1;
+    int delta = 0;
+    int bench_lookup = 0;
+    int bench_engines_run = 0;
+    int gen_count_given = 0;
+    const char *mrc_path = NULL;
+    const char *simd = "auto";
+    const char *cores_list = NULL;
+    const char *pages_path = NULL;
+    const char *gen_out = NULL;
+    unsigned long ways = 0UL;
+    unsigned long l2_ways = 0UL;
+    int entries_given = 0;
+    int i;
+    for (i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            trace_path = argv[++i];
+        } else if (strcmp(argv[i], "--convert") == 0 && i + 2 < argc) {
+            conv_in = argv[++i];
+            conv_out = argv[++i];
+        } else if (strcmp(argv[i], "--gen") == 0 && i + 1 < argc) {
+            gen_spec = argv[++i];
+            if (!gen_parse(gen_spec)) return EXIT_FAILURE;
+        } else if (strcmp(argv[i], "--gen-count") == 0 && i + 1 < argc) {
+            double n = strtod(argv[++i], NULL); /* admite 1e9 */
+            if (!(n >= 1.0) || n > 1e18) {
+                fprintf(stderr, "Error: --gen-count inválido\n");
+                return EXIT_FAILURE;
+            }
+            gen_count = (uint64_t)n;
+            gen_count_given = 1;
+        } else if (strcmp(argv[i], "--gen-pages") == 0 && i + 1 < argc) {
+            unsigned long n = strtoul(argv[++i], NULL, 10);
+            if (n == 0UL || n > GEN_PAGES_MAX) {
+                fprintf(stderr, "Error: --gen-pages debe estar en [1, %u]\n",
+                        GEN_PAGES_MAX);
+                return EXIT_FAILURE;
+            }
+            gen_pages = (uint32_t)n;
+        } else if (strcmp(argv[i], "--gen-out") == 0 && i + 1 < argc) {
+            gen_out = argv[++i];
+        } else if (strcmp(argv[i], "--summary") == 0) {
+            verbose = 0;
+        } else if (strcmp(argv[i], "--delta") == 0) {
+            delta = 1;
+        } else if (strcmp(argv[i], "--entries") == 0 && i + 1 < argc) {
+            unsigned long n = strtoul(argv[++i], NULL, 10);
+            if (n == 0UL || n > TLB_ENTRIES_LIMIT) {
+                fprintf(stderr, "Error: --entries debe estar en [1, %u]\n",
+                        TLB_ENTRIES_LIMIT);
+                return EXIT_FAILURE;
+            }
+            tlb_entries = (unsigned int)n;
+            entries_given = 1;
+        } else if (strcmp(argv[i], "--sets") == 0 && i + 1 < argc) {
+            unsigned long n = strtoul(argv[++i], NULL, 10);
+            if (n == 0UL || n > TLB_ENTRIES_LIMIT || (n & (n - 1UL)) != 0UL) {
+                fprintf(stderr, "Error: --sets debe ser potencia de 2\n");
+                return EXIT_FAILURE;
+            }
+            tlb_sets = (unsigned int)n;
+        } else if (strcmp(argv[i], "--ways") == 0 && i + 1 < argc) {
+            ways = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--index") == 0 && i + 1 < argc) {
+            ++i;
+            if (strcmp(argv[i], "low") == 0) {
+                tlb_index_fn = INDEX_LOW;
+            } else if (strcmp(argv[i], "xor") == 0) {
+                tlb_index_fn = INDEX_XOR;
+            } else {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--layout") == 0 && i + 1 < argc) {
+            ++i;
+            if (strcmp(argv[i], "aos") == 0) {
+                tlb_layout = LAYOUT_AOS;
+            } else if (strcmp(argv[i], "soa") == 0) {
+                tlb_layout = LAYOUT_SOA;
+            } else if (strcmp(argv[i], "compact") == 0) {
+                tlb_layout = LAYOUT_COMPACT;
+            } else {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--simd") == 0 && i + 1 < argc) {
+            simd = argv[++i];
+        } else if (strcmp(argv[i], "--mrc") == 0 && i + 1 < argc) {
+            mrc_path = argv[++i];
+        } else if (strcmp(argv[i], "--mrc-max") == 0 && i + 1 < argc) {
+            mrc_max = (unsigned int)strtoul(argv[++i], NULL, 10);
+            if (mrc_max == 0U) mrc_max = 1U;
+        } else if (strcmp(argv[i], "--bench-lookup") == 0) {
+            bench_lookup = 1;
+        } else if (strcmp(argv[i], "--fuzz") == 0 && i + 1 < argc) {
+            fuzz_traces = strtoull(argv[++i], NULL, 10);
+            if (fuzz_traces == 0U) fuzz_traces = 1U;
+        } else if (strcmp(argv[i], "--fuzz-len") == 0 && i + 1 < argc) {
+            unsigned long n = strtoul(argv[++i], NULL, 10);
+            if (n == 0UL || n > (1UL << 24)) {
+                fprintf(stderr, "Error: --fuzz-len debe estar en [1, %lu]\n",
+                        1UL << 24);
+                return EXIT_FAILURE;
+            }
+            fuzz_len = (uint32_t)n;
+        } else if (strcmp(argv[i], "--bench-engines") == 0) {
+            bench_engines_run = 1;
+        } else if (strcmp(argv[i], "--mt") == 0 && i + 1 < argc) {
+            bench_mt_path = argv[++i];
+        } else if (strcmp(argv[i], "--bench-engine") == 0 && i + 1 < argc) {
+            if (!bench_add_engine(argv[++i])) {
+                fprintf(stderr, "Error: --bench-engine espera NOMBRE=RUTA"
+                        " (hasta %u motores)\n", BENCH_MAX_ENGINES);
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--bench-sizes") == 0 && i + 1 < argc) {
+            bench_sizes = argv[++i];
+        } else if (strcmp(argv[i], "--bench-policies") == 0
+                   && i + 1 < argc) {
+            bench_policies = argv[++i];
+        } else if (strcmp(argv[i], "--bench-format") == 0 && i + 1 < argc) {
+            ++i;
+            if (strcmp(argv[i], "csv") == 0) {
+                bench_json = 0;
+            } else if (strcmp(argv[i], "json") == 0) {
+                bench_json = 1;
+            } else {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--l2-entries") == 0 && i + 1 < argc) {
+            unsigned long n = 0UL;
+            if (!parse_size(argv[++i], TLB_ENTRIES_LIMIT, &n)) {
+                fprintf(stderr, "Error: --l2-entries debe estar en"
+                        " [0, %u]\n", TLB_ENTRIES_LIMIT);
+                return EXIT_FAILURE;
+            }
+            l2_entries = (unsigned int)n;
+        } else if (strcmp(argv[i], "--l2-sets") == 0 && i + 1 < argc) {
+            unsigned long n = 0UL;
+            if (!parse_size(argv[++i], TLB_ENTRIES_LIMIT, &n) || n == 0UL) {
+                fprintf(stderr, "Error: --l2-sets debe estar en [1, %u]\n",
+                        TLB_ENTRIES_LIMIT);
+                return EXIT_FAILURE;
+            }
+            l2_sets = (unsigned int)n;
+        } else if (strcmp(argv[i], "--l2-ways") == 0 && i + 1 < argc) {
+            if (!parse_size(argv[++i], TLB_ENTRIES_LIMIT, &l2_ways)
+                || l2_ways == 0UL) {
+                fprintf(stderr, "Error: --l2-ways debe estar en [1, %u]\n",
+                        TLB_ENTRIES_LIMIT);
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--l2-policy") == 0 && i + 1 < argc) {
+            ++i;
+            if (strcmp(argv[i], "inclusive") == 0) {
+                l2_exclusive = 0;
+            } else if (strcmp(argv[i], "exclusive") == 0) {
+                l2_exclusive = 1;
+            } else {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--lat") == 0 && i + 1 < argc) {
+            if (!parse_lat_list(argv[++i], &lat_l1, &lat_l2, &lat_walk)) {
+                fprintf(stderr, "Error: --lat espera L1,L2,WALK con enteros"
+                        " en [0, %lu]\n", LAT_LIMIT);
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--walk") == 0) {
+            walk_enabled = 1;
+        } else if (strcmp(argv[i], "--pwc") == 0 && i + 1 < argc) {
+            pwc_entries = (unsigned int)strtoul(argv[++i], NULL, 10);
+            if (pwc_entries > PWC_MAX) pwc_entries = PWC_MAX;
+        } else if (strcmp(argv[i], "--mem-lat") == 0 && i + 1 < argc) {
+            unsigned long n = 0UL;
+            if (!parse_size(argv[++i], LAT_LIMIT, &n)) {
+                fprintf(stderr, "Error: --mem-lat debe estar en [0, %lu]\n",
+                        LAT_LIMIT);
+                return EXIT_FAILURE;
+            }
+            lat_mem = (unsigned int)n;
+        } else if (strcmp(argv[i], "--fault-lat") == 0 && i + 1 < argc) {
+            unsigned long n = 0UL;
+            if (!parse_size(argv[++i], LAT_LIMIT, &n)) {
+                fprintf(stderr, "Error: --fault-lat debe estar en"
+                        " [0, %lu]\n", LAT_LIMIT);
+                return EXIT_FAILURE;
+            }
+            lat_fault = (unsigned int)n;
+        } else if (strcmp(argv[i], "--policy") == 0 && i + 1 < argc) {
+            ++i;
+            for (tlb_policy = 0; tlb_policy < POL_COUNT; ++tlb_policy) {
+                if (strcmp(argv[i], tlb_policy_names[tlb_policy]) == 0) break;
+            }
+            if (tlb_policy == POL_COUNT) {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--prefetch") == 0 && i + 1 < argc) {
+            ++i;
+            if (strcmp(argv[i], "seq") == 0) {
+                pf_kind = PF_SEQ;
+            } else if (strcmp(argv[i], "stride") == 0) {
+                pf_kind = PF_STRIDE;
+            } else {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--prefetch-buf") == 0 && i + 1 < argc) {
+            unsigned long n = strtoul(argv[++i], NULL, 10);
+            if (n > TLB_ENTRIES_LIMIT) {
+                fprintf(stderr, "Error: --prefetch-buf debe estar en"
+                        " [0, %u]\n", TLB_ENTRIES_LIMIT);
+                return EXIT_FAILURE;
+            }
+            pf_buf_entries = (unsigned int)n;
+        } else if (strcmp(argv[i], "--prefetch-degree") == 0
+                   && i + 1 < argc) {
+            unsigned long n = strtoul(argv[++i], NULL, 10);
+            if (n == 0UL || n > PF_DEGREE_MAX) {
+                fprintf(stderr, "Error: --prefetch-degree debe estar en"
+                        " [1, %u]\n", PF_DEGREE_MAX);
+                return EXIT_FAILURE;
+            }
+            pf_degree = (unsigned int)n;
+        } else if (strcmp(argv[i], "--pages") == 0 && i + 1 < argc) {
+            pages_path = argv[++i];
+        } else if (strcmp(argv[i], "--split-tlb") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%u,%u", &huge_entries[0],
+                       &huge_entries[1]) != 2
+                || huge_entries[0] > TLB_ENTRIES_LIMIT
+                || huge_entries[1] > TLB_ENTRIES_LIMIT) {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--cores") == 0 && i + 1 < argc) {
+            cores_list = argv[++i];
+        } else if (strcmp(argv[i], "--shootdown-lat") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%u,%u", &lat_sd_init,
+                       &lat_sd_target) != 2) {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--parallel") == 0 && i + 1 < argc) {
+            unsigned long n = strtoul(argv[++i], NULL, 10);
+            if (n == 0UL) {
+                long online = sysconf(_SC_NPROCESSORS_ONLN);
+                n = online > 0 ? (unsigned long)online : 1UL;
+            }
+            shard_threads = n > SHARD_MAX_THREADS ? SHARD_MAX_THREADS
+                                                  : (unsigned int)n;
+        } else if (strcmp(argv[i], "--chunk") == 0 && i + 1 < argc) {
+            shard_chunk = strtoull(argv[++i], NULL, 10);
+            if (shard_chunk == 0U) shard_chunk = 1U;
+        } else if (strcmp(argv[i], "--va-bits") == 0 && i + 1 < argc) {
+            va_bits = (unsigned int)strtoul(argv[++i], NULL, 10);
+            if (va_bits != 32U && va_bits != 48U && va_bits != 57U) {
+                fprintf(stderr, "Error: --va-bits debe ser 32, 48 o 57\n");
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--asids") == 0 && i + 1 < argc) {
+            unsigned long n = strtoul(argv[++i], NULL, 10);
+            if (n == 0UL || n > ASID_MAX) {
+                fprintf(stderr, "Error: --asids debe estar en [1, %u]\n",
+                        ASID_MAX);
+                return EXIT_FAILURE;
+            }
+            asid_count = (unsigned int)n;
+        } else if (strcmp(argv[i], "--asid-mode") == 0 && i + 1 < argc) {
+            ++i;
+            if (strcmp(argv[i], "tagged") == 0) {
+                asid_mode = ASID_TAGGED;
+            } else if (strcmp(argv[i], "flush") == 0) {
+                asid_mode = ASID_FLUSH;
+            } else {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--flush-lat") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%u,%u,%u", &lat_flush, &lat_flush_entry,
+                       &lat_invlpg) != 3) {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--timer") == 0 && i + 1 < argc) {
+            ++i;
+            if (strcmp(argv[i], "gtod") == 0) {
+                timer_kind = TIMER_GTOD;
+            } else if (strcmp(argv[i], "mono") == 0) {
+                timer_kind = TIMER_MONO;
+            } else if (strcmp(argv[i], "tsc") == 0) {
+                timer_kind = TIMER_TSC;
+            } else {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--metrics") == 0 && i + 1 < argc) {
+            metrics_dest = argv[++i];
+        } else if (strcmp(argv[i], "--metrics-format") == 0
+                   && i + 1 < argc) {
+            ++i;
+            if (strcmp(argv[i], "prom") == 0) {
+                metrics_format = METRICS_PROM;
+            } else if (strcmp(argv[i], "json") == 0) {
+                metrics_format = METRICS_JSON;
+            } else {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--metrics-interval") == 0
+                   && i + 1 < argc) {
+            metrics_interval = strtod(argv[++i], NULL);
+            if (!(metrics_interval >= 0.001) || metrics_interval > 86400.0) {
+                fprintf(stderr, "Error: --metrics-interval debe estar en"
+                        " [0.001, 86400] segundos\n");
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--metrics-window") == 0
+                   && i + 1 < argc) {
+            unsigned long n = strtoul(argv[++i], NULL, 10);
+            if (n == 0UL || n > METRICS_WINDOW_MAX) {
+                fprintf(stderr, "Error: --metrics-window debe estar en"
+                        " [1, %u]\n", METRICS_WINDOW_MAX);
+                return EXIT_FAILURE;
+            }
+            metrics_window = (uint32_t)n;
+        } else if (strcmp(argv[i], "--checkpoint") == 0 && i + 1 < argc) {
+            ckpt_path = argv[++i];
+        } else if ((strcmp(argv[i], "--checkpoint-every") == 0
+                    || strcmp(argv[i], "--checkpoint-at") == 0)
+                   && i + 1 < argc) {
+            int every = argv[i][13] == 'e';
+            double n = strtod(argv[++i], NULL); /* admite 1e9 */
+            if (!(n >= 1.0) || n > 1e18) {
+                fprintf(stderr, "Error: %s inválido\n", argv[i - 1]);
+                return EXIT_FAILURE;
+            }
+            if (every) ckpt_every = (uint64_t)n;
+            else ckpt_at = (uint64_t)n;
+        } else if (strcmp(argv[i], "--restore") == 0 && i + 1 < argc) {
+            restore_path = argv[++i];
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            policy_seed = strtoull(argv[++i], NULL, 10);
+            if (policy_seed == 0U) policy_seed = 1U; /* xorshift no admite 0 */
+        } else if (strcmp(argv[i], "--lru") == 0 && i + 1 < argc) {
+            ++i;
+            if (strcmp(argv[i], "list") == 0) {
+                lru_mode = LRU_LIST;
+            } else if (strcmp(argv[i], "scan") == 0) {
+                lru_mode = LRU_SCAN;
+            } else {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        } else {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    /* la disposición compacta llena el mismo presupuesto de bytes */
+    if (tlb_layout == LAYOUT_COMPACT && !entries_given && ways == 0UL) {
+        tlb_entries = TLB_COMPACT_ENTRIES / tlb_sets * tlb_sets;
+        if (tlb_entries == 0U) tlb_entries = tlb_sets;
+    }
+    /* entradas = conjuntos x vías; sin --ways, --entries se reparte
+       entre los conjuntos */
+    if (ways != 0UL) {
+        if ((unsigned long)tlb_sets * ways > TLB_ENTRIES_LIMIT) {
+            fprintf(stderr, "Error: conjuntos x vías excede %u\n",
+                    TLB_ENTRIES_LIMIT);
+            return EXIT_FAILURE;
+        }
+        tlb_entries = tlb_sets * (unsigned int)ways;
+    } else if (tlb_entries % tlb_sets != 0U) {
+        fprintf(stderr, "Error: --entries debe ser múltiplo de --sets\n");
+        return EXIT_FAILURE;
+    }
+
+    if (l2_ways != 0UL) {
+        if (l2_sets == 0U || (unsigned long)l2_sets * l2_ways
+                             > TLB_ENTRIES_LIMIT) {
+            fprintf(stderr, "Error: L2 conjuntos x vías inválido\n");
+            return EXIT_FAILURE;
+        }
+        l2_entries = l2_sets * (unsigned int)l2_ways;
+    }
+    if (l2_entries > TLB_ENTRIES_LIMIT || l2_sets == 0U
+        || (l2_sets & (l2_sets - 1U)) != 0U
+        || (l2_entries % l2_sets) != 0U) {
+        fprintf(stderr, "Error: configuración de L2 inválida\n");
+        return EXIT_FAILURE;
+    }
+
+    if (tlb_layout == LAYOUT_COMPACT
+        && (tlb_policy != POL_LRU || lru_mode == LRU_SCAN)) {
+        fprintf(stderr, "Error: --layout compact sólo guarda la edad LRU"
+                " (--policy lru, --lru list)\n");
+        return EXIT_FAILURE;
+    }
+    if (lru_mode == LRU_SCAN && tlb_policy != POL_LRU) {
+        fprintf(stderr, "Error: --lru scan sólo es válido con --policy lru\n");
+        return EXIT_FAILURE;
+    }
+    if (cores_list && (!trace_path || tlb_policy == POL_OPT)) {
+        fprintf(stderr, "Error: --cores necesita --trace y no admite"
+                " --policy opt\n");
+        return EXIT_FAILURE;
+    }
+    if (shard_threads && (!trace_path || tlb_policy != POL_LRU
+                          || l2_entries || walk_enabled || cores_list)) {
+        fprintf(stderr, "Error: --parallel necesita --trace y un L1 LRU"
+                " sin L2, --walk ni --cores\n");
+        return EXIT_FAILURE;
+    }
+    if (asid_count && (cores_list || shard_threads)) {
+        fprintf(stderr, "Error: --asids no admite --cores ni --parallel\n");
+        return EXIT_FAILURE;
+    }
+    if (pf_kind != PF_NONE && (cores_list || shard_threads || va_bits != 32U
+                               || tlb_policy == POL_OPT)) {
+        fprintf(stderr, "Error: --prefetch no admite --cores, --parallel,"
+                " --va-bits 48/57 ni --policy opt\n");
+        return EXIT_FAILURE;
+    }
+    if (asid_count) tag_space = asid_count << ASID_SHIFT;
+    if (va_bits != 32U) {
+        if (cores_list || shard_threads || pages_path) {
+            fprintf(stderr, "Error: --va-bits %u no admite --cores,"
+                    " --parallel ni --pages\n", va_bits);
+            return EXIT_FAILURE;
+        }
+        if (tlb_index_fn == INDEX_XOR) {
+            /* la etiqueta es un identificador denso, no la página */
+            fprintf(stderr, "Error: --va-bits %u no admite --index xor\n",
+                    va_bits);
+            return EXIT_FAILURE;
+        }
+        if (!va_init(tlb_sets > l2_sets ? tlb_sets : l2_sets)) {
+            return EXIT_FAILURE;
+        }
+    }
+    if (gen_out && !gen_spec) {
+        fprintf(stderr, "Error: --gen-out necesita --gen\n");
+        return EXIT_FAILURE;
+    }
+    if (bench_engines_run && (trace_path || cores_list || shard_threads
+                              || gen_out)) {
+        fprintf(stderr, "Error: --bench-engines no admite --trace, --cores,"
+                " --parallel ni --gen-out\n");
+        return EXIT_FAILURE;
+    }
+    /* cada motor interactivo imprime un informe por acceso: la matriz
+       usa trazas más cortas que --gen salvo que se pida --gen-count */
+    if (bench_engines_run && !gen_count_given) gen_count = 200000U;
+    if (gen_spec && !bench_engines_run
+        && (trace_path || cores_list || shard_threads
+            || (!gen_out && tlb_policy == POL_OPT))) {
+        fprintf(stderr, "Error: --gen no admite --trace, --cores, --parallel"
+                " ni --policy opt (guarde la traza con --gen-out)\n");
+        return EXIT_FAILURE;
+    }
+    if (tlb_policy == POL_OPT && !trace_path && !gen_out
+        && !bench_engines_run) {
+        fprintf(stderr, "Error: --policy opt necesita la traza completa"
+                " (--trace)\n");
+        return EXIT_FAILURE;
+    }
+
+    if ((ckpt_every || ckpt_at) && !ckpt_path) {
+        fprintf(stderr, "Error: --checkpoint-every y --checkpoint-at"
+                " necesitan --checkpoint\n");
+        return EXIT_FAILURE;
+    }
+    if ((ckpt_path || restore_path)
+        && (!trace_path || cores_list || shard_threads || asid_count
+            || walk_enabled || pages_path || pf_kind != PF_NONE
+            || va_bits != 32U || tlb_policy == POL_OPT || conv_in
+            || mrc_path || fuzz_traces || bench_lookup
+            || bench_engines_run)) {
+        fprintf(stderr, "Error: --checkpoint y --restore necesitan --trace"
+                " y no admiten --cores, --parallel, --asids, --walk,"
+                " --pages, --prefetch, --va-bits 48/57 ni --policy opt\n");
+        return EXIT_FAILURE;
+    }
+    if (metrics_dest && (cores_list || bench_engines_run || bench_lookup
+                         || fuzz_traces || mrc_path || conv_in || gen_out)) {
+        fprintf(stderr, "Error: --metrics sólo se usa con --trace, --gen,"
+                " --parallel o el modo interactivo\n");
+        return EXIT_FAILURE;
+    }
+
+    if (pages_path && !page_map_load(pages_path)) return EXIT_FAILURE;
+    if ((huge_entries[0] || huge_entries[1]) && !pages_path) {
+        fprintf(stderr, "Error: --split-tlb necesita --pages\n");
+        return EXIT_FAILURE;
+    }
+
+    if (timer_kind != TIMER_GTOD && !timer_calibrate()) {
+        fprintf(stderr, "Error: reloj no disponible en esta CPU\n");
+        return EXIT_FAILURE;
+    }
+
+    if (!tlb_select_probe(simd)) {
+        fprintf(stderr, "Error: sondeo SIMD no disponible: %s\n", simd);
+        return EXIT_FAILURE;
+    }
+
+    if (metrics_dest && !metrics_open(metrics_dest, !shard_threads)) {
+        return EXIT_FAILURE;
+    }
+
+    if (bench_lookup) return bench_lookup_main();
+    if (bench_engines_run) return bench_engines_main();
+    if (fuzz_traces) return fuzz_main();
+    if (mrc_path) return mrc_main(mrc_path);
+    if (conv_in) return convert_main(conv_in, conv_out, delta);
+    if (cores_list) return mc_main(trace_path, cores_list);
+    if (shard_threads) return shard_main(trace_path);
+    if (trace_path) return trace_main(trace_path, verbose);
+    if (gen_spec) return gen_main(gen_spec, gen_out, verbose);
+
+    char line[128];
+    /* el informe de cada acceso se arma en out_buf y sale con write():
+       en lotes si la entrada viene de un archivo o tubería y tras cada
+       pregunta si la escribe una persona */
+    int tty = isatty(STDIN_FILENO);
+    out_buf = (char *)malloc(OUT_BUF_SIZE);
+    if (!out_buf) {
+        perror("malloc salida");
+        return EXIT_FAILURE;
+    }
+    init_levels(); /* crea region en heap y marca vacío */
+    tty_engine_open();
+
+    while (1) {
+        if (out_len + OUT_REPORT_MAX > OUT_BUF_SIZE) out_flush();
+        out_str("Ingrese dirección virtual: ");
+        if (tty) out_flush();
+        if (!fgets(line, sizeof(line), stdin)) break;
+        /* quitar '\n' */
+        size_t ln = strlen(line);
+        if (ln > 0 && line[ln - 1] == '\n') line[ln - 1] = '\0';
+        if (strcmp(line, "s") == 0) {
+            out_str("Good bye!\n");
+            break;
+        }
+
+        /* imprimir bounds (requisito) */
+        out_str("TLB desde ");
+        out_hex((uintptr_t)TLB_SLOTS(tlb_heap));
+        out_str(" hasta ");
+        out_hex((uintptr_t)(TLB_SLOTS(tlb_heap)
+                            + (size_t)FIELD32(tlb_heap, H_BYTES) - 1U));
+        out_buf[out_len++] = '\n';
+
+        /* parseo y validación */
+        uint64_t vaddr;
+        if (!parse_address(line, &vaddr)) {
+            out_str("Page Fault\n");
+            ++stat_faults;
+            continue;
+        }
+
+        /* calcular página y offset */
+        uint64_t page_num = (vaddr & va_mask) >> 12; /* 20, 36 o 45 bits */
+        uint32_t offset_num = (uint32_t)vaddr & 0xFFFU;   /* 12 bits */
+
+        /* preparar representaciones binarias (variables requeridas) */
+        char page_bin[VPN_BIN_SIZE]; /* variable para pagina en binario */
+        char off_bin[OFF_BIN_SIZE];   /* variable para offset en binario */
+        dec_to_bin(page_num, (int)va_bits - 12, page_bin);
+        dec_to_bin(offset_num, 12, off_bin);
+        /* con 48/57 bits la cadena no cabe en el slot: tlb_access
+           guarda la vista de 20 bits */
+        const char *slot_bin = va_bits == 32U ? page_bin : NULL;
+
+        /* medir tiempo sólo de la búsqueda y actualización */
+        uintptr_t replaced;
+        int level;
+        int64_t elapsed; /* us con gettimeofday, ns con --timer */
+        if (timer_kind != TIMER_GTOD) {
+            uint64_t c0 = timer_now();
+            level = trace_engine
+                ? tty_engine_access(vaddr, slot_bin, off_bin, &replaced)
+                : tlb_access(vaddr, slot_bin, off_bin, &replaced);
+            uint64_t c1 = timer_now();
+            lat_record(lat_stats, level == LEVEL_L1 ? HIST_HIT : HIST_MISS,
+                       c0, c1);
+            elapsed = c1 - c0 > timer_overhead
+                ? (int64_t)((double)(c1 - c0 - timer_overhead)
+                            * timer_ns_per_tick + 0.5) : 0;
+        } else {
+            struct timeval t0, t1;
+            gettimeofday(&t0, NULL);
+            level = trace_engine
+                ? tty_engine_access(vaddr, slot_bin, off_bin, &replaced)
+                : tlb_access(vaddr, slot_bin, off_bin, &replaced);
+            gettimeofday(&t1, NULL);
+            elapsed = (int64_t)(t1.tv_sec - t0.tv_sec) * 1000000
+                      + (t1.tv_usec - t0.tv_usec);
+        }
+        if (tlb_base4k) huge_account(vaddr, level == LEVEL_L1);
+        if (level == LEVEL_L1) {
+            ++stat_hits;
+        } else {
+            ++stat_misses;
+            if (replaced != (uintptr_t)0) ++stat_evictions;
+        }
+        if (metrics_tags) {
+            /* aquí no hay bloque que amortizar: cada acceso lo vacía */
+            metrics_note(page_tag(vaddr), metrics_slot_of(replaced));
+            metrics_drain();
+            metrics_tick();
+        }
+
+        if (level == LEVEL_L1) {
+            out_str("TLB Hit\n");
+        } else if (level == LEVEL_L2) {
+            out_str("TLB Miss (Hit en L2)\n");
+        } else {
+            out_str("TLB Miss\n");
+        }
+        if (last_fault) {
+            out_str("Fallo de página: página sin mapear, marco asignado\n");
+        }
+        /* sin reemplazo (p. ej. en un Hit) -> mostrar 0x0 */
+        out_str("Politica de reemplazo: ");
+        out_hex(replaced);
+        out_buf[out_len++] = '\n';
+
+        /* Mostrar resultados (formato similar al ejemplo) */
+        out_str("Página: ");
+        out_u64(page_num);
+        out_str("\nDesplazamiento: ");
+        out_u64(offset_num);
+        out_str("\nPágina en binario: ");
+        out_str(page_bin);
+        out_str("\nDesplazamiento en binario: ");
+        out_str(off_bin);
+        out_buf[out_len++] = '\n';
+        if (page_map) {
+            out_str("Tamaño de página: ");
+            out_str(psize_names[TAG_CLASS(page_tag(vaddr))]);
+            out_buf[out_len++] = '\n';
+        }
+        /* con reloj de alta resolución se muestran los ns */
+        out_str("Tiempo: ");
+        if (elapsed < 0) { /* el reloj de pared retrocedió */
+            out_buf[out_len++] = '-';
+            elapsed = -elapsed;
+        }
+        out_fixed((uint64_t)elapsed, timer_kind != TIMER_GTOD ? 9 : 6);
+        out_str(" segundos\n\n");
+    }
+    out_flush();
+    free(out_buf);
+    out_buf = NULL;
+
+    print_latency();
+    print_huge_summary(stat_size_acc[PSIZE_4K] + stat_size_acc[PSIZE_2M]
+                       + stat_size_acc[PSIZE_1G]);
+    metrics_close(stat_hits, stat_misses, stat_evictions, stat_faults);
+    tty_engine_close();
+    free_levels();
     return 0;
 }
@@ -0,0 +1,84 @@
+/* traducir.h
+ * API de biblioteca del motor de TLB de traducir.c: un TLB por
+ * instancia (manejador opaco) y traducción por lotes sin reservar
+ * memoria en cada llamada.
+ *
+ * El motor está en tlb.c; "make" arma la biblioteca libtraducir.a
+ * (sólo tlb.c, sin main ni la interfaz de línea de comandos) y los
+ * programas se enlazan con ella y -pthread. "make check" compila y
+ * ejecuta pruebas/prueba_api.c, que usa sólo esta API.
+ *
+ * Ejemplo:
+ *   tlb_engine *e = tlb_engine_open(16U, 4U, "low", "lru", "aos");
+ *   tlb_translate(e, addrs, n, results, evicted);
+ *   tlb_engine_close(e);
+ *
+ * Alcance: cada instancia es un solo nivel de TLB para direcciones
+ * virtuales de 32 bits con páginas de 4 KiB y un único espacio de
+ * direcciones; las de 32 bits o más dan TLB_RES_FAULT. El L2, los
+ * ASID, las páginas grandes, el recorrido de la tabla de páginas, el
+ * prefetch y las direcciones de 48/57 bits no están en la API: en
+ * traducir.c esos modelos usan tablas de todo el proceso (la tabla de
+ * páginas, el mapa de páginas de 48/57 bits a etiquetas de 32, los
+ * registros ASID y los contadores por nivel), no estado por instancia.
+ * Por eso sólo las configuraciones de traducir con un solo L1 pasan
+ * por esta API (el modo por lotes con --summary y el interactivo); las
+ * demás usan el motor completo.
+ *
+ * Instancias distintas se pueden usar desde hilos distintos; una misma
+ * instancia no.
+ */
+#ifndef TRADUCIR_H
+#define TRADUCIR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct tlb_engine tlb_engine;
+
+/* resultado de cada dirección en tlb_translate */
+#define TLB_RES_MISS  0U
+#define TLB_RES_HIT   1U
+#define TLB_RES_FAULT 2U
+
+/* evicted[i] / slots[i] cuando el acceso no reemplazó ninguna entrada */
+#define TLB_NO_EVICT UINT64_MAX
+#define TLB_NO_SLOT  UINT32_MAX
+
+/* Crea un TLB de sets x ways entradas (sets potencia de 2). index es
+   "low" o "xor", policy "lru", "lru-scan" (contadores en vez de
+   lista, como --lru scan), "fifo", "clock", "plru", "random", "lfu" o
+   "arc" y layout "aos", "soa" o "compact" (sólo con lru);
+   NULL elige "low", "lru" y "aos". Devuelve NULL con errno = EINVAL si
+   la configuración es inválida o con errno = ENOMEM si no hay memoria
+   (nunca termina el proceso). */
+tlb_engine *tlb_engine_open(unsigned int sets, unsigned int ways,
+                            const char *index, const char *policy,
+                            const char *layout);
+
+/* Semilla del xorshift de la política "random" (0 se toma como 1).
+   Sin llamarla cada instancia empieza con la misma semilla fija. */
+void tlb_engine_seed(tlb_engine *e, uint64_t seed);
+
+void tlb_engine_close(tlb_engine *e);
+
+/* Traduce addrs[0..n) en orden. results[i] recibe TLB_RES_*; si
+   evicted no es NULL, evicted[i] recibe la dirección base (página
+   << 12) de la entrada reemplazada o TLB_NO_EVICT. */
+void tlb_translate(tlb_engine *e, const uint64_t *addrs, size_t n,
+                   uint8_t *results, uint64_t *evicted);
+
+/* Igual que tlb_translate; si slots no es NULL, slots[i] recibe además
+   el índice del slot reemplazado (el conjunto s ocupa los slots
+   [s*ways, (s+1)*ways)) o TLB_NO_SLOT. */
+void tlb_translate_slots(tlb_engine *e, const uint64_t *addrs, size_t n,
+                         uint8_t *results, uint64_t *evicted,
+                         uint32_t *slots);
+
+/* Contadores acumulados desde tlb_engine_open (punteros NULL se
+   ignoran). */
+void tlb_engine_stats(const tlb_engine *e, uint64_t *hits,
+                      uint64_t *misses, uint64_t *evictions,
+                      uint64_t *faults);
+
+#endif /* TRADUCIR_H */